@@ -0,0 +1,68 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+
+/// A minimal microbenchmark harness: cases are registered with `BENCH_CASE`
+/// and run (optionally filtered by name) by the `Bench` executable.
+namespace bench {
+
+class state_t {
+
+    using clock = std::chrono::steady_clock;
+
+    clock::time_point start_;
+    clock::duration elapsed_{0};
+    bool running_ = false;
+
+  public:
+    explicit state_t(uint64_t iterations) : iterations(iterations) {}
+
+    const uint64_t iterations;
+
+    /// Extra values reported next to the timing (e.g. hit ratio)
+    std::map<std::string, double> counters;
+
+    /// (Re)start the clock, so that setup done before this is not measured
+    void start() {
+        elapsed_ = clock::duration{0};
+        running_ = true;
+        start_ = clock::now();
+    }
+
+    void stop() {
+        if (running_) {
+            elapsed_ += clock::now() - start_;
+            running_ = false;
+        }
+    }
+
+    clock::duration elapsed() const { return elapsed_; }
+};
+
+using case_fn_t = std::function<void(state_t&)>;
+
+void register_case(const char* name, uint64_t iterations, case_fn_t fn);
+
+struct registrar_t {
+    registrar_t(const char* name, uint64_t iterations, case_fn_t fn) {
+        register_case(name, iterations, std::move(fn));
+    }
+};
+
+/// Prevent the compiler from optimising away a computed value
+template <typename T>
+inline void do_not_optimize(const T& val) {
+    asm volatile("" : : "g"(&val) : "memory");
+}
+
+} // namespace bench
+
+#define BENCH_CASE(NAME, ITERATIONS)                                           \
+    static void bench_##NAME(bench::state_t&);                                 \
+    static const bench::registrar_t bench_registrar_##NAME{                    \
+        #NAME, ITERATIONS, bench_##NAME};                                      \
+    static void bench_##NAME(bench::state_t& state)
@@ -0,0 +1,229 @@
+#include "bench.h"
+
+#include "utils.hpp"
+
+#include <chrono>
+#include <array>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+namespace {
+
+std::string random_bytes(size_t len) {
+    std::mt19937 rng(42);
+    std::string bytes(len, '\0');
+    for (auto& c : bytes) {
+        c = static_cast<char>(rng());
+    }
+    return bytes;
+}
+
+void report_throughput(bench::state_t& state, size_t bytes) {
+    const double seconds =
+        std::chrono::duration<double>(state.elapsed()).count();
+    state.counters["MB/s"] = bytes * state.iterations / seconds / 1e6;
+}
+
+// `bytes` is the size of the binary side: what gets encoded or comes out of
+// decoding. The _scalar cases show what the SIMD kernels are worth
+template <typename F>
+void run_codec(bench::state_t& state, util::simd_t level, size_t bytes,
+               F codec) {
+    util::set_simd(level);
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        bench::do_not_optimize(codec());
+    }
+    state.stop();
+    util::set_simd(util::simd_supported());
+    report_throughput(state, bytes);
+}
+
+void run_base64_encode(bench::state_t& state, util::simd_t level,
+                       size_t len) {
+    const auto data = random_bytes(len);
+    run_codec(state, level, len, [&] { return util::base64_encode(data); });
+}
+
+void run_base64_decode(bench::state_t& state, util::simd_t level,
+                       size_t len) {
+    const auto data = util::base64_encode(random_bytes(len));
+    run_codec(state, level, len, [&] { return util::base64_decode(data); });
+}
+
+void run_hex_encode(bench::state_t& state, util::simd_t level, size_t len) {
+    const auto data = random_bytes(len);
+    run_codec(state, level, len, [&] { return util::as_hex(data); });
+}
+
+void run_hex_decode(bench::state_t& state, util::simd_t level, size_t len) {
+    const auto data = util::as_hex(random_bytes(len));
+    run_codec(state, level, len, [&] { return util::hex_to_bytes(data); });
+}
+
+constexpr size_t MESSAGE_SIZE = 64 * 1024;
+constexpr size_t KEY_SIZE = 32;
+
+} // namespace
+
+// Message bodies and proxy responses
+BENCH_CASE(codec_base64_encode_64k_scalar, 5000) {
+    run_base64_encode(state, util::simd_t::none, MESSAGE_SIZE);
+}
+
+BENCH_CASE(codec_base64_encode_64k, 5000) {
+    run_base64_encode(state, util::simd_supported(), MESSAGE_SIZE);
+}
+
+BENCH_CASE(codec_base64_decode_64k_scalar, 5000) {
+    run_base64_decode(state, util::simd_t::none, MESSAGE_SIZE);
+}
+
+BENCH_CASE(codec_base64_decode_64k, 5000) {
+    run_base64_decode(state, util::simd_supported(), MESSAGE_SIZE);
+}
+
+// Signatures
+BENCH_CASE(codec_base64_decode_64_scalar, 1000000) {
+    run_base64_decode(state, util::simd_t::none, 64);
+}
+
+BENCH_CASE(codec_base64_decode_64, 1000000) {
+    run_base64_decode(state, util::simd_supported(), 64);
+}
+
+// Public keys
+BENCH_CASE(codec_hex_encode_32_scalar, 1000000) {
+    run_hex_encode(state, util::simd_t::none, KEY_SIZE);
+}
+
+BENCH_CASE(codec_hex_encode_32, 1000000) {
+    run_hex_encode(state, util::simd_supported(), KEY_SIZE);
+}
+
+BENCH_CASE(codec_hex_decode_32_scalar, 1000000) {
+    run_hex_decode(state, util::simd_t::none, KEY_SIZE);
+}
+
+BENCH_CASE(codec_hex_decode_32, 1000000) {
+    run_hex_decode(state, util::simd_supported(), KEY_SIZE);
+}
+
+BENCH_CASE(codec_hex_encode_64k_scalar, 5000) {
+    run_hex_encode(state, util::simd_t::none, MESSAGE_SIZE);
+}
+
+BENCH_CASE(codec_hex_encode_64k, 5000) {
+    run_hex_encode(state, util::simd_supported(), MESSAGE_SIZE);
+}
+
+BENCH_CASE(codec_hex_decode_64k_scalar, 5000) {
+    run_hex_decode(state, util::simd_t::none, MESSAGE_SIZE);
+}
+
+BENCH_CASE(codec_hex_decode_64k, 5000) {
+    run_hex_decode(state, util::simd_supported(), MESSAGE_SIZE);
+}
+
+namespace {
+
+std::array<uint8_t, KEY_SIZE> random_key() {
+    const auto bytes = random_bytes(KEY_SIZE);
+    std::array<uint8_t, KEY_SIZE> key;
+    std::copy(bytes.begin(), bytes.end(), key.begin());
+    return key;
+}
+
+std::string key_base32z() {
+    const auto encoded = util::base32z_encode(random_key());
+    return std::string(encoded.begin(), encoded.end());
+}
+
+// How base32z_decode looked characters up before the constexpr table
+const std::unordered_map<char, uint8_t> zbase32_reverse_map = [] {
+    std::unordered_map<char, uint8_t> map;
+    for (uint8_t i = 0; i < 32; ++i) {
+        map[util::zbase32_alpha[i]] = i;
+    }
+    return map;
+}();
+
+bool base32z_decode_map(const std::string& str,
+                        std::array<uint8_t, KEY_SIZE>& value) {
+    int tmp = 0, bits = 0;
+    size_t ret = 0;
+    for (size_t i = 0; i < util::base32_decode_size(value.size()); i++) {
+        const char ch = str[i];
+        if (!ch)
+            return ret == value.size();
+        const auto itr = zbase32_reverse_map.find(ch);
+        if (itr == zbase32_reverse_map.end())
+            return false;
+        tmp |= itr->second;
+        bits += 5;
+        if (bits >= 8) {
+            if (ret >= value.size())
+                return false;
+            value[ret] = tmp >> (bits - 8);
+            bits -= 8;
+            ret++;
+        }
+        tmp <<= 5;
+    }
+    return true;
+}
+
+} // namespace
+
+// Public keys of senders and snodes. The _map case is the decoder before
+// the lookup table, _generic is base32z_decode(Stack, V) with the table
+BENCH_CASE(codec_base32z_decode_32_map, 1000000) {
+    const auto str = key_base32z();
+    std::array<uint8_t, KEY_SIZE> key;
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        bench::do_not_optimize(base32z_decode_map(str, key));
+        bench::do_not_optimize(key);
+    }
+}
+
+BENCH_CASE(codec_base32z_decode_32_generic, 1000000) {
+    const auto str = key_base32z();
+    std::array<uint8_t, KEY_SIZE> key;
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        bench::do_not_optimize(util::base32z_decode(str.c_str(), key));
+        bench::do_not_optimize(key);
+    }
+}
+
+BENCH_CASE(codec_base32z_decode_32, 1000000) {
+    const auto str = key_base32z();
+    std::array<uint8_t, KEY_SIZE> key;
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        bench::do_not_optimize(util::base32z_decode(str, key));
+        bench::do_not_optimize(key);
+    }
+}
+
+BENCH_CASE(codec_base32z_encode_32_generic, 1000000) {
+    const auto key = random_key();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        char buf[64] = {0};
+        bench::do_not_optimize(util::base32z_encode(key, buf));
+        bench::do_not_optimize(buf);
+    }
+}
+
+BENCH_CASE(codec_base32z_encode_32, 1000000) {
+    const auto key = random_key();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        bench::do_not_optimize(util::base32z_encode(key));
+    }
+}
+
+BENCH_CASE(codec_hex_to_base32z, 1000000) {
+    const auto hex = util::as_hex(random_key());
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        bench::do_not_optimize(util::hex_to_base32z(hex));
+    }
+}
@@ -0,0 +1,169 @@
+#include "bench.h"
+
+#include "channel_encryption.hpp"
+#include "signature.h"
+#include "utils.hpp"
+
+extern "C" {
+#include "sispop/crypto-ops/crypto-ops.h"
+#include "sispop/crypto-ops/hash-ops.h"
+}
+
+#include <cstring>
+#include <memory>
+
+static const sispop::sispopd_key_pair_t& bench_key_pair() {
+    static const sispop::sispopd_key_pair_t key_pair{
+        {151, 254, 73, 194, 212, 54, 229, 163, 159, 138, 162,
+         227, 55, 77, 25, 181, 50, 238, 207, 178, 176, 54,
+         126, 170, 111, 112, 50, 121, 227, 78, 193, 2},
+        {227, 91, 124, 245, 5, 120, 69, 40, 71, 64, 175,
+         73, 110, 195, 35, 20, 141, 182, 138, 194, 85, 58,
+         5, 228, 103, 123, 150, 243, 175, 218, 188, 209}};
+    return key_pair;
+}
+
+// op/s is signatures/s. Mostly k*G (ge_scalarmult_base_w5) and turning it
+// into bytes (ge_p3_tobytes), hashing is a single Keccak block
+BENCH_CASE(crypto_generate_signature, 20000) {
+    const auto hash = sispop::hash_data("This is the payload");
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        const auto sig = sispop::generate_signature(hash, bench_key_pair());
+        bench::do_not_optimize(sig);
+    }
+}
+
+BENCH_CASE(crypto_ge_scalarmult_base, 20000) {
+    unsigned char scalar[32];
+    std::memcpy(scalar, bench_key_pair().private_key.data(), 32);
+    ge_p3 point;
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        scalar[0] = i;
+        ge_scalarmult_base(&point, scalar);
+        bench::do_not_optimize(point);
+    }
+}
+
+BENCH_CASE(crypto_ge_p3_tobytes, 20000) {
+    ge_p3 point;
+    ge_scalarmult_base(&point, bench_key_pair().private_key.data());
+    unsigned char bytes[32];
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        ge_p3_tobytes(bytes, &point);
+        bench::do_not_optimize(bytes);
+    }
+}
+
+// What a signature hashes: prefix hash, public key and commitment
+BENCH_CASE(crypto_cn_fast_hash_96, 200000) {
+    unsigned char data[96] = {0};
+    char hash[32];
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        data[0] = i;
+        cn_fast_hash(data, sizeof(data), hash);
+        bench::do_not_optimize(hash);
+    }
+}
+
+BENCH_CASE(crypto_ge_scalarmult_base_w5, 20000) {
+    std::unique_ptr<ge_precomp[][16]> table(
+        new ge_precomp[GE_BASE_W5_ROWS][16]);
+    ge_base_w5_init(table.get());
+    unsigned char scalar[32];
+    std::memcpy(scalar, bench_key_pair().private_key.data(), 32);
+    ge_p3 point;
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        scalar[0] = i;
+        ge_scalarmult_base_w5(&point, scalar, table.get());
+        bench::do_not_optimize(point);
+    }
+}
+
+// One /swarms/proxy_exit request: decrypting the request and encrypting the
+// response, with the same client key each time
+static void run_channel_round_trip(bench::state_t& state, bool same_channel) {
+
+    const std::vector<uint8_t> private_key(bench_key_pair().private_key.begin(),
+                                           bench_key_pair().private_key.end());
+    const std::string pub_key =
+        "86fe0345719904c47d9d3d24d742d110cab95f9386173057bd59f1c2249da174";
+    ChannelEncryption<std::string> channel(private_key);
+
+    const std::string request(1024, 'x');
+    const std::string response(4096, 'y');
+    const auto encrypted_request = channel.encrypt(request, pub_key);
+    std::string plaintext, ciphertext;
+
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        if (same_channel) {
+            channel.decrypt(encrypted_request, pub_key, plaintext);
+            channel.encrypt(response, pub_key, ciphertext);
+        } else {
+            // Nothing carried over from one request to the next
+            ChannelEncryption<std::string> fresh(private_key);
+            plaintext = fresh.decrypt(encrypted_request, pub_key);
+            ciphertext = fresh.encrypt(response, pub_key);
+        }
+        bench::do_not_optimize(ciphertext);
+    }
+}
+
+BENCH_CASE(crypto_channel_round_trip_new_key, 5000) {
+    run_channel_round_trip(state, false);
+}
+
+BENCH_CASE(crypto_channel_round_trip_cached_key, 5000) {
+    run_channel_round_trip(state, true);
+}
+
+// Encrypting a 300 KB proxied response the way it is sent: aes-cbc in
+// base64, the AEAD modes as they are
+static void run_proxy_response(bench::state_t& state, EncryptType type) {
+
+    const std::vector<uint8_t> private_key(bench_key_pair().private_key.begin(),
+                                           bench_key_pair().private_key.end());
+    const std::string pub_key =
+        "86fe0345719904c47d9d3d24d742d110cab95f9386173057bd59f1c2249da174";
+    ChannelEncryption<std::string> channel(private_key);
+
+    const std::string response(300 * 1000, 'y');
+    std::string ciphertext, body;
+
+    try {
+        channel.encrypt(response, pub_key, ciphertext, type);
+    } catch (const std::exception&) {
+        state.counters["unsupported"] = 1;
+        return;
+    }
+
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        if (is_aead(type)) {
+            channel.encrypt(response, pub_key, body, type);
+        } else {
+            channel.encrypt(response, pub_key, ciphertext, type);
+            body = util::base64_encode(ciphertext);
+        }
+        bench::do_not_optimize(body);
+    }
+    state.stop();
+
+    const double seconds =
+        std::chrono::duration<double>(state.elapsed()).count();
+    state.counters["MB/s"] = response.size() * state.iterations / seconds / 1e6;
+    state.counters["body_bytes"] = body.size();
+}
+
+BENCH_CASE(crypto_proxy_response_300k_aes_cbc, 500) {
+    run_proxy_response(state, EncryptType::aes_cbc);
+}
+
+BENCH_CASE(crypto_proxy_response_300k_aes_gcm, 500) {
+    run_proxy_response(state, EncryptType::aes_gcm);
+}
+
+BENCH_CASE(crypto_proxy_response_300k_xchacha20, 500) {
+    run_proxy_response(state, EncryptType::xchacha20);
+}
@@ -0,0 +1,193 @@
+#include "bench.h"
+
+#include "listener_registry.h"
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+constexpr size_t NUM_LISTENERS = 50000;
+
+struct listener_t {
+    sispop::ListenerRegistry<listener_t>::hook_t hook;
+    uint64_t notified = 0;
+};
+
+using listener_ptr = std::shared_ptr<listener_t>;
+
+/// What ServiceNode used to keep the listeners in
+class vector_registry_t {
+    std::unordered_map<std::string, std::vector<listener_ptr>> pk_to_listeners;
+
+  public:
+    void add(const std::string& pk, const listener_ptr& l) {
+        pk_to_listeners[pk].push_back(l);
+    }
+
+    void remove(const std::string& pk, const listener_t* l) {
+        const auto it = pk_to_listeners.find(pk);
+        if (it == pk_to_listeners.end())
+            return;
+        auto& ls = it->second;
+        ls.erase(std::remove_if(ls.begin(), ls.end(),
+                                [l](const listener_ptr& e) {
+                                    return e.get() == l;
+                                }),
+                 ls.end());
+    }
+
+    void notify(const std::string& pk) {
+        const auto it = pk_to_listeners.find(pk);
+        if (it == pk_to_listeners.end())
+            return;
+        for (auto& l : it->second) {
+            l->notified++;
+        }
+        pk_to_listeners.erase(it);
+    }
+};
+
+/// `NUM_LISTENERS` long-polls spread over `num_pubkeys` pubkeys (several
+/// devices or clients polling for the same one), in random order
+struct long_polls_t {
+    std::vector<std::string> pubkeys;
+    std::vector<listener_ptr> listeners;
+    /// Index into `pubkeys` of each listener
+    std::vector<size_t> pubkey_of;
+
+    explicit long_polls_t(size_t num_pubkeys) {
+        std::mt19937_64 rng(5);
+        for (size_t i = 0; i < num_pubkeys; ++i) {
+            pubkeys.push_back("05" + std::to_string(rng()) +
+                              std::string(44, 'a'));
+        }
+        for (size_t i = 0; i < NUM_LISTENERS; ++i) {
+            listeners.push_back(std::make_shared<listener_t>());
+            pubkey_of.push_back(i % num_pubkeys);
+        }
+        std::shuffle(pubkey_of.begin(), pubkey_of.end(), rng);
+    }
+};
+
+template <typename Registry, typename Add, typename Remove>
+void run_register_remove(bench::state_t& state, size_t num_pubkeys, Add add,
+                         Remove remove) {
+    const long_polls_t polls(num_pubkeys);
+    Registry registry;
+    // Every long-poll ends (times out or gets a response) and the client
+    // polls again: remove one, register it again
+    for (size_t i = 0; i < NUM_LISTENERS; ++i) {
+        add(registry, polls.pubkeys[polls.pubkey_of[i]], polls.listeners[i]);
+    }
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        const size_t idx = i % NUM_LISTENERS;
+        const auto& pk = polls.pubkeys[polls.pubkey_of[idx]];
+        remove(registry, pk, polls.listeners[idx]);
+        add(registry, pk, polls.listeners[idx]);
+    }
+    state.stop();
+}
+
+void run_registry(bench::state_t& state, size_t num_pubkeys) {
+    using registry_t = sispop::ListenerRegistry<listener_t>;
+    run_register_remove<registry_t>(
+        state, num_pubkeys,
+        [](registry_t& r, const std::string& pk, const listener_ptr& l) {
+            r.add(pk, l->hook, l);
+        },
+        [](registry_t& r, const std::string&, const listener_ptr& l) {
+            r.remove(l->hook);
+        });
+}
+
+void run_vector_registry(bench::state_t& state, size_t num_pubkeys) {
+    run_register_remove<vector_registry_t>(
+        state, num_pubkeys,
+        [](vector_registry_t& r, const std::string& pk,
+           const listener_ptr& l) { r.add(pk, l); },
+        [](vector_registry_t& r, const std::string& pk,
+           const listener_ptr& l) { r.remove(pk, l.get()); });
+}
+
+} // namespace
+
+// 50,000 long-polls re-registering after their timeout, for 25,000
+// pubkeys (2 each) and for 50 pubkeys with 1,000 each
+BENCH_CASE(listeners_register_remove_50k, 1000000) {
+    run_registry(state, NUM_LISTENERS / 2);
+}
+
+BENCH_CASE(listeners_vector_register_remove_50k, 1000000) {
+    run_vector_registry(state, NUM_LISTENERS / 2);
+}
+
+BENCH_CASE(listeners_register_remove_50k_hot, 1000000) {
+    run_registry(state, 50);
+}
+
+BENCH_CASE(listeners_vector_register_remove_50k_hot, 100000) {
+    run_vector_registry(state, 50);
+}
+
+// A message for each pubkey in turn, waking up its listeners, which then
+// poll again
+BENCH_CASE(listeners_notify_50k, 100) {
+    const long_polls_t polls(NUM_LISTENERS / 2);
+    sispop::ListenerRegistry<listener_t> registry;
+    for (size_t i = 0; i < NUM_LISTENERS; ++i) {
+        const auto& l = polls.listeners[i];
+        registry.add(polls.pubkeys[polls.pubkey_of[i]], l->hook, l);
+    }
+
+    uint64_t notified = 0;
+    std::vector<listener_t*> responding;
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        for (const auto& pk : polls.pubkeys) {
+            // Like the connections, which respond and remove themselves
+            responding.clear();
+            registry.for_each(pk, [&](listener_t& l) {
+                l.notified++;
+                notified++;
+                responding.push_back(&l);
+            });
+            for (listener_t* l : responding) {
+                registry.remove(l->hook);
+            }
+        }
+        for (size_t j = 0; j < NUM_LISTENERS; ++j) {
+            const auto& l = polls.listeners[j];
+            registry.add(polls.pubkeys[polls.pubkey_of[j]], l->hook, l);
+        }
+    }
+    state.stop();
+
+    state.counters["notified_per_op"] =
+        static_cast<double>(notified) / state.iterations;
+}
+
+BENCH_CASE(listeners_vector_notify_50k, 100) {
+    const long_polls_t polls(NUM_LISTENERS / 2);
+    vector_registry_t registry;
+    for (size_t i = 0; i < NUM_LISTENERS; ++i) {
+        registry.add(polls.pubkeys[polls.pubkey_of[i]], polls.listeners[i]);
+    }
+
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        for (const auto& pk : polls.pubkeys) {
+            registry.notify(pk);
+        }
+        for (size_t j = 0; j < NUM_LISTENERS; ++j) {
+            registry.add(polls.pubkeys[polls.pubkey_of[j]],
+                         polls.listeners[j]);
+        }
+    }
+    state.stop();
+}
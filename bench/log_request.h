@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace bench {
+
+struct log_request_t {
+    std::string_view target;
+    std::string pub_key;
+    std::string body;
+    std::vector<std::string> messages;
+};
+
+/// The request path with every log level compiled in
+size_t log_request_all_levels(const log_request_t& req);
+
+/// The request path built with -DLOG_ACTIVE_LEVEL=info
+size_t log_request_info_and_above(const log_request_t& req);
+
+} // namespace bench
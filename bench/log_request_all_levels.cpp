@@ -0,0 +1,3 @@
+#define BENCH_LOG_ACTIVE_LEVEL SPDLOG_LEVEL_TRACE
+#define BENCH_LOG_REQUEST_FN log_request_all_levels
+#include "log_request_impl.h"
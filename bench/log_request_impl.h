@@ -0,0 +1,40 @@
+// Included by log_request_*.cpp with a different compile-time log level, so
+// the same request path can be compared with and without trace/debug calls
+// compiled in
+#undef SISPOP_LOG_ACTIVE_LEVEL
+#define SISPOP_LOG_ACTIVE_LEVEL BENCH_LOG_ACTIVE_LEVEL
+
+#include "log_request.h"
+
+#include "sispop_logger.h"
+
+namespace bench {
+
+// Mirrors the logging done by connection_t::on_data, process_store and
+// (de)serialize_message(s) for a single store request
+size_t BENCH_LOG_REQUEST_FN(const log_request_t& req) {
+
+    size_t total = 0;
+
+    SISPOP_LOG(trace, "on data: {} bytes", req.body.size());
+    SISPOP_LOG(trace, "Target: {}", std::string(req.target));
+    SISPOP_LOG(debug, "Processing store request for {}", req.pub_key);
+
+    SISPOP_LOG(trace, "=== Deserializing ===");
+    for (const auto& data : req.messages) {
+        SISPOP_LOG(trace, "Deserialized data: {}", data);
+        SISPOP_LOG(trace, "pk: {}, msg: {}", req.pub_key, data);
+        total += data.size();
+    }
+    SISPOP_LOG(trace, "=== END ===");
+
+    for (const auto& data : req.messages) {
+        SISPOP_LOG(trace, "serialized message: {}", data);
+    }
+
+    SISPOP_LOG(info, "Stored {} messages", req.messages.size());
+
+    return total;
+}
+
+} // namespace bench
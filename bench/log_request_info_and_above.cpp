@@ -0,0 +1,3 @@
+#define BENCH_LOG_ACTIVE_LEVEL SPDLOG_LEVEL_INFO
+#define BENCH_LOG_REQUEST_FN log_request_info_and_above
+#include "log_request_impl.h"
@@ -0,0 +1,121 @@
+#include "bench.h"
+#include "log_request.h"
+
+#include "sispop_logger.h"
+#include "spdlog/sinks/base_sink.h"
+#include "spdlog/sinks/rotating_file_sink.h"
+
+#include <boost/filesystem.hpp>
+
+#include <mutex>
+
+namespace fs = boost::filesystem;
+
+// Stands in for a sink stalled on I/O (slow disk, blocked terminal)
+class slow_sink_t : public spdlog::sinks::base_sink<std::mutex> {
+  protected:
+    void sink_it_(const spdlog::details::log_msg& msg) override {
+        spdlog::memory_buf_t formatted;
+        formatter_->format(msg, formatted);
+        const auto until =
+            std::chrono::steady_clock::now() + std::chrono::microseconds(5);
+        while (std::chrono::steady_clock::now() < until) {
+        }
+    }
+
+    void flush_() override {}
+};
+
+static const std::string PUBKEY =
+    "054368520005786b249bcd461d28f75e560ea794014eeb17fcf6003f37d876783e";
+
+// Log the kind of entry we produce per request (cost at the call site)
+static void log_entries(bench::state_t& state, const char* name,
+                        spdlog::sink_ptr sink,
+                        const sispop::log_options_t& options) {
+
+    auto logger = sispop::create_logger(name, {sink}, options);
+    logger->set_level(spdlog::level::info);
+    logger->set_pattern(options.pattern);
+
+    const uint64_t dropped_before = sispop::get_dropped_log_count();
+
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        logger->info("[{}] Storing message for {}, ttl: {}", __func__, PUBKEY,
+                     i);
+    }
+    state.stop();
+
+    state.counters["dropped"] =
+        sispop::get_dropped_log_count() - dropped_before;
+    logger->flush();
+}
+
+static void log_to_file(bench::state_t& state, const char* name,
+                        const sispop::log_options_t& options) {
+
+    const auto path = fs::temp_directory_path() / fs::unique_path();
+    constexpr size_t FILE_SIZE_LIMIT = 1024 * 1024 * 50;
+
+    log_entries(state, name,
+                std::make_shared<spdlog::sinks::rotating_file_sink_mt>(
+                    path.string(), FILE_SIZE_LIMIT, 1),
+                options);
+
+    fs::remove(path);
+}
+
+static sispop::log_options_t sync_options() {
+    sispop::log_options_t options;
+    options.queue_size = 0;
+    return options;
+}
+
+BENCH_CASE(logging_sync_file, 1000000) {
+    log_to_file(state, "bench_sync_file", sync_options());
+}
+
+BENCH_CASE(logging_async_file, 1000000) {
+    log_to_file(state, "bench_async_file", sispop::log_options_t{});
+}
+
+BENCH_CASE(logging_sync_slow_sink, 100000) {
+    log_entries(state, "bench_sync_slow", std::make_shared<slow_sink_t>(),
+                sync_options());
+}
+
+BENCH_CASE(logging_async_slow_sink, 100000) {
+    log_entries(state, "bench_async_slow", std::make_shared<slow_sink_t>(),
+                sispop::log_options_t{});
+}
+
+static bench::log_request_t make_store_request() {
+
+    bench::log_request_t req;
+    req.target = "/storage_rpc/v1";
+    req.pub_key = PUBKEY;
+    req.messages.assign(3, std::string(300, 'x'));
+    req.body = std::string(1000, 'x');
+    return req;
+}
+
+// Runtime level is info (the default), so trace/debug entries are filtered
+// either at runtime or at compile time
+BENCH_CASE(log_request_all_levels_compiled, 1000000) {
+
+    const auto req = make_store_request();
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        bench::do_not_optimize(bench::log_request_all_levels(req));
+    }
+}
+
+BENCH_CASE(log_request_trace_debug_compiled_out, 1000000) {
+
+    const auto req = make_store_request();
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        bench::do_not_optimize(bench::log_request_info_and_above(req));
+    }
+}
@@ -0,0 +1,75 @@
+#include "bench.h"
+
+#include "spdlog/sinks/null_sink.h"
+#include "spdlog/spdlog.h"
+
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+namespace bench {
+
+struct case_t {
+    const char* name;
+    uint64_t iterations;
+    case_fn_t fn;
+};
+
+static std::vector<case_t>& all_cases() {
+    static std::vector<case_t> cases;
+    return cases;
+}
+
+void register_case(const char* name, uint64_t iterations, case_fn_t fn) {
+    all_cases().push_back({name, iterations, std::move(fn)});
+}
+
+static void run_case(const case_t& c) {
+
+    state_t state{c.iterations};
+    state.start();
+    c.fn(state);
+    state.stop();
+
+    const double ns = std::chrono::duration<double, std::nano>(state.elapsed())
+                          .count();
+    const double ns_per_op = ns / c.iterations;
+
+    std::cout << std::left << std::setw(44) << c.name << std::right
+              << std::setw(12) << c.iterations << std::setw(14)
+              << std::fixed << std::setprecision(1) << ns_per_op << " ns/op"
+              << std::setw(14) << std::setprecision(0) << 1e9 / ns_per_op
+              << " op/s";
+
+    for (const auto& kv : state.counters) {
+        std::cout << "  " << kv.first << "=" << std::defaultfloat
+                  << std::setprecision(4) << kv.second;
+    }
+
+    std::cout << std::endl;
+}
+
+} // namespace bench
+
+// Usage: Bench [name-substring...]
+int main(int argc, char* argv[]) {
+
+    // Code under test logs through "sispop_logger"; discard its output
+    auto logger = std::make_shared<spdlog::logger>(
+        "sispop_logger", std::make_shared<spdlog::sinks::null_sink_mt>());
+    logger->set_level(spdlog::level::info);
+    spdlog::register_logger(logger);
+
+    for (const auto& c : bench::all_cases()) {
+
+        bool selected = argc < 2;
+        for (int i = 1; i < argc; ++i) {
+            selected = selected || std::strstr(c.name, argv[i]) != nullptr;
+        }
+
+        if (selected) {
+            bench::run_case(c);
+        }
+    }
+}
@@ -0,0 +1,756 @@
+#include "bench.h"
+
+#include "channel_encryption.hpp"
+#include "http_connection.h"
+#include "https_client.h"
+#include "net_stats.h"
+#include "rate_limiter.h"
+#include "security.h"
+#include "service_node.h"
+#include "sispopd_key.h"
+#include "utils.hpp"
+
+#include <boost/asio/ssl.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/filesystem.hpp>
+
+#include <openssl/dh.h>
+#include <openssl/obj_mac.h>
+#include <openssl/pem.h>
+
+#include <pthread.h>
+#include <time.h>
+
+#include <atomic>
+#include <thread>
+
+namespace fs = boost::filesystem;
+namespace ssl = boost::asio::ssl;
+using tcp = boost::asio::ip::tcp;
+
+static const std::string PUBKEY =
+    "054368520005786b249bcd461d28f75e560ea794014eeb17fcf6003f37d876783e";
+
+constexpr unsigned CLIENT_THREADS = 8;
+
+// Certificates are generated on first use, reuse them between runs
+static fs::path bench_data_dir() {
+
+    const auto dir = fs::temp_directory_path() / "sispop-storage-bench";
+    fs::create_directories(dir);
+
+    // The server would generate its own parameters, which takes minutes:
+    // use a well-known group instead (1024-bit ones are rejected as too
+    // small)
+    const auto dh_path = (dir / "dh.pem").string();
+    if (!fs::exists(dh_path)) {
+        DH* dh = DH_new_by_nid(NID_ffdhe2048);
+        FILE* f = fopen(dh_path.c_str(), "wt");
+        PEM_write_DHparams(f, dh);
+        fclose(f);
+        DH_free(dh);
+    }
+
+    return dir;
+}
+
+static uint16_t pick_free_port() {
+    boost::asio::io_context ioc;
+    tcp::acceptor acceptor{ioc, {boost::asio::ip::make_address("127.0.0.1"), 0}};
+    return acceptor.local_endpoint().port();
+}
+
+static sispop::sispopd_key_pair_t bench_key_pair() {
+    sispop::sispopd_key_pair_t key_pair;
+    key_pair.private_key = {151, 254, 73,  194, 212, 54,  229, 163,
+                            159, 138, 162, 227, 55,  77,  25,  181,
+                            50,  238, 207, 178, 176, 54,  126, 170,
+                            111, 112, 50,  121, 227, 78,  193, 2};
+    key_pair.public_key = sispop::derive_pubkey_legacy(key_pair.private_key);
+    return key_pair;
+}
+
+/// Sispopd's RPC, answering every request with the same (canned) response
+class fake_sispopd_t {
+
+    boost::asio::io_context ioc_{1};
+    tcp::acceptor acceptor_{ioc_,
+                            {boost::asio::ip::make_address("127.0.0.1"), 0}};
+    const std::string response_;
+    std::thread thread_;
+
+    void accept() {
+        acceptor_.async_accept(
+            [this](boost::system::error_code ec, tcp::socket socket) {
+                if (ec) {
+                    return;
+                }
+                serve(socket);
+                accept();
+            });
+    }
+
+    void serve(tcp::socket& socket) {
+        namespace http = boost::beast::http;
+
+        boost::system::error_code ec;
+        boost::beast::flat_buffer buffer;
+        http::request<http::string_body> req;
+        http::read(socket, buffer, req, ec);
+        if (ec) {
+            return;
+        }
+
+        http::response<http::string_body> res{http::status::ok, 11};
+        res.set(http::field::content_type, "application/json");
+        res.keep_alive(false);
+        res.body() = response_;
+        res.prepare_payload();
+        http::write(socket, res, ec);
+        socket.shutdown(tcp::socket::shutdown_both, ec);
+    }
+
+  public:
+    explicit fake_sispopd_t(std::string response)
+        : response_(std::move(response)) {
+        accept();
+        thread_ = std::thread([this]() { ioc_.run(); });
+    }
+
+    ~fake_sispopd_t() {
+        ioc_.stop();
+        thread_.join();
+    }
+
+    uint16_t port() const { return acceptor_.local_endpoint().port(); }
+};
+
+/// What sispopd says about a network of just the node with `key_pair`
+static std::string single_node_network(const sispop::sispopd_key_pair_t& key_pair,
+                                       uint16_t port) {
+    const auto pubkey = util::as_hex(key_pair.public_key);
+    return R"({"id":"0","jsonrpc":"2.0","result":{"service_node_states":[)"
+           R"({"funded":true,"public_ip":"127.0.0.1","pubkey_ed25519":")" +
+           pubkey + R"(","pubkey_x25519":")" + pubkey +
+           R"(","service_node_pubkey":")" + pubkey +
+           R"(","storage_port":)" + std::to_string(port) +
+           R"(,"swarm_id":1}],"height":1,"block_hash":")" +
+           std::string(64, 'a') + R"(","hardfork":14,"status":"OK"}})";
+}
+
+/// A storage server (as set up by main.cpp) listening on localhost, with
+/// the ready check disabled, and sispopd unreachable unless the server is
+/// to be in a swarm (of its own, responsible for all pubkeys)
+class server_t {
+
+    boost::asio::io_context ioc_{1};
+    boost::asio::io_context worker_ioc_{1};
+
+    const fs::path data_dir_ = bench_data_dir();
+    const uint16_t port_ = pick_free_port();
+
+    sispop::sispopd_key_pair_t key_pair_ = bench_key_pair();
+    std::unique_ptr<fake_sispopd_t> sispopd_;
+    sispop::SispopdClient sispopd_client_;
+    ChannelEncryption<std::string> channel_encryption_{
+        std::vector<uint8_t>(32, 1)};
+    RateLimiter rate_limiter_;
+
+    std::unique_ptr<sispop::Security> security_;
+    std::unique_ptr<sispop::ServiceNode> service_node_;
+
+    std::thread thread_;
+
+  public:
+    explicit server_t(
+        unsigned threads,
+        const sispop::tls_session_options_t& tls_options = {},
+        const sispop::http_server::keep_alive_options_t& keep_alive = {},
+        bool in_swarm = false)
+        : sispopd_(in_swarm ? std::make_unique<fake_sispopd_t>(
+                                  single_node_network(key_pair_, port_))
+                            : nullptr),
+          sispopd_client_{ioc_, "127.0.0.1",
+                          sispopd_ ? sispopd_->port() : uint16_t{1}} {
+
+        // Fresh database for every run
+        fs::remove(data_dir_ / "storage.db");
+
+        security_ = std::make_unique<sispop::Security>(key_pair_, data_dir_);
+        service_node_ = std::make_unique<sispop::ServiceNode>(
+            ioc_, worker_ioc_, port_, key_pair_, key_pair_,
+            data_dir_.string(), sispopd_client_, true);
+
+        thread_ = std::thread([this, threads, tls_options, keep_alive]() {
+            sispop::http_server::run(ioc_, "127.0.0.1", port_,
+                                     data_dir_.string(), *service_node_,
+                                     channel_encryption_, rate_limiter_,
+                                     *security_, threads, tls_options,
+                                     keep_alive);
+        });
+
+        wait_until_listening();
+    }
+
+    ~server_t() {
+        ioc_.stop();
+        thread_.join();
+    }
+
+    uint16_t port() const { return port_; }
+
+    std::string pubkey_b32z() const {
+        char buf[64] = {0};
+        util::base32z_encode(key_pair_.public_key, buf);
+        return buf;
+    }
+
+    std::string cert_path() const { return (data_dir_ / "cert.pem").string(); }
+
+    std::string cert_signature() const { return security_->get_cert_signature(); }
+
+    /// Hand `msg` to the service node as if a swarm member pushed it
+    void push(const sispop::message_t& msg) {
+        boost::asio::post(ioc_, [this, msg]() {
+            service_node_->process_push(msg);
+        });
+    }
+
+    /// CPU time used so far by the thread running the server (which serves
+    /// all connections if there is only one)
+    std::chrono::nanoseconds cpu_time() {
+        clockid_t clock;
+        timespec ts{};
+        pthread_getcpuclockid(thread_.native_handle(), &clock);
+        clock_gettime(clock, &ts);
+        return std::chrono::seconds(ts.tv_sec) +
+               std::chrono::nanoseconds(ts.tv_nsec);
+    }
+
+  private:
+    void wait_until_listening() const {
+        boost::asio::io_context ioc;
+        for (;;) {
+            tcp::socket socket{ioc};
+            boost::system::error_code ec;
+            socket.connect(
+                {boost::asio::ip::make_address("127.0.0.1"), port_}, ec);
+            if (!ec) {
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+};
+
+/// Connect (from `local`) and perform the TLS handshake. If `session` is
+/// given, the client offers it for resumption and stores the one it ends
+/// up with
+static bool connect(ssl::stream<tcp::socket>& stream,
+                    const tcp::endpoint& local, const tcp::endpoint& server,
+                    SSL_SESSION** session = nullptr) {
+
+    boost::system::error_code ec;
+
+    auto& socket = stream.next_layer();
+    socket.open(tcp::v4());
+    // Every client thread gets its own source address so that it is rate
+    // limited separately
+    socket.bind(local);
+    socket.connect(server, ec);
+    if (ec) {
+        return false;
+    }
+    // A resumed handshake ends with the client's Finished, immediately
+    // followed by the request: don't let Nagle hold it back
+    socket.set_option(tcp::no_delay(true));
+
+    if (session && *session) {
+        SSL_set_session(stream.native_handle(), *session);
+    }
+
+    stream.handshake(ssl::stream_base::client, ec);
+    if (ec) {
+        return false;
+    }
+
+    if (session) {
+        SSL_SESSION_free(*session);
+        *session = SSL_get1_session(stream.native_handle());
+    }
+
+    return true;
+}
+
+/// A single (empty) retrieve; returns whether the request succeeded.
+/// `keep_alive` is what the client asks for on the way in, and whether the
+/// server agreed to keep the connection open on the way out
+static bool retrieve(ssl::stream<tcp::socket>& stream,
+                     boost::beast::flat_buffer& buffer, bool& keep_alive) {
+
+    namespace http = boost::beast::http;
+
+    boost::system::error_code ec;
+
+    http::request<http::string_body> req{http::verb::post, "/storage_rpc/v1",
+                                         11};
+    req.set(http::field::host, "service node");
+    req.keep_alive(keep_alive);
+    req.body() = "{\"method\":\"retrieve\",\"params\":{\"pubKey\":\"" + PUBKEY +
+                 "\",\"lastHash\":\"\"}}";
+    req.prepare_payload();
+
+    http::write(stream, req, ec);
+    if (ec) {
+        return false;
+    }
+
+    http::response<http::string_body> res;
+    http::read(stream, buffer, res, ec);
+
+    keep_alive = !ec && res.keep_alive();
+
+    return !ec && res.result() == http::status::ok;
+}
+
+/// One client connection: TLS handshake, a single retrieve, close
+static bool handshake_and_retrieve(boost::asio::io_context& ioc,
+                                   ssl::context& ssl_ctx,
+                                   const tcp::endpoint& local,
+                                   const tcp::endpoint& server,
+                                   SSL_SESSION** session = nullptr) {
+
+    ssl::stream<tcp::socket> stream{ioc, ssl_ctx};
+    if (!connect(stream, local, server, session)) {
+        return false;
+    }
+
+    boost::beast::flat_buffer buffer;
+    bool keep_alive = false;
+    const bool ok = retrieve(stream, buffer, keep_alive);
+
+    boost::system::error_code ec;
+    stream.shutdown(ec);
+
+    return ok;
+}
+
+static void run_load(bench::state_t& state, unsigned server_threads) {
+
+    server_t server{server_threads};
+
+    const tcp::endpoint server_ep{boost::asio::ip::make_address("127.0.0.1"),
+                                  server.port()};
+
+    std::atomic<uint64_t> failed{0};
+    std::vector<std::thread> clients;
+
+    const auto cpu_before = server.cpu_time();
+    state.start();
+
+    for (unsigned i = 0; i < CLIENT_THREADS; ++i) {
+        clients.emplace_back([&, i]() {
+            boost::asio::io_context ioc;
+            ssl::context ssl_ctx{ssl::context::tlsv12_client};
+            const tcp::endpoint local{
+                boost::asio::ip::make_address("127.0.0." + std::to_string(2 + i)),
+                0};
+
+            for (uint64_t n = i; n < state.iterations; n += CLIENT_THREADS) {
+                if (!handshake_and_retrieve(ioc, ssl_ctx, local, server_ep)) {
+                    failed++;
+                }
+            }
+        });
+    }
+
+    for (auto& client : clients) {
+        client.join();
+    }
+
+    state.stop();
+    const auto cpu_used = server.cpu_time() - cpu_before;
+
+    // With several threads, the time the main one (accepting, and running
+    // the service node) still spends on each request
+    state.counters["main_thread_cpu_us_per_req"] =
+        std::chrono::duration<double, std::micro>(cpu_used).count() /
+        state.iterations;
+    state.counters["failed"] = failed;
+}
+
+BENCH_CASE(server_handshake_retrieve_1_thread, 2000) { run_load(state, 1); }
+
+BENCH_CASE(server_handshake_retrieve_2_threads, 2000) { run_load(state, 2); }
+
+BENCH_CASE(server_handshake_retrieve_4_threads, 2000) { run_load(state, 4); }
+
+BENCH_CASE(server_handshake_retrieve_8_threads, 2000) { run_load(state, 8); }
+
+// The same client reconnecting for every request (e.g. a polling client),
+// with or without offering its previous session
+static void run_reconnects(bench::state_t& state, bool resume) {
+
+    server_t server{1};
+
+    const tcp::endpoint server_ep{boost::asio::ip::make_address("127.0.0.1"),
+                                  server.port()};
+    const tcp::endpoint local{boost::asio::ip::make_address("127.0.0.2"), 0};
+
+    boost::asio::io_context ioc;
+    ssl::context ssl_ctx{ssl::context::tlsv12_client};
+    SSL_SESSION* session = nullptr;
+
+    const auto& stats = get_net_stats();
+    const uint64_t full_before = stats.tls_handshakes_full;
+    const uint64_t resumed_before = stats.tls_handshakes_resumed;
+    uint64_t failed = 0;
+
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        if (!handshake_and_retrieve(ioc, ssl_ctx, local, server_ep,
+                                    resume ? &session : nullptr)) {
+            failed++;
+        }
+    }
+    state.stop();
+
+    SSL_SESSION_free(session);
+
+    state.counters["full"] = stats.tls_handshakes_full - full_before;
+    state.counters["resumed"] = stats.tls_handshakes_resumed - resumed_before;
+    state.counters["failed"] = failed;
+}
+
+BENCH_CASE(server_reconnect_full_handshake, 500) {
+    run_reconnects(state, false);
+}
+
+BENCH_CASE(server_reconnect_resumed_session, 500) {
+    run_reconnects(state, true);
+}
+
+// A population of clients polling for messages, either reconnecting for
+// every poll or keeping their connection open; reports the server's CPU
+// time per poll
+static void run_polling(bench::state_t& state, bool keep_alive) {
+
+    server_t server{1};
+
+    const tcp::endpoint server_ep{boost::asio::ip::make_address("127.0.0.1"),
+                                  server.port()};
+
+    std::atomic<uint64_t> failed{0};
+    std::atomic<uint64_t> connections{0};
+    std::vector<std::thread> clients;
+
+    const auto cpu_before = server.cpu_time();
+    state.start();
+
+    for (unsigned i = 0; i < CLIENT_THREADS; ++i) {
+        clients.emplace_back([&, i]() {
+            boost::asio::io_context ioc;
+            ssl::context ssl_ctx{ssl::context::tlsv12_client};
+            const tcp::endpoint local{
+                boost::asio::ip::make_address("127.0.0." + std::to_string(2 + i)),
+                0};
+
+            std::unique_ptr<ssl::stream<tcp::socket>> stream;
+            boost::beast::flat_buffer buffer;
+
+            for (uint64_t n = i; n < state.iterations; n += CLIENT_THREADS) {
+                if (!stream) {
+                    stream =
+                        std::make_unique<ssl::stream<tcp::socket>>(ioc, ssl_ctx);
+                    buffer.clear();
+                    connections++;
+                    if (!connect(*stream, local, server_ep)) {
+                        failed++;
+                        stream.reset();
+                        continue;
+                    }
+                }
+
+                // The server closes the connection once it reaches its
+                // request limit
+                bool kept_alive = keep_alive;
+                if (!retrieve(*stream, buffer, kept_alive)) {
+                    failed++;
+                }
+
+                if (!kept_alive) {
+                    boost::system::error_code ec;
+                    stream->shutdown(ec);
+                    stream.reset();
+                }
+            }
+
+            if (stream) {
+                boost::system::error_code ec;
+                stream->shutdown(ec);
+            }
+        });
+    }
+
+    for (auto& client : clients) {
+        client.join();
+    }
+
+    state.stop();
+    const auto cpu_used = server.cpu_time() - cpu_before;
+
+    state.counters["server_cpu_us_per_poll"] =
+        std::chrono::duration<double, std::micro>(cpu_used).count() /
+        state.iterations;
+    state.counters["connections"] = connections;
+    state.counters["failed"] = failed;
+}
+
+BENCH_CASE(server_polling_reconnect, 2000) { run_polling(state, false); }
+
+BENCH_CASE(server_polling_keep_alive, 2000) { run_polling(state, true); }
+
+// Sequential requests from this node to another one (like relaying
+// messages to a swarm member), with or without pooled connections
+static void run_peer_requests(bench::state_t& state, size_t pool_size) {
+
+    server_t server{1};
+
+    boost::asio::io_context ioc;
+    auto& pool = sispop::get_https_pool();
+    pool.set_max_idle_per_peer(pool_size);
+
+    const auto req = sispop::build_post_request("/swarms/ping_test/v1", "");
+    const auto pubkey = server.pubkey_b32z();
+    // Any response that doesn't check out counts as failed
+    sispop::set_enforce_peer_signatures(true);
+
+    const auto& stats = get_net_stats();
+    const uint64_t created_before = stats.https_connections_created;
+    const uint64_t reused_before = stats.https_connections_reused;
+    uint64_t failed = 0;
+
+    const auto cpu_before = server.cpu_time();
+    state.start();
+
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        bool done = false;
+        sispop::make_https_request(ioc, "127.0.0.1", server.port(), pubkey,
+                                   req, [&](sispop::sn_response_t res) {
+                                       done = true;
+                                       if (res.error_code !=
+                                           sispop::SNodeError::NO_ERROR) {
+                                           failed++;
+                                       }
+                                   });
+        ioc.restart();
+        while (!done) {
+            ioc.run_one();
+        }
+    }
+
+    state.stop();
+    const auto cpu_used = server.cpu_time() - cpu_before;
+
+    // Don't leave connections bound to `ioc` behind
+    pool.set_max_idle_per_peer(0);
+    ioc.restart();
+    ioc.run();
+    pool.set_max_idle_per_peer(2);
+
+    state.counters["server_cpu_us_per_req"] =
+        std::chrono::duration<double, std::micro>(cpu_used).count() /
+        state.iterations;
+    state.counters["created"] = stats.https_connections_created - created_before;
+    state.counters["reused"] = stats.https_connections_reused - reused_before;
+    state.counters["failed"] = failed;
+}
+
+BENCH_CASE(peer_requests_new_connections, 1000) { run_peer_requests(state, 0); }
+
+BENCH_CASE(peer_requests_pooled, 1000) { run_peer_requests(state, 2); }
+
+// What a client spends checking a node's identity on a new connection
+static void run_cert_verification(bench::state_t& state, bool cached) {
+
+    server_t server{1};
+
+    FILE* f = fopen(server.cert_path().c_str(), "r");
+    X509* cert = PEM_read_X509(f, nullptr, nullptr, nullptr);
+    fclose(f);
+
+    const auto signature = server.cert_signature();
+    const auto pubkey = server.pubkey_b32z();
+    auto& cache = sispop::get_peer_cert_cache();
+    uint64_t failed = 0;
+
+    cache.clear();
+
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        if (!cached) {
+            cache.clear();
+        }
+        if (!sispop::verify_cert_signature(cert, signature, pubkey)) {
+            failed++;
+        }
+    }
+    state.stop();
+
+    X509_free(cert);
+
+    state.counters["failed"] = failed;
+}
+
+BENCH_CASE(peer_cert_verify_uncached, 2000) {
+    run_cert_verification(state, false);
+}
+
+BENCH_CASE(peer_cert_verify_cached, 2000) {
+    run_cert_verification(state, true);
+}
+
+/// A retrieve of the messages after `last_hash` that waits for new ones if
+/// there are none; returns how many there were (-1 on failure), leaving
+/// `last_hash` at the last one. `sent` is incremented once the request is
+/// on its way, and `keep_alive` is whether the server keeps the connection
+/// open
+static int long_poll(ssl::stream<tcp::socket>& stream,
+                     boost::beast::flat_buffer& buffer, std::string& last_hash,
+                     std::atomic<uint64_t>& sent, bool& keep_alive) {
+
+    namespace http = boost::beast::http;
+
+    boost::system::error_code ec;
+
+    http::request<http::string_body> req{http::verb::post, "/storage_rpc/v1",
+                                         11};
+    req.set(http::field::host, "service node");
+    req.set("X-Sispop-Long-Poll", "true");
+    req.keep_alive(true);
+    req.body() = "{\"method\":\"retrieve\",\"params\":{\"pubKey\":\"" + PUBKEY +
+                 "\",\"lastHash\":\"" + last_hash + "\"}}";
+    req.prepare_payload();
+
+    http::write(stream, req, ec);
+    if (ec) {
+        return -1;
+    }
+    sent++;
+
+    http::response<http::string_body> res;
+    http::read(stream, buffer, res, ec);
+    keep_alive = !ec && res.keep_alive();
+    if (ec || res.result() != http::status::ok) {
+        return -1;
+    }
+
+    const auto body = nlohmann::json::parse(res.body(), nullptr, false);
+    if (body.is_discarded() || !body.contains("messages")) {
+        return -1;
+    }
+    const auto& messages = body["messages"];
+    if (!messages.empty()) {
+        last_hash = messages.back()["hash"].get<std::string>();
+    }
+    return static_cast<int>(messages.size());
+}
+
+// A client long polling for messages that arrive in bursts of
+// `burst_size` (e.g. a multi-part message or a busy group); reports the
+// polls it takes to get each burst
+static void run_long_poll_bursts(bench::state_t& state, size_t burst_size) {
+
+    server_t server{1, {}, {}, true};
+
+    const tcp::endpoint server_ep{boost::asio::ip::make_address("127.0.0.1"),
+                                  server.port()};
+    const tcp::endpoint local{boost::asio::ip::make_address("127.0.0.2"), 0};
+
+    boost::asio::io_context ioc;
+    ssl::context ssl_ctx{ssl::context::tlsv12_client};
+
+    // Until the server finds itself in a swarm (responsible for PUBKEY),
+    // retrieves are redirected
+    while (!handshake_and_retrieve(ioc, ssl_ctx, local, server_ep)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    std::atomic<uint64_t> received{0};
+    std::atomic<uint64_t> polls_sent{0};
+    std::atomic<uint64_t> polls{0};
+    std::atomic<bool> failed{false};
+    const uint64_t expected = state.iterations * burst_size;
+
+    std::thread client([&]() {
+        std::unique_ptr<ssl::stream<tcp::socket>> stream;
+        boost::beast::flat_buffer buffer;
+        std::string last_hash;
+
+        while (received < expected) {
+            // The server closes the connection once it reaches its request
+            // limit
+            if (!stream) {
+                stream = std::make_unique<ssl::stream<tcp::socket>>(ioc, ssl_ctx);
+                buffer.clear();
+                if (!connect(*stream, local, server_ep)) {
+                    failed = true;
+                    return;
+                }
+            }
+            bool keep_alive = true;
+            const int count =
+                long_poll(*stream, buffer, last_hash, polls_sent, keep_alive);
+            if (count < 0) {
+                failed = true;
+                return;
+            }
+            polls++;
+            received += count;
+            if (!keep_alive) {
+                boost::system::error_code ec;
+                stream->shutdown(ec);
+                stream.reset();
+            }
+        }
+    });
+
+    const uint64_t timestamp =
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch())
+            .count();
+
+    const auto cpu_before = server.cpu_time();
+    state.start();
+    for (uint64_t i = 0; i < state.iterations && !failed; ++i) {
+        // Each burst finds the client waiting (give the server a moment to
+        // register its poll)
+        while (polls_sent == polls && !failed) {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        for (size_t j = 0; j < burst_size; ++j) {
+            const auto n = std::to_string(i * burst_size + j);
+            server.push(sispop::message_t{PUBKEY, "message " + n,
+                                          "hash" + n, 86400000, timestamp});
+        }
+        while (received < (i + 1) * burst_size && !failed) {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+    state.stop();
+    const auto cpu_used = server.cpu_time() - cpu_before;
+
+    client.join();
+
+    state.counters["polls_per_burst"] =
+        static_cast<double>(polls) / state.iterations;
+    state.counters["server_cpu_us_per_burst"] =
+        std::chrono::duration<double, std::micro>(cpu_used).count() /
+        state.iterations;
+    state.counters["failed"] = failed;
+}
+
+BENCH_CASE(server_long_poll_burst_1, 200) { run_long_poll_bursts(state, 1); }
+
+BENCH_CASE(server_long_poll_burst_5, 200) { run_long_poll_bursts(state, 5); }
@@ -0,0 +1,95 @@
+#include "bench.h"
+
+#include "signature.h"
+#include "utils.hpp"
+
+static const sispop::sispopd_key_pair_t& test_key_pair() {
+    static const sispop::sispopd_key_pair_t key_pair{
+        {151, 254, 73, 194, 212, 54, 229, 163, 159, 138, 162,
+         227, 55, 77, 25, 181, 50, 238, 207, 178, 176, 54,
+         126, 170, 111, 112, 50, 121, 227, 78, 193, 2},
+        {227, 91, 124, 245, 5, 120, 69, 40, 71, 64, 175,
+         73, 110, 195, 35, 20, 141, 182, 138, 194, 85, 58,
+         5, 228, 103, 123, 150, 243, 175, 218, 188, 209}};
+    return key_pair;
+}
+
+static std::string sign_b64(const sispop::hash& hash) {
+    const auto sig = sispop::generate_signature(hash, test_key_pair());
+    std::string raw_sig;
+    raw_sig.insert(raw_sig.end(), sig.c.begin(), sig.c.end());
+    raw_sig.insert(raw_sig.end(), sig.r.begin(), sig.r.end());
+    return util::base64_encode(raw_sig);
+}
+
+static std::string test_pubkey_b32z() {
+    char buf[64] = {0};
+    return util::base32z_encode(test_key_pair().public_key, buf);
+}
+
+// What validating a signed request from another snode costs (hashing the
+// body and checking the signature), for a 16 KiB push batch
+static void run_request_validation(bench::state_t& state, bool cached) {
+
+    const std::string body(16 * 1024, 'x');
+    const auto signature = sign_b64(sispop::hash_data(body));
+    const auto pubkey = test_pubkey_b32z();
+
+    sispop::SignatureCache cache(cached ? 2048 : 0);
+    uint64_t failed = 0;
+
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        const auto hash = sispop::hash_data(body);
+        if (!cache.check(signature, hash, pubkey)) {
+            failed++;
+        }
+    }
+    state.stop();
+
+    state.counters["hits"] = cache.hits();
+    state.counters["failed"] = failed;
+}
+
+BENCH_CASE(snode_request_signature_uncached, 5000) {
+    run_request_validation(state, false);
+}
+
+BENCH_CASE(snode_request_signature_cached, 5000) {
+    run_request_validation(state, true);
+}
+
+// Checking the signatures of `batch` push requests together, as the
+// SignatureBatcher does when several peers push to us at once (op/s is
+// checks/s)
+static void run_batch_check(bench::state_t& state, size_t batch) {
+
+    const auto& key_pair = test_key_pair();
+
+    std::vector<sispop::signature_check_t> checks;
+    for (size_t i = 0; i < batch; ++i) {
+        const auto hash = sispop::hash_data("payload " + std::to_string(i));
+        checks.push_back({sispop::generate_signature(hash, key_pair), hash,
+                          key_pair.public_key});
+    }
+
+    uint64_t failed = 0;
+
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; i += batch) {
+        for (const bool valid : sispop::check_signatures(checks)) {
+            if (!valid) {
+                failed++;
+            }
+        }
+    }
+    state.stop();
+
+    state.counters["failed"] = failed;
+}
+
+BENCH_CASE(signature_check_batch_1, 4096) { run_batch_check(state, 1); }
+
+BENCH_CASE(signature_check_batch_16, 4096) { run_batch_check(state, 16); }
+
+BENCH_CASE(signature_check_batch_64, 4096) { run_batch_check(state, 64); }
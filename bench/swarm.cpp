@@ -0,0 +1,356 @@
+#include "bench.h"
+
+#include "../external/json.hpp"
+
+#include "rate_limiter.h"
+#include "signature.h"
+#include "swarm.h"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <memory>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr size_t NUM_SWARMS = 2000;
+
+/// Swarms with random ids, sorted like the ones from the daemon
+sispop::all_swarms_t random_swarms(size_t count) {
+    std::mt19937_64 rng(1);
+    std::vector<swarm_id_t> ids(count);
+    for (auto& id : ids) {
+        id = rng() % (INVALID_SWARM_ID - 1);
+    }
+    std::sort(ids.begin(), ids.end());
+
+    sispop::all_swarms_t swarms;
+    for (const auto id : ids) {
+        swarms.push_back({id, {}});
+    }
+    return swarms;
+}
+
+std::vector<sispop::user_pubkey_t> random_pubkeys(size_t count) {
+    std::mt19937_64 rng(2);
+    std::vector<sispop::user_pubkey_t> pubkeys;
+    for (size_t i = 0; i < count; ++i) {
+        std::string hex = "05";
+        for (int j = 0; j < 4; ++j) {
+            char buf[17];
+            snprintf(buf, sizeof(buf), "%016llx",
+                     static_cast<unsigned long long>(rng()));
+            hex += buf;
+        }
+        bool success;
+        pubkeys.push_back(sispop::user_pubkey_t::create(hex, success));
+    }
+    return pubkeys;
+}
+
+} // namespace
+
+// What is_pubkey_for_us and get_snodes_by_pk did for every request
+BENCH_CASE(swarm_lookup_linear_2000, 200000) {
+    const auto swarms = random_swarms(NUM_SWARMS);
+    const auto pubkeys = random_pubkeys(1024);
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        const auto& pk = pubkeys[i % pubkeys.size()];
+        bench::do_not_optimize(sispop::get_swarm_by_pk(swarms, pk));
+    }
+    state.stop();
+}
+
+static void run_ring_lookup(bench::state_t& state, size_t num_pubkeys) {
+    sispop::Swarm swarm{sn_record_t{}};
+    swarm.apply_swarm_changes(random_swarms(NUM_SWARMS));
+    const auto pubkeys = random_pubkeys(num_pubkeys);
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        const auto& pk = pubkeys[i % pubkeys.size()];
+        bench::do_not_optimize(swarm.get_swarm_by_pk(pk));
+    }
+    state.stop();
+    state.counters["hits"] = swarm.swarm_cache_hits();
+}
+
+// Every pubkey once, so nothing comes from the cache
+BENCH_CASE(swarm_lookup_ring_2000, 200000) {
+    run_ring_lookup(state, state.iterations);
+}
+
+// The same active pubkeys over and over
+BENCH_CASE(swarm_lookup_cached_2000, 200000) {
+    run_ring_lookup(state, 1024);
+}
+
+namespace {
+
+std::array<uint8_t, 32> random_key(std::mt19937_64& rng) {
+    std::array<uint8_t, 32> key;
+    for (auto& b : key) {
+        b = rng();
+    }
+    return key;
+}
+
+sn_record_t random_record(std::mt19937_64& rng, uint16_t port) {
+    const auto pk = util::base32z_encode(random_key(rng));
+    return sn_record_t{port,
+                       std::string(pk.begin(), pk.end()),
+                       util::as_hex(random_key(rng)),
+                       util::as_hex(random_key(rng)),
+                       util::as_hex(random_key(rng)),
+                       "10.0.0.1"};
+}
+
+/// `num_swarms` swarms of 5 nodes plus 5% decommissioned nodes, known to a
+/// node in the first swarm
+struct network_t {
+    sispop::all_swarms_t swarms;
+    std::vector<sn_record_t> decommissioned;
+    std::unique_ptr<sispop::Swarm> swarm;
+
+    network_t(size_t num_swarms, const sn_record_t& extra_node) {
+        std::mt19937_64 rng(3);
+        uint16_t port = 1000;
+        for (size_t i = 0; i < num_swarms; ++i) {
+            sispop::SwarmInfo si{rng() % (INVALID_SWARM_ID - 1), {}};
+            for (int j = 0; j < 5; ++j) {
+                si.snodes.push_back(random_record(rng, port++));
+            }
+            swarms.push_back(std::move(si));
+        }
+        for (size_t i = 0; i < num_swarms / 4; ++i) {
+            decommissioned.push_back(random_record(rng, port++));
+        }
+        // Somewhere in the middle
+        swarms[num_swarms / 2].snodes.push_back(extra_node);
+
+        swarm.reset(new sispop::Swarm{swarms[0].snodes[0]});
+        const auto events = swarm->derive_swarm_events(swarms);
+        swarm->set_swarm_id(events.our_swarm_id);
+        swarm->update_state(swarms, decommissioned, events);
+    }
+};
+
+const sispop::sispopd_key_pair_t& sender_key_pair() {
+    static const sispop::sispopd_key_pair_t key_pair{
+        {151, 254, 73, 194, 212, 54, 229, 163, 159, 138, 162,
+         227, 55, 77, 25, 181, 50, 238, 207, 178, 176, 54,
+         126, 170, 111, 112, 50, 121, 227, 78, 193, 2},
+        {227, 91, 124, 245, 5, 120, 69, 40, 71, 64, 175,
+         73, 110, 195, 35, 20, 141, 182, 138, 194, 85, 58,
+         5, 228, 103, 123, 150, 243, 175, 218, 188, 209}};
+    return key_pair;
+}
+
+} // namespace
+
+// What connection_t::validate_snode_request does for a ping from a known
+// snode on a network of 2,000 nodes: look the sender up, check the
+// (cached) signature of the empty body and the rate limit
+BENCH_CASE(swarm_validate_snode_request_2000, 200000) {
+    const auto pk = util::base32z_encode(sender_key_pair().public_key);
+    const std::string pubkey(pk.begin(), pk.end());
+    const sn_record_t sender{9999, pubkey,
+                             util::as_hex(sender_key_pair().public_key), "",
+                             "", "10.0.0.2"};
+    const network_t network(NUM_SWARMS / 5, sender);
+
+    const auto sig =
+        sispop::generate_signature(sispop::hash_data(""), sender_key_pair());
+    std::string raw_sig(sig.c.begin(), sig.c.end());
+    raw_sig.append(sig.r.begin(), sig.r.end());
+    const auto signature = util::base64_encode(raw_sig);
+
+    sispop::SignatureCache cache{2048};
+    RateLimiter rate_limiter;
+    uint64_t unknown = 0;
+
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        const std::string snode_address = pubkey + ".snode";
+        if (!network.swarm->is_fully_funded_node(snode_address) ||
+            !cache.check(signature, sispop::hash_data(""), pubkey)) {
+            unknown++;
+        }
+        bench::do_not_optimize(rate_limiter.should_rate_limit(pubkey));
+    }
+    state.stop();
+
+    state.counters["unknown"] = unknown;
+}
+
+// The other lookups by key, for the node next to the sender
+BENCH_CASE(swarm_find_node_by_ed25519_pk_2000, 200000) {
+    const sn_record_t sender{9999, std::string(52, 'y'), "", "", "",
+                             "10.0.0.2"};
+    const network_t network(NUM_SWARMS / 5, sender);
+    const auto& node = network.swarms[NUM_SWARMS / 10].snodes[0];
+    uint64_t unknown = 0;
+
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        if (!network.swarm->find_node_by_ed25519_pk(
+                node.pubkey_ed25519_hex()) ||
+            !network.swarm->get_node_by_pk(node.pub_key_base32z())) {
+            unknown++;
+        }
+    }
+    state.stop();
+
+    state.counters["unknown"] = unknown;
+}
+
+static size_t heap_in_use() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+    return mallinfo2().uordblks;
+#else
+    return 0;
+#endif
+}
+
+// What on_swarm_update does with a new block's swarms (2,000 nodes), after
+// they are parsed: copying them around, deriving the events and updating
+// the state. The counters show what a copy of all the records costs
+BENCH_CASE(swarm_update_2000, 500) {
+    const sn_record_t extra{9999, std::string(52, 'y'), "", "", "",
+                            "10.0.0.2"};
+    const network_t network(NUM_SWARMS / 5, extra);
+
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        const sispop::all_swarms_t swarms = network.swarms;
+        const auto events = network.swarm->derive_swarm_events(swarms);
+        network.swarm->update_state(swarms, network.decommissioned, events);
+    }
+    state.stop();
+
+    const size_t before = heap_in_use();
+    const sispop::all_swarms_t copy = network.swarms;
+    const size_t heap_bytes = heap_in_use() - before;
+    bench::do_not_optimize(copy);
+
+    size_t nodes = 0;
+    for (const auto& si : copy) {
+        nodes += si.snodes.size();
+    }
+    state.counters["record_bytes"] = sizeof(sn_record_t);
+    state.counters["copy_heap_bytes_per_node"] =
+        static_cast<double>(heap_bytes) / nodes;
+}
+
+namespace {
+
+/// What sispopd returns for get_n_service_nodes on a network of `num_nodes`
+/// nodes in swarms of 5 (5% decommissioned, a few not fully funded), in its
+/// field order
+std::string daemon_response(size_t num_nodes, const std::string& block_hash) {
+    std::mt19937_64 rng(4);
+    std::vector<swarm_id_t> swarm_ids(num_nodes / 5);
+    for (auto& id : swarm_ids) {
+        id = rng() % (INVALID_SWARM_ID - 1);
+    }
+
+    std::string body = R"({"id":"0","jsonrpc":"2.0","result":{)"
+                       R"("service_node_states":[)";
+    for (size_t i = 0; i < num_nodes; ++i) {
+        const bool decommissioned = i % 20 == 19;
+        const swarm_id_t swarm_id =
+            decommissioned ? INVALID_SWARM_ID : swarm_ids[i % swarm_ids.size()];
+        char ip[16];
+        snprintf(ip, sizeof(ip), "10.0.%zu.%zu", i / 256 % 256, i % 256);
+        if (i)
+            body += ',';
+        body += R"({"funded":)";
+        body += i % 50 == 49 ? "false" : "true";
+        body += R"(,"public_ip":")";
+        body += ip;
+        body += R"(","pubkey_ed25519":")" + util::as_hex(random_key(rng));
+        body += R"(","pubkey_x25519":")" + util::as_hex(random_key(rng));
+        body += R"(","service_node_pubkey":")" + util::as_hex(random_key(rng));
+        body += R"(","storage_port":)" + std::to_string(1000 + i);
+        body += R"(,"swarm_id":)" + std::to_string(swarm_id) + '}';
+    }
+    body += R"(],"height":123456,"target_height":123456,"block_hash":")" +
+            block_hash + R"(","hardfork":14,"status":"OK"}})";
+    return body;
+}
+
+} // namespace
+
+// What a swarm timer tick does with a response for a new block (2,000
+// nodes): parse it, derive the events and update the state
+BENCH_CASE(swarm_new_block_2000, 200) {
+    const auto body = std::make_shared<std::string>(
+        daemon_response(NUM_SWARMS, std::string(64, 'a')));
+    const auto first = sispop::parse_swarm_update(body);
+    sispop::Swarm swarm{first.swarms[0].snodes[0]};
+    swarm.set_swarm_id(first.swarms[0].swarm_id);
+
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        const auto bu = sispop::parse_swarm_update(body);
+        const auto events = swarm.derive_swarm_events(bu.swarms);
+        swarm.set_swarm_id(events.our_swarm_id);
+        swarm.update_state(bu.swarms, bu.decommissioned_nodes, events);
+    }
+    state.stop();
+
+    state.counters["response_bytes"] = body->size();
+}
+
+// The same for a response to a later tick within the same block, which is
+// most of them: only the block hash is looked at
+BENCH_CASE(swarm_same_block_2000, 200000) {
+    const std::string block_hash(64, 'a');
+    const auto body = daemon_response(NUM_SWARMS, block_hash);
+    uint64_t new_blocks = 0;
+
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        if (sispop::peek_block_hash(body) != block_hash) {
+            new_blocks++;
+        }
+    }
+    state.stop();
+
+    state.counters["new_blocks"] = new_blocks;
+}
+
+// Only the parse of the same response. `heap_bytes` is what the parsed
+// update holds on to, `dom_heap_bytes` what a DOM of the response would
+BENCH_CASE(swarm_parse_update_2000, 200) {
+    const auto body = std::make_shared<std::string>(
+        daemon_response(NUM_SWARMS, std::string(64, 'a')));
+
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        bench::do_not_optimize(sispop::parse_swarm_update(body));
+    }
+    state.stop();
+
+    const size_t before = heap_in_use();
+    const auto bu = sispop::parse_swarm_update(body);
+    state.counters["heap_bytes"] = heap_in_use() - before;
+
+    const size_t before_dom = heap_in_use();
+    const auto dom = nlohmann::json::parse(*body);
+    state.counters["dom_heap_bytes"] = heap_in_use() - before_dom;
+
+    size_t nodes = bu.decommissioned_nodes.size();
+    for (const auto& si : bu.swarms) {
+        nodes += si.snodes.size();
+    }
+    state.counters["nodes"] = nodes;
+}
@@ -0,0 +1,134 @@
+#include "bench.h"
+
+#include "timer_wheel.h"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <chrono>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+
+using namespace std::chrono_literals;
+
+constexpr size_t NUM_TIMERS = 50000;
+
+/// What the timers' callbacks hold on to (the connection)
+struct owner_t {
+    uint64_t fired = 0;
+};
+
+/// Long-poll and idle timeouts of connections, in random order
+std::vector<std::chrono::milliseconds> make_timeouts() {
+    std::mt19937_64 rng(7);
+    std::uniform_int_distribution<int> ms(15000, 30000);
+    std::vector<std::chrono::milliseconds> timeouts;
+    for (size_t i = 0; i < NUM_TIMERS; ++i) {
+        timeouts.emplace_back(ms(rng));
+    }
+    return timeouts;
+}
+
+/// `NUM_TIMERS` connections waiting for their timeouts, which get replaced
+/// one at a time (a long poll ends and the client polls again)
+template <typename Timer, typename Arm>
+void run_rearm(bench::state_t& state, boost::asio::io_context& ioc,
+               std::vector<std::unique_ptr<Timer>>& timers, Arm arm) {
+    const auto timeouts = make_timeouts();
+    const auto owner = std::make_shared<owner_t>();
+    for (size_t i = 0; i < NUM_TIMERS; ++i) {
+        arm(*timers[i], timeouts[i], owner);
+    }
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        const size_t idx = i % NUM_TIMERS;
+        arm(*timers[idx], timeouts[idx], owner);
+        // Let the io_context run what it has to (cancelled handlers)
+        if (idx % 1000 == 0) {
+            ioc.poll();
+        }
+    }
+    ioc.poll();
+    state.stop();
+    bench::do_not_optimize(owner->fired);
+}
+
+void arm_wheel_timer(sispop::TimerWheel::timer_t& timer,
+                     std::chrono::milliseconds timeout,
+                     const std::shared_ptr<owner_t>& owner) {
+    timer.expires_after(timeout, [owner]() { owner->fired++; });
+}
+
+void arm_asio_timer(boost::asio::steady_timer& timer,
+                    std::chrono::milliseconds timeout,
+                    const std::shared_ptr<owner_t>& owner) {
+    timer.expires_after(timeout);
+    timer.async_wait([owner](const boost::system::error_code& ec) {
+        if (!ec) {
+            owner->fired++;
+        }
+    });
+}
+
+template <typename Timer>
+std::vector<std::unique_ptr<Timer>> make_timers(boost::asio::io_context& ioc) {
+    std::vector<std::unique_ptr<Timer>> timers;
+    for (size_t i = 0; i < NUM_TIMERS; ++i) {
+        timers.push_back(std::make_unique<Timer>(ioc));
+    }
+    return timers;
+}
+
+} // namespace
+
+// Re-arming one of 50,000 pending connection timeouts
+BENCH_CASE(timers_wheel_rearm_50k, 1000000) {
+    boost::asio::io_context ioc;
+    auto timers = make_timers<sispop::TimerWheel::timer_t>(ioc);
+    run_rearm(state, ioc, timers, arm_wheel_timer);
+    state.counters["timer_bytes"] = sizeof(sispop::TimerWheel::timer_t);
+}
+
+BENCH_CASE(timers_asio_rearm_50k, 1000000) {
+    boost::asio::io_context ioc;
+    auto timers = make_timers<boost::asio::steady_timer>(ioc);
+    run_rearm(state, ioc, timers, arm_asio_timer);
+    state.counters["timer_bytes"] = sizeof(boost::asio::steady_timer);
+}
+
+// 50,000 connections arriving (arming their deadlines) and then leaving
+// (cancelling them) before they time out
+template <typename Timer, typename Arm>
+void run_arm_cancel(bench::state_t& state, Arm arm) {
+    boost::asio::io_context ioc;
+    auto timers = make_timers<Timer>(ioc);
+    const auto timeouts = make_timeouts();
+    const auto owner = std::make_shared<owner_t>();
+
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        for (size_t j = 0; j < NUM_TIMERS; ++j) {
+            arm(*timers[j], timeouts[j], owner);
+        }
+        for (size_t j = 0; j < NUM_TIMERS; ++j) {
+            timers[j]->cancel();
+        }
+        ioc.poll();
+    }
+    state.stop();
+
+    state.counters["ns_per_timer"] =
+        std::chrono::duration<double, std::nano>(state.elapsed()).count() /
+        (state.iterations * NUM_TIMERS);
+}
+
+BENCH_CASE(timers_wheel_arm_cancel_50k, 100) {
+    run_arm_cancel<sispop::TimerWheel::timer_t>(state, arm_wheel_timer);
+}
+
+BENCH_CASE(timers_asio_arm_cancel_50k, 100) {
+    run_arm_cancel<boost::asio::steady_timer>(state, arm_asio_timer);
+}
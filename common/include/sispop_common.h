@@ -1,8 +1,11 @@
 #pragma once
 
 #include "spdlog/fmt/ostr.h" // for operator<< overload
+#include <array>
 #include <chrono>
 #include <cstdint>
+#include <cstring>
+#include <memory>
 #include <ostream>
 #include <string>
 #include <vector>
@@ -12,55 +15,65 @@
 // TODO: this should be a proper struct w/o heap allocation!
 using sn_pub_key_t = std::string;
 
-struct sn_record_t {
+/// A service node. Its keys and addresses don't change and are shared by all
+/// copies of a record, so that copying one (and lists of them) is cheap:
+/// it only holds a reference to them, its IPv4 address and its port
+class sn_record_t {
 
+  public:
     // our 32 byte pub keys should always be 52 bytes long in base32z
     static constexpr size_t BASE_LEN = 52;
 
+    using legacy_key_t = std::array<uint8_t, 32>;
+
   private:
-    uint16_t port_;
-    std::string sn_address_; // Snode address (pubkey plus .snode, was used for sispopnet)
-    // TODO: create separate types for different encodings of pubkeys,
-    // so if we confuse them, it will be a compiler error
-    std::string pub_key_base_32z_; // We don't need this! (esp. since it is legacy key)
-    std::string pubkey_x25519_hex_;
-    std::string pubkey_ed25519_hex_;
-    std::string pub_key_hex_; // Monero legacy key
-    std::string ip_; // Snode ip
-
-
-    /// Set service node's public key in base32z (without .snode part)
-    void set_address(const std::string& addr) {
-
-        if (addr.size() != BASE_LEN)
-            throw std::runtime_error("snode public key has incorrect size");
-
-        sn_address_ = addr;
-        sn_address_.append(".snode");
-        pub_key_base_32z_ = addr;
-    }
+    struct keys_t {
+        /// Monero legacy key, which identifies a node
+        legacy_key_t pub_key{};
+        std::string pub_key_hex;
+        // Snode address (pubkey plus .snode, was used for sispopnet)
+        std::string sn_address;
+        // TODO: create separate types for different encodings of pubkeys,
+        // so if we confuse them, it will be a compiler error
+        std::string pub_key_base32z; // We don't need this! (esp. since it is legacy key)
+        std::string pubkey_x25519_hex;
+        std::string pubkey_ed25519_hex;
+    };
+
+    std::shared_ptr<const keys_t> keys_;
+    uint32_t ip_ = 0; // Snode IPv4 (host byte order), 0 if not known yet
+    uint16_t port_ = 0;
+
+    static const std::shared_ptr<const keys_t>& no_keys();
 
   public:
+    /// Throws if `address` (the base32z pubkey without .snode) has the wrong
+    /// size; an `ip` that isn't IPv4 is taken as not known yet
     sn_record_t(uint16_t port, const std::string& address,
                 const std::string& pk_hex, const std::string& pk_x25519,
-                const std::string& pk_ed25519, const std::string& ip)
-        : port_(port), pub_key_hex_(pk_hex), pubkey_x25519_hex_(pk_x25519),
-          pubkey_ed25519_hex_(pk_ed25519), ip_(ip) {
-        set_address(address);
-    }
+                const std::string& pk_ed25519, const std::string& ip);
 
-    sn_record_t() = default;
+    sn_record_t() : keys_(no_keys()) {}
 
     // Sometimes the IP can change
-    void set_ip(const std::string& ip) { ip_ = ip; }
+    void set_ip(const std::string& ip);
+    void set_ip(uint32_t ip) { ip_ = ip; }
 
     uint16_t port() const { return port_; }
-    const std::string& sn_address() const { return sn_address_; }
-    const std::string& pub_key_base32z() const { return pub_key_base_32z_; }
-    const std::string& pub_key_hex() const { return pub_key_hex_; }
-    const std::string& pubkey_x25519_hex() const { return pubkey_x25519_hex_; }
-    const std::string& pubkey_ed25519_hex() const { return pubkey_ed25519_hex_; }
-    const std::string& ip() const { return ip_; }
+    const std::string& sn_address() const { return keys_->sn_address; }
+    const std::string& pub_key_base32z() const { return keys_->pub_key_base32z; }
+    const std::string& pub_key_hex() const { return keys_->pub_key_hex; }
+    const std::string& pubkey_x25519_hex() const { return keys_->pubkey_x25519_hex; }
+    const std::string& pubkey_ed25519_hex() const { return keys_->pubkey_ed25519_hex; }
+    const legacy_key_t& pub_key() const { return keys_->pub_key; }
+    /// Dotted IPv4 address ("0.0.0.0" if not known yet)
+    std::string ip() const;
+    uint32_t ip_v4() const { return ip_; }
+
+    /// Whether both records share the same keys (rather than just equal ones)
+    bool same_keys(const sn_record_t& other) const {
+        return keys_ == other.keys_;
+    }
 
     template <typename OStream>
     friend OStream& operator<<(OStream& os, const sn_record_t& record) {
@@ -69,6 +82,7 @@ struct sn_record_t {
 #else
         os << record.sn_address();
 #endif
+        return os;
     }
 };
 
@@ -163,14 +177,17 @@ namespace std {
 template <>
 struct hash<sn_record_t> {
     std::size_t operator()(const sn_record_t& k) const {
-        return hash<std::string>{}(k.pub_key_hex());
+        // The key is random enough as it is
+        std::size_t h;
+        std::memcpy(&h, k.pub_key().data(), sizeof(h));
+        return h;
     }
 };
 
 } // namespace std
 
 inline bool operator<(const sn_record_t& lhs, const sn_record_t& rhs) {
-    return lhs.pub_key_hex() < rhs.pub_key_hex();
+    return lhs.pub_key() < rhs.pub_key();
 }
 
 #pragma GCC diagnostic push
@@ -185,7 +202,7 @@ static std::ostream& operator<<(std::ostream& os, const sn_record_t& sn) {
 
 static bool operator==(const sn_record_t& lhs, const sn_record_t& rhs) {
     // TODO: Change this to ed keys:
-    return lhs.pub_key_hex() == rhs.pub_key_hex();
+    return lhs.same_keys(rhs) || lhs.pub_key() == rhs.pub_key();
 }
 
 #pragma GCC diagnostic push
@@ -2,10 +2,35 @@
 
 #include "spdlog/spdlog.h"
 
+// Least severe level that is compiled in (set with -DLOG_ACTIVE_LEVEL=...);
+// calls below it compile to nothing, arguments included
+#ifndef SISPOP_LOG_ACTIVE_LEVEL
+#define SISPOP_LOG_ACTIVE_LEVEL SPDLOG_LEVEL_TRACE
+#endif
+
+#define SISPOP_LOG_LEVEL_trace SPDLOG_LEVEL_TRACE
+#define SISPOP_LOG_LEVEL_debug SPDLOG_LEVEL_DEBUG
+#define SISPOP_LOG_LEVEL_info SPDLOG_LEVEL_INFO
+#define SISPOP_LOG_LEVEL_warn SPDLOG_LEVEL_WARN
+#define SISPOP_LOG_LEVEL_error SPDLOG_LEVEL_ERROR
+#define SISPOP_LOG_LEVEL_critical SPDLOG_LEVEL_CRITICAL
+
+#define SISPOP_LOG_ENABLED(LVL)                                                  \
+    (SISPOP_LOG_LEVEL_##LVL >= SISPOP_LOG_ACTIVE_LEVEL)
+
 #define SISPOP_LOG_N(LVL, msg, ...)                                              \
-    spdlog::get("sispop_logger")->LVL("[{}] " msg, __func__, __VA_ARGS__)
+    do {                                                                       \
+        if constexpr (SISPOP_LOG_ENABLED(LVL)) {                               \
+            spdlog::get("sispop_logger")                                         \
+                ->LVL("[{}] " msg, __func__, __VA_ARGS__);                     \
+        }                                                                      \
+    } while (false)
 #define SISPOP_LOG_2(LVL, msg)                                                   \
-    spdlog::get("sispop_logger")->LVL("[{}] " msg, __func__)
+    do {                                                                       \
+        if constexpr (SISPOP_LOG_ENABLED(LVL)) {                               \
+            spdlog::get("sispop_logger")->LVL("[{}] " msg, __func__);            \
+        }                                                                      \
+    } while (false)
 
 #define GET_MACRO(_1, _2, _3, _4, _5, _6, _7, _8, _9, NAME, ...) NAME
 #define SISPOP_LOG(...)                                                          \
@@ -28,9 +53,43 @@ static const LogLevelMap logLevelMap{
 };
 // clang-format on
 
-void init_logging(const std::string& data_dir, LogLevel log_level);
+/// Tuning for the logging pipeline (see `init_logging`)
+struct log_options_t {
+    // Number of entries that can be waiting to be formatted and written;
+    // when full, the oldest entries are dropped. 0 makes logging synchronous.
+    size_t queue_size = 8192;
+    // How often (in seconds) all sinks are flushed
+    uint32_t flush_interval = 1;
+    // Entries at this level or above trigger an immediate flush
+    LogLevel flush_level = LogLevel::err;
+    std::string pattern = "[%Y-%m-%d %H:%M:%S.%e] [%^%l%$] %v";
+};
+
+/// Create a logger writing to `sinks`; unless `options.queue_size` is 0,
+/// formatting and I/O happen on a dedicated thread, so a call site only
+/// pays for enqueueing the entry
+std::shared_ptr<spdlog::logger> create_logger(const std::string& name,
+                                              std::vector<spdlog::sink_ptr> sinks,
+                                              const log_options_t& options);
+
+void init_logging(const std::string& data_dir, LogLevel log_level,
+                  const log_options_t& options = {});
+
+/// Write out the entries still waiting in the async queue and stop the
+/// logging thread. Call it before aborting or exiting with an error, which
+/// would otherwise lose the last entries (those saying why); nothing can be
+/// logged afterwards
+void shutdown_logging();
+
+/// Number of log entries discarded because the async queue was full
+uint64_t get_dropped_log_count();
 
 void print_log_levels();
 
 bool parse_log_level(const std::string& input, LogLevel& logLevel);
+
+/// Least severe level this binary was built to emit (see LOG_ACTIVE_LEVEL)
+constexpr LogLevel compiled_log_level() {
+    return static_cast<LogLevel>(SISPOP_LOG_ACTIVE_LEVEL);
+}
 } // namespace sispop
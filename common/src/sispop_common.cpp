@@ -0,0 +1,85 @@
+#include "sispop_common.h"
+
+#include <cstdio>
+#include <stdexcept>
+
+static uint8_t hex_to_nibble(char ch) {
+    return (ch >= '0' && ch <= '9')
+               ? ch - '0'
+               : (ch >= 'A' && ch <= 'F')
+                     ? ch - 'A' + 10
+                     : (ch >= 'a' && ch <= 'f') ? ch - 'a' + 10 : 0;
+}
+
+/// Dotted decimal IPv4 address in host byte order, 0 if `ip` isn't one
+static uint32_t parse_ipv4(const std::string& ip) {
+
+    uint32_t result = 0;
+    int octets = 0;
+    size_t i = 0;
+
+    while (octets < 4) {
+        uint32_t octet = 0;
+        const size_t start = i;
+        while (i < ip.size() && ip[i] >= '0' && ip[i] <= '9' &&
+               i - start < 3) {
+            octet = octet * 10 + (ip[i] - '0');
+            i++;
+        }
+        if (i == start || octet > 255) {
+            return 0;
+        }
+        result = result << 8 | octet;
+        octets++;
+
+        if (octets < 4) {
+            if (i == ip.size() || ip[i] != '.') {
+                return 0;
+            }
+            i++;
+        }
+    }
+
+    return i == ip.size() ? result : 0;
+}
+
+const std::shared_ptr<const sn_record_t::keys_t>& sn_record_t::no_keys() {
+    static const std::shared_ptr<const keys_t> keys =
+        std::make_shared<keys_t>();
+    return keys;
+}
+
+sn_record_t::sn_record_t(uint16_t port, const std::string& address,
+                         const std::string& pk_hex,
+                         const std::string& pk_x25519,
+                         const std::string& pk_ed25519, const std::string& ip)
+    : ip_(parse_ipv4(ip)), port_(port) {
+
+    if (address.size() != BASE_LEN)
+        throw std::runtime_error("snode public key has incorrect size");
+
+    auto keys = std::make_shared<keys_t>();
+
+    for (size_t i = 0; i < keys->pub_key.size() && 2 * i + 1 < pk_hex.size();
+         ++i) {
+        keys->pub_key[i] =
+            hex_to_nibble(pk_hex[2 * i]) << 4 | hex_to_nibble(pk_hex[2 * i + 1]);
+    }
+
+    keys->pub_key_hex = pk_hex;
+    keys->sn_address = address + ".snode";
+    keys->pub_key_base32z = address;
+    keys->pubkey_x25519_hex = pk_x25519;
+    keys->pubkey_ed25519_hex = pk_ed25519;
+
+    keys_ = std::move(keys);
+}
+
+void sn_record_t::set_ip(const std::string& ip) { ip_ = parse_ipv4(ip); }
+
+std::string sn_record_t::ip() const {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%u.%u.%u.%u", ip_ >> 24, (ip_ >> 16) & 0xff,
+             (ip_ >> 8) & 0xff, ip_ & 0xff);
+    return buf;
+}
@@ -3,6 +3,7 @@
 // clang-format off
 #include "spdlog/sinks/stdout_color_sinks.h"
 #include "spdlog/sinks/rotating_file_sink.h"
+#include "spdlog/async.h"
 #include "dev_sink.h"
 // clang-format on
 #include <boost/filesystem.hpp>
@@ -35,8 +36,47 @@ void print_log_levels() {
     }
 }
 
+std::shared_ptr<spdlog::logger> create_logger(const std::string& name,
+                                              std::vector<spdlog::sink_ptr> sinks,
+                                              const log_options_t& options) {
+
+    std::shared_ptr<spdlog::logger> logger;
+
+    if (options.queue_size == 0) {
+        logger = std::make_shared<spdlog::logger>(name, sinks.begin(),
+                                                  sinks.end());
+    } else {
+        // A single worker keeps entries in order; the pool is shared by all
+        // async loggers, so only create it once
+        if (!spdlog::thread_pool()) {
+            spdlog::init_thread_pool(options.queue_size, 1);
+        }
+        // Never block the io thread on a full queue: drop the oldest entry
+        // instead (counted, see `get_dropped_log_count`)
+        logger = std::make_shared<spdlog::async_logger>(
+            name, sinks.begin(), sinks.end(), spdlog::thread_pool(),
+            spdlog::async_overflow_policy::overrun_oldest);
+    }
+
+    logger->flush_on(options.flush_level);
+
+    return logger;
+}
+
+void shutdown_logging() {
+    // Flushes and drops the loggers, then joins the worker once it is done
+    // with the queue (`flush_on` only queues a flush)
+    spdlog::shutdown();
+}
+
+uint64_t get_dropped_log_count() {
+    const auto pool = spdlog::thread_pool();
+    return pool ? pool->overrun_counter() : 0;
+}
+
 void init_logging(const std::string& data_dir,
-                  spdlog::level::level_enum log_level) {
+                  spdlog::level::level_enum log_level,
+                  const log_options_t& options) {
 
     const std::string log_location =
         (fs::path(data_dir) / "storage.logs").string();
@@ -66,16 +106,14 @@ void init_logging(const std::string& data_dir,
     std::vector<spdlog::sink_ptr> sinks = {console_sink, file_sink,
                                            developer_sink};
 
-    auto logger = std::make_shared<spdlog::logger>("sispop_logger", sinks.begin(),
-                                                   sinks.end());
+    auto logger = create_logger("sispop_logger", std::move(sinks), options);
     logger->set_level(log_level);
-    logger->flush_on(spdlog::level::err);
 
     developer_sink->set_level(spdlog::level::warn);
     spdlog::register_logger(logger);
-    spdlog::flush_every(std::chrono::seconds(1));
+    spdlog::flush_every(std::chrono::seconds(options.flush_interval));
 
-    spdlog::set_pattern("[%Y-%m-%d %H:%M:%S.%e] [%^%l%$] %v");
+    spdlog::set_pattern(options.pattern);
 
     SISPOP_LOG(info,
              "\n**************************************************************"
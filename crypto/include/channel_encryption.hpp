@@ -1,21 +1,73 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
+#include <list>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+/// How a message is encrypted, chosen by the client for each request.
+/// The AEAD modes are authenticated and use a key of their own: the 32
+/// byte BLAKE2b hash of the mode's name ("aes-gcm" or "xchacha20"), the
+/// X25519 shared secret, the client's public key and ours, in that order.
+/// aes-cbc is kept for older clients
+enum class EncryptType {
+    aes_cbc,
+    aes_gcm,
+    xchacha20,
+};
+
+/// Parse "aes-cbc", "aes-gcm" or "xchacha20", throw on anything else
+EncryptType parse_enc_type(const std::string& str);
+
+/// Whether `type` produces authenticated ciphertexts that are sent as they
+/// are (the aes-cbc ones are sent in base64)
+inline bool is_aead(EncryptType type) { return type != EncryptType::aes_cbc; }
+
 template <typename T>
 class ChannelEncryption {
   public:
     ChannelEncryption(const std::vector<uint8_t>& private_key);
     ~ChannelEncryption() = default;
 
-    T encrypt(const T& plainText, const std::string& pubKey) const;
+    T encrypt(const T& plainText, const std::string& pubKey,
+              EncryptType type = EncryptType::aes_cbc) const;
+
+    T decrypt(const T& cipherText, const std::string& pubKey,
+              EncryptType type = EncryptType::aes_cbc) const;
 
-    T decrypt(const T& cipherText, const std::string& pubKey) const;
+    /// Same as above, but write into `output` (replacing its contents), so
+    /// that a buffer can be reused from one message to the next
+    void encrypt(const T& plainText, const std::string& pubKey, T& output,
+                 EncryptType type = EncryptType::aes_cbc) const;
+
+    void decrypt(const T& cipherText, const std::string& pubKey, T& output,
+                 EncryptType type = EncryptType::aes_cbc) const;
 
   private:
-    std::vector<uint8_t>
+    using shared_key_t = std::array<uint8_t, 32>;
+    using public_key_t = std::array<uint8_t, 32>;
+
+    /// What is derived from a client's public key (given in hex)
+    struct peer_keys_t {
+        shared_key_t shared_secret;
+        public_key_t public_key;
+    };
+
+    peer_keys_t peerKeys(const std::string& pubKey) const;
+    shared_key_t
     calculateSharedSecret(const std::vector<uint8_t>& pubKey) const;
     const std::vector<uint8_t> private_key_;
+    public_key_t public_key_;
+
+    // A client uses the same ephemeral key for many requests, so keys
+    // derived recently are kept (by hex public key, most recently used at
+    // the front)
+    using lru_t = std::list<std::pair<std::string, peer_keys_t>>;
+    mutable std::mutex mutex_;
+    mutable lru_t lru_;
+    mutable std::unordered_map<std::string, typename lru_t::iterator> index_;
 };
@@ -3,6 +3,12 @@
 #include "sispopd_key.h"
 
 #include <array>
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace sispop {
 
@@ -18,6 +24,9 @@ struct signature {
 
 hash hash_data(const std::string& data);
 
+/// A uniformly random scalar (modulo the group order), e.g. a signing nonce
+void random_scalar(ec_scalar& k);
+
 signature generate_signature(const hash& prefix_hash,
                              const sispopd_key_pair_t& key_pair);
 
@@ -26,4 +35,65 @@ bool check_signature(const std::string& signature, const hash& hash,
 bool check_signature(const signature& sig, const hash& prefix_hash,
                      const public_key_t& pub);
 
+struct signature_check_t {
+    signature sig;
+    hash prefix_hash;
+    public_key_t pub;
+};
+
+/// Check several signatures at once, which is cheaper than one by one: the
+/// points are normalised with a single field inversion and every distinct
+/// public key is decompressed only once. The result for `checks[i]` is at
+/// index i
+std::vector<bool> check_signatures(const std::vector<signature_check_t>& checks);
+
+/// Decode the arguments of the string version of `check_signature` for
+/// `check_signatures`; false if the signature isn't 64 bytes once decoded
+/// or the public key can't be decoded
+bool decode_signature_check(const std::string& signature, const hash& hash,
+                            const std::string& public_key_b32z,
+                            signature_check_t& check);
+
+/// Signatures that have recently been checked successfully, so that one
+/// seen again (e.g. a retransmitted request) is accepted without redoing
+/// the curve math. Holds at most `capacity` entries, least recently used
+/// ones are dropped first. Thread safe
+class SignatureCache {
+
+    // hash + public key + signature
+    using key_t = std::string;
+
+    mutable std::mutex mutex_;
+    // Most recently used at the front
+    std::list<key_t> lru_;
+    std::unordered_map<key_t, std::list<key_t>::iterator> index_;
+    const size_t capacity_;
+
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+
+    static key_t make_key(const std::string& signature, const hash& hash,
+                          const std::string& public_key_b32z);
+
+  public:
+    explicit SignatureCache(size_t capacity);
+
+    /// Same as `check_signature`, but only for signatures not in the cache
+    bool check(const std::string& signature, const hash& hash,
+               const std::string& public_key_b32z);
+
+    /// Whether the signature is in the cache (counted as a hit or a miss),
+    /// for callers checking signatures themselves
+    bool contains(const std::string& signature, const hash& hash,
+                  const std::string& public_key_b32z);
+
+    /// Remember a signature that has been checked successfully
+    void insert(const std::string& signature, const hash& hash,
+                const std::string& public_key_b32z);
+
+    uint64_t hits() const { return hits_; }
+    uint64_t misses() const { return misses_; }
+    size_t size() const;
+};
+
 } // namespace sispop
@@ -7,25 +7,61 @@
 
 #include "utils.hpp"
 
+#include <cstring>
 #include <exception>
+#include <memory>
 #include <string>
 
 #include <iostream>
 
+// Number of derived keys to keep
+constexpr size_t SHARED_KEY_CACHE_SIZE = 1024;
+
 std::vector<uint8_t> hexToBytes(const std::string& hex) {
     std::vector<uint8_t> temp;
     boost::algorithm::unhex(hex, std::back_inserter(temp));
     return temp;
 }
 
+// One cipher context per thread, set up for AES-256-CBC once and only
+// given a new key and IV for each message
+static EVP_CIPHER_CTX* cipherContext(int enc) {
+    struct ctx_deleter_t {
+        void operator()(EVP_CIPHER_CTX* ctx) const { EVP_CIPHER_CTX_free(ctx); }
+    };
+    static thread_local std::unique_ptr<EVP_CIPHER_CTX, ctx_deleter_t> ctx;
+
+    if (!ctx) {
+        ctx.reset(EVP_CIPHER_CTX_new());
+        if (!ctx || EVP_CipherInit_ex(ctx.get(), EVP_aes_256_cbc(), NULL,
+                                      NULL, NULL, enc) <= 0) {
+            ctx.reset();
+            throw std::runtime_error("Could not create cipher context");
+        }
+    }
+    return ctx.get();
+}
+
 template <typename T>
 ChannelEncryption<T>::ChannelEncryption(const std::vector<uint8_t>& private_key)
-    : private_key_(private_key) {}
+    : private_key_(private_key) {
+    // Detects AES-NI for AES-GCM, can be called any number of times
+    if (sodium_init() < 0) {
+        throw std::runtime_error("Could not initialise libsodium");
+    }
+    if (private_key_.size() != crypto_scalarmult_SCALARBYTES ||
+        crypto_scalarmult_base(public_key_.data(), private_key_.data()) != 0) {
+        throw std::runtime_error("Bad private key");
+    }
+}
 
 template <typename T>
-std::vector<uint8_t> ChannelEncryption<T>::calculateSharedSecret(
+typename ChannelEncryption<T>::shared_key_t
+ChannelEncryption<T>::calculateSharedSecret(
     const std::vector<uint8_t>& pubKey) const {
-    std::vector<uint8_t> sharedSecret(crypto_scalarmult_BYTES);
+    static_assert(crypto_scalarmult_BYTES == sizeof(shared_key_t),
+                  "Wrong shared key size");
+    shared_key_t sharedSecret;
     if (pubKey.size() != crypto_scalarmult_curve25519_BYTES) {
         throw std::runtime_error("Bad pubKey size");
     }
@@ -38,24 +74,51 @@ std::vector<uint8_t> ChannelEncryption<T>::calculateSharedSecret(
 }
 
 template <typename T>
-T ChannelEncryption<T>::encrypt(const T& plaintext,
-                                const std::string& pubKey) const {
-    const std::vector<uint8_t> pubKeyBytes = hexToBytes(pubKey);
-    const std::vector<uint8_t> sharedKey = calculateSharedSecret(pubKeyBytes);
+typename ChannelEncryption<T>::peer_keys_t
+ChannelEncryption<T>::peerKeys(const std::string& pubKey) const {
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto it = index_.find(pubKey);
+        if (it != index_.end()) {
+            lru_.splice(lru_.begin(), lru_, it->second);
+            return it->second->second;
+        }
+    }
+
+    const auto pubKeyBytes = hexToBytes(pubKey);
+    peer_keys_t keys;
+    keys.shared_secret = calculateSharedSecret(pubKeyBytes);
+    // Same size as the shared secret (checked by calculateSharedSecret)
+    std::copy(pubKeyBytes.begin(), pubKeyBytes.end(), keys.public_key.begin());
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (index_.find(pubKey) == index_.end()) {
+        if (lru_.size() >= SHARED_KEY_CACHE_SIZE) {
+            index_.erase(lru_.back().first);
+            lru_.pop_back();
+        }
+        lru_.emplace_front(pubKey, keys);
+        index_.emplace(pubKey, lru_.begin());
+    }
+
+    return keys;
+}
+
+template <typename T>
+static void encryptCBC(const uint8_t* key, const T& plaintext, T& output) {
 
-    // Initialise cipher
-    const EVP_CIPHER* cipher = EVP_aes_256_cbc();
-    const int ivLength = EVP_CIPHER_iv_length(cipher);
+    // Initialise cipher context
+    EVP_CIPHER_CTX* ctx = cipherContext(1);
+    const int ivLength = EVP_CIPHER_CTX_iv_length(ctx);
 
     // Generate IV
-    unsigned char iv[ivLength];
+    unsigned char iv[EVP_MAX_IV_LENGTH];
     if (RAND_bytes(iv, ivLength) != 1) {
         throw std::runtime_error("Could not generate IV");
     }
 
-    // Initialise cipher context
-    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
-    if (EVP_EncryptInit_ex(ctx, cipher, NULL, sharedKey.data(), iv) <= 0) {
+    if (EVP_CipherInit_ex(ctx, NULL, NULL, key, iv, 1) <= 0) {
         throw std::runtime_error("Could not initialise encryption context");
     }
 
@@ -64,11 +127,12 @@ T ChannelEncryption<T>::encrypt(const T& plaintext,
     auto p = reinterpret_cast<const unsigned char*>(plaintext.data());
     const size_t plaintext_len = plaintext.size();
 
-    // Add some padding of 'blockSize' as upper limit
+    // The iv goes first, add some padding of 'blockSize' as upper limit
     const int blockSize = EVP_CIPHER_CTX_block_size(ctx);
-    T output;
-    output.resize(plaintext_len + blockSize);
+    output.resize(ivLength + plaintext_len + blockSize);
     auto o = reinterpret_cast<unsigned char*>(&output[0]);
+    std::memcpy(o, iv, ivLength);
+    o += ivLength;
 
     // Encrypt every full blocks
     if (EVP_EncryptUpdate(ctx, o, &len, p, plaintext_len) <= 0) {
@@ -83,31 +147,24 @@ T ChannelEncryption<T>::encrypt(const T& plaintext,
     ciphertext_len += len;
 
     // Remove excess padding
-    output.resize(ciphertext_len);
-
-    // Insert iv at the start
-    output.insert(output.begin(), iv, iv + ivLength);
-
-    EVP_CIPHER_CTX_free(ctx);
-
-    return output;
+    output.resize(ivLength + ciphertext_len);
 }
 
 template <typename T>
-T ChannelEncryption<T>::decrypt(const T& ciphertextAndIV,
-                                const std::string& pubKey) const {
-    const std::vector<uint8_t> pubKeyBytes = hexToBytes(pubKey);
-    const std::vector<uint8_t> sharedKey = calculateSharedSecret(pubKeyBytes);
+static void decryptCBC(const uint8_t* key, const T& ciphertextAndIV,
+                       T& output) {
 
-    // Initialise cipher
-    const EVP_CIPHER* cipher = EVP_aes_256_cbc();
-    const int ivLength = EVP_CIPHER_iv_length(cipher);
+    // Initialise cipher context
+    EVP_CIPHER_CTX* ctx = cipherContext(0);
+    const int ivLength = EVP_CIPHER_CTX_iv_length(ctx);
 
-    auto inPtr = reinterpret_cast<const unsigned char*>(&ciphertextAndIV[0]);
+    if (ciphertextAndIV.size() < static_cast<size_t>(ivLength)) {
+        throw std::runtime_error("Ciphertext is too short");
+    }
 
-    // Initialise cipher context
-    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
-    if (EVP_DecryptInit_ex(ctx, cipher, NULL, sharedKey.data(), inPtr) <= 0) {
+    auto inPtr = reinterpret_cast<const unsigned char*>(ciphertextAndIV.data());
+
+    if (EVP_CipherInit_ex(ctx, NULL, NULL, key, inPtr, 0) <= 0) {
         throw std::runtime_error("Could not initialise decryption context");
     }
 
@@ -117,7 +174,6 @@ T ChannelEncryption<T>::decrypt(const T& ciphertextAndIV,
 
     // Add some padding of 'blockSize' as upper limit
     const int blockSize = EVP_CIPHER_CTX_block_size(ctx);
-    T output;
     output.resize(ciphertextLength + blockSize);
 
     auto outPtr = reinterpret_cast<unsigned char*>(&output[0]);
@@ -125,7 +181,7 @@ T ChannelEncryption<T>::decrypt(const T& ciphertextAndIV,
     // Decrypt every full blocks
     if (EVP_DecryptUpdate(ctx, outPtr, &len, inPtr + ivLength,
                           ciphertextLength) <= 0) {
-        throw std::runtime_error("Could not initialise decryption context");
+        throw std::runtime_error("Could not decrypt ciphertext");
     }
     plaintextLength += len;
 
@@ -137,11 +193,171 @@ T ChannelEncryption<T>::decrypt(const T& ciphertextAndIV,
 
     // Remove excess bytes
     output.resize(plaintextLength);
+}
+
+// libsodium's AEAD constructions all have this signature
+using aead_encrypt_fn = int (*)(unsigned char*, unsigned long long*,
+                                const unsigned char*, unsigned long long,
+                                const unsigned char*, unsigned long long,
+                                const unsigned char*, const unsigned char*,
+                                const unsigned char*);
+using aead_decrypt_fn = int (*)(unsigned char*, unsigned long long*,
+                                unsigned char*, const unsigned char*,
+                                unsigned long long, const unsigned char*,
+                                unsigned long long, const unsigned char*,
+                                const unsigned char*);
+
+struct aead_t {
+    const char* name;
+    size_t nonce_size;
+    aead_encrypt_fn encrypt;
+    aead_decrypt_fn decrypt;
+};
+
+static_assert(crypto_aead_xchacha20poly1305_ietf_ABYTES ==
+                      crypto_aead_aes256gcm_ABYTES &&
+                  crypto_aead_xchacha20poly1305_ietf_KEYBYTES ==
+                      crypto_aead_aes256gcm_KEYBYTES,
+              "Unexpected AEAD parameters");
+
+constexpr size_t AEAD_TAG_SIZE = crypto_aead_aes256gcm_ABYTES;
+
+static aead_t aead(EncryptType type) {
+    if (type == EncryptType::xchacha20) {
+        return {"xchacha20", crypto_aead_xchacha20poly1305_ietf_NPUBBYTES,
+                crypto_aead_xchacha20poly1305_ietf_encrypt,
+                crypto_aead_xchacha20poly1305_ietf_decrypt};
+    }
+    // libsodium only has a (fast, constant time) AES-GCM with AES-NI
+    if (!crypto_aead_aes256gcm_is_available()) {
+        throw std::runtime_error("AES-GCM is not supported by this node");
+    }
+    return {"aes-gcm", crypto_aead_aes256gcm_NPUBBYTES,
+            crypto_aead_aes256gcm_encrypt, crypto_aead_aes256gcm_decrypt};
+}
 
-    EVP_CIPHER_CTX_free(ctx);
+using aead_key_t = std::array<uint8_t, crypto_aead_aes256gcm_KEYBYTES>;
+
+// A key of its own for each mode, bound to both parties' public keys (like
+// crypto_kx does) rather than the raw curve point
+static aead_key_t aeadKey(const aead_t& aead, const uint8_t* sharedSecret,
+                          const uint8_t* clientKey, const uint8_t* serverKey) {
+    aead_key_t key;
+    crypto_generichash_state state;
+    if (crypto_generichash_init(&state, nullptr, 0, key.size()) != 0 ||
+        crypto_generichash_update(
+            &state, reinterpret_cast<const unsigned char*>(aead.name),
+            std::strlen(aead.name)) != 0 ||
+        crypto_generichash_update(&state, sharedSecret,
+                                  crypto_scalarmult_BYTES) != 0 ||
+        crypto_generichash_update(&state, clientKey,
+                                  crypto_scalarmult_BYTES) != 0 ||
+        crypto_generichash_update(&state, serverKey,
+                                  crypto_scalarmult_BYTES) != 0 ||
+        crypto_generichash_final(&state, key.data(), key.size()) != 0) {
+        throw std::runtime_error("Could not derive encryption key");
+    }
+    return key;
+}
+
+// nonce || ciphertext || tag, encrypted in one pass
+template <typename T>
+static void encryptAEAD(const aead_t& aead, const aead_key_t& key,
+                        const T& plaintext, T& output) {
+
+    output.resize(aead.nonce_size + plaintext.size() + AEAD_TAG_SIZE);
+    auto o = reinterpret_cast<unsigned char*>(output.data());
+    randombytes_buf(o, aead.nonce_size);
+
+    unsigned long long len;
+    aead.encrypt(o + aead.nonce_size, &len,
+                 reinterpret_cast<const unsigned char*>(plaintext.data()),
+                 plaintext.size(), nullptr, 0, nullptr, o, key.data());
+}
+
+template <typename T>
+static void decryptAEAD(const aead_t& aead, const aead_key_t& key,
+                        const T& ciphertext, T& output) {
+
+    if (ciphertext.size() < aead.nonce_size + AEAD_TAG_SIZE) {
+        throw std::runtime_error("Ciphertext is too short");
+    }
+
+    auto in = reinterpret_cast<const unsigned char*>(ciphertext.data());
+    output.resize(ciphertext.size() - aead.nonce_size - AEAD_TAG_SIZE);
+
+    unsigned long long len;
+    if (aead.decrypt(reinterpret_cast<unsigned char*>(output.data()), &len,
+                     nullptr, in + aead.nonce_size,
+                     ciphertext.size() - aead.nonce_size, nullptr, 0, in,
+                     key.data()) != 0) {
+        throw std::runtime_error("Could not decrypt ciphertext");
+    }
+}
+
+EncryptType parse_enc_type(const std::string& str) {
+    if (str == "aes-cbc") {
+        return EncryptType::aes_cbc;
+    }
+    if (str == "aes-gcm") {
+        return EncryptType::aes_gcm;
+    }
+    if (str == "xchacha20") {
+        return EncryptType::xchacha20;
+    }
+    throw std::runtime_error("Unknown encryption type: " + str);
+}
+
+template <typename T>
+T ChannelEncryption<T>::encrypt(const T& plaintext, const std::string& pubKey,
+                                EncryptType type) const {
+    T output;
+    encrypt(plaintext, pubKey, output, type);
     return output;
 }
 
+template <typename T>
+void ChannelEncryption<T>::encrypt(const T& plaintext,
+                                   const std::string& pubKey, T& output,
+                                   EncryptType type) const {
+    const peer_keys_t keys = peerKeys(pubKey);
+
+    if (is_aead(type)) {
+        const aead_t mode = aead(type);
+        encryptAEAD(mode,
+                    aeadKey(mode, keys.shared_secret.data(),
+                            keys.public_key.data(), public_key_.data()),
+                    plaintext, output);
+    } else {
+        encryptCBC(keys.shared_secret.data(), plaintext, output);
+    }
+}
+
+template <typename T>
+T ChannelEncryption<T>::decrypt(const T& ciphertext, const std::string& pubKey,
+                                EncryptType type) const {
+    T output;
+    decrypt(ciphertext, pubKey, output, type);
+    return output;
+}
+
+template <typename T>
+void ChannelEncryption<T>::decrypt(const T& ciphertext,
+                                   const std::string& pubKey, T& output,
+                                   EncryptType type) const {
+    const peer_keys_t keys = peerKeys(pubKey);
+
+    if (is_aead(type)) {
+        const aead_t mode = aead(type);
+        decryptAEAD(mode,
+                    aeadKey(mode, keys.shared_secret.data(),
+                            keys.public_key.data(), public_key_.data()),
+                    ciphertext, output);
+    } else {
+        decryptCBC(keys.shared_secret.data(), ciphertext, output);
+    }
+}
+
 // explicit template specialization
 template class ChannelEncryption<std::string>;
 
@@ -15,6 +15,8 @@ extern "C" {
 #include <cstdint>
 #include <cstring> // for memcmp
 #include <iterator>
+#include <map>
+#include <memory>
 #include <string>
 
 static_assert(crypto_generichash_BYTES == sispop::HASH_SIZE, "Wrong hash size!");
@@ -29,13 +31,11 @@ struct s_comm {
 };
 
 void random_scalar(ec_scalar& k) {
-    for (size_t i = 0; i < k.size() / 4; ++i) {
-        const uint32_t random = randombytes_random();
-        k[i + 0] = (random & 0xFF000000) >> 24;
-        k[i + 1] = (random & 0x00FF0000) >> 16;
-        k[i + 2] = (random & 0x0000FF00) >> 8;
-        k[i + 3] = (random & 0x000000FF) >> 0;
-    }
+    // Reduced from 64 bytes so that it's uniform modulo the group order
+    uint8_t random[64];
+    randombytes_buf(random, sizeof(random));
+    sc_reduce(random);
+    std::copy_n(std::begin(random), k.size(), k.begin());
 }
 
 bool hash_to_scalar(const void* input, size_t size, ec_scalar& output) {
@@ -44,6 +44,17 @@ bool hash_to_scalar(const void* input, size_t size, ec_scalar& output) {
     return true;
 }
 
+// Table for ge_scalarmult_base_w5, built on first use
+static const ge_precomp (*base_w5_table())[16] {
+    static const std::unique_ptr<ge_precomp[][16]> table = []() {
+        std::unique_ptr<ge_precomp[][16]> table(
+            new ge_precomp[GE_BASE_W5_ROWS][16]);
+        ge_base_w5_init(table.get());
+        return table;
+    }();
+    return table.get();
+}
+
 hash hash_data(const std::string& data) {
     hash hash{{0}};
     crypto_generichash(hash.data(), hash.size(),
@@ -75,7 +86,7 @@ try_again:
     random_scalar(k);
     if (k[7] == 0) // we don't want tiny numbers here
         goto try_again;
-    ge_scalarmult_base(&tmp3, k.data());
+    ge_scalarmult_base_w5(&tmp3, k.data(), base_w5_table());
     ge_p3_tobytes(buf.comm, &tmp3);
     hash_to_scalar(&buf, sizeof(s_comm), sig.c);
     if (!sc_isnonzero((const unsigned char*)sig.c.data()))
@@ -87,6 +98,78 @@ try_again:
     return sig;
 }
 
+std::vector<bool> check_signatures(const std::vector<signature_check_t>& checks) {
+
+    std::vector<bool> valid(checks.size(), false);
+
+    // Decompressing a key costs a square root, a batch of pushes usually
+    // comes from a handful of snodes
+    std::map<public_key_t, std::pair<bool, ge_p3>> keys;
+
+    // R' = c*P + r*G for the checks that got that far
+    std::vector<ge_p2> points;
+    std::vector<size_t> indices;
+    points.reserve(checks.size());
+    indices.reserve(checks.size());
+
+    for (size_t i = 0; i < checks.size(); ++i) {
+        const auto& sig = checks[i].sig;
+        if (sc_check(sig.c.data()) != 0 || sc_check(sig.r.data()) != 0 ||
+            !sc_isnonzero(sig.c.data())) {
+            continue;
+        }
+
+        auto it = keys.find(checks[i].pub);
+        if (it == keys.end()) {
+            std::pair<bool, ge_p3> key;
+            key.first =
+                ge_frombytes_vartime(&key.second, checks[i].pub.data()) == 0;
+            it = keys.emplace(checks[i].pub, key).first;
+        }
+        if (!it->second.first) {
+            continue;
+        }
+
+        points.emplace_back();
+        ge_double_scalarmult_base_vartime(&points.back(), sig.c.data(),
+                                          &it->second.second, sig.r.data());
+        indices.push_back(i);
+    }
+
+    if (points.empty()) {
+        return valid;
+    }
+
+    std::vector<uint8_t> comms(points.size() * 32);
+    std::unique_ptr<fe[]> scratch(new fe[points.size()]);
+    ge_tobytes_batch(comms.data(), points.data(), scratch.get(),
+                     points.size());
+
+    static const ec_point infinity = {{1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                       0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                       0, 0, 0, 0, 0, 0, 0, 0, 0, 0}};
+
+    for (size_t k = 0; k < indices.size(); ++k) {
+        const auto& check = checks[indices[k]];
+        const uint8_t* comm = comms.data() + k * 32;
+        if (memcmp(comm, &infinity, 32) == 0) {
+            continue;
+        }
+
+        s_comm buf;
+        ec_scalar c;
+        std::copy(check.prefix_hash.begin(), check.prefix_hash.end(),
+                  std::begin(buf.h));
+        std::copy(check.pub.begin(), check.pub.end(), std::begin(buf.key));
+        std::copy_n(comm, 32, std::begin(buf.comm));
+        hash_to_scalar(&buf, sizeof(s_comm), c);
+        sc_sub(c.data(), c.data(), check.sig.c.data());
+        valid[indices[k]] = sc_isnonzero(c.data()) == 0;
+    }
+
+    return valid;
+}
+
 bool check_signature(const signature& sig, const hash& prefix_hash,
                      const public_key_t& pub) {
     ge_p2 tmp2;
@@ -115,22 +198,101 @@ bool check_signature(const signature& sig, const hash& prefix_hash,
     return sc_isnonzero(c.data()) == 0;
 }
 
-bool check_signature(const std::string& signature, const hash& hash,
-                     const std::string& public_key_b32z) {
+bool decode_signature_check(const std::string& signature, const hash& hash,
+                            const std::string& public_key_b32z,
+                            signature_check_t& check) {
     // convert signature
     const std::string raw_signature =
         util::base64_decode(signature);
-    struct signature sig;
-    std::copy_n(raw_signature.begin(), sig.c.size(), sig.c.begin());
-    std::copy_n(raw_signature.begin() + sig.c.size(), sig.r.size(),
-                sig.r.begin());
+    if (raw_signature.size() != check.sig.c.size() + check.sig.r.size()) {
+        return false;
+    }
+    std::copy_n(raw_signature.begin(), check.sig.c.size(),
+                check.sig.c.begin());
+    std::copy_n(raw_signature.begin() + check.sig.c.size(),
+                check.sig.r.size(), check.sig.r.begin());
+
+    check.prefix_hash = hash;
 
     // convert public key
-    public_key_t public_key;
-    if (!util::base32z_decode(public_key_b32z, public_key))
+    return util::base32z_decode(public_key_b32z, check.pub);
+}
+
+bool check_signature(const std::string& signature, const hash& hash,
+                     const std::string& public_key_b32z) {
+    signature_check_t check;
+    if (!decode_signature_check(signature, hash, public_key_b32z, check))
         return false;
 
-    return check_signature(sig, hash, public_key);
+    return check_signature(check.sig, check.prefix_hash, check.pub);
+}
+
+SignatureCache::SignatureCache(size_t capacity) : capacity_(capacity) {}
+
+SignatureCache::key_t SignatureCache::make_key(
+    const std::string& signature, const hash& hash,
+    const std::string& public_key_b32z) {
+    // The hash has a fixed size and the public key can't contain '\n'
+    key_t key;
+    key.reserve(hash.size() + public_key_b32z.size() + 1 + signature.size());
+    key.append(reinterpret_cast<const char*>(hash.data()), hash.size());
+    key.append(public_key_b32z);
+    key.push_back('\n');
+    key.append(signature);
+    return key;
+}
+
+bool SignatureCache::check(const std::string& signature, const hash& hash,
+                           const std::string& public_key_b32z) {
+
+    if (contains(signature, hash, public_key_b32z)) {
+        return true;
+    }
+
+    if (!check_signature(signature, hash, public_key_b32z)) {
+        return false;
+    }
+
+    insert(signature, hash, public_key_b32z);
+    return true;
+}
+
+bool SignatureCache::contains(const std::string& signature, const hash& hash,
+                              const std::string& public_key_b32z) {
+
+    const key_t key = make_key(signature, hash, public_key_b32z);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = index_.find(key);
+    if (it == index_.end()) {
+        misses_++;
+        return false;
+    }
+    lru_.splice(lru_.begin(), lru_, it->second);
+    hits_++;
+    return true;
+}
+
+void SignatureCache::insert(const std::string& signature, const hash& hash,
+                            const std::string& public_key_b32z) {
+
+    key_t key = make_key(signature, hash, public_key_b32z);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (capacity_ == 0 || index_.find(key) != index_.end()) {
+        return;
+    }
+    if (lru_.size() >= capacity_) {
+        index_.erase(lru_.back());
+        lru_.pop_back();
+    }
+    lru_.push_front(std::move(key));
+    index_.emplace(lru_.front(), lru_.begin());
+}
+
+size_t SignatureCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lru_.size();
 }
 
 } // namespace sispop
@@ -23,11 +23,23 @@ void command_line_parser::parse_args(int argc, char* argv[]) {
         ("data-dir", po::value(&options_.data_dir), "Path to persistent data (defaults to ~/.sispop/storage)")
         ("config-file", po::value(&config_file), "Path to custom config file (defaults to `storage-server.conf' inside --data-dir)")
         ("log-level", po::value(&options_.log_level), "Log verbosity level, see Log Levels below for accepted values")
+        ("log-queue-size", po::value(&options_.log_queue_size), "Number of log entries buffered for the logging thread (0 to log synchronously)")
+        ("log-flush-interval", po::value(&options_.log_flush_interval), "How often (in seconds) logs are flushed to disk")
+        ("log-flush-level", po::value(&options_.log_flush_level), "Log level at which entries are flushed immediately")
+        ("log-pattern", po::value(&options_.log_pattern), "Custom log entry format (spdlog pattern syntax)")
         ("sispopd-rpc-ip", po::value(&options_.sispopd_rpc_port), "RPC IP on which the local Sispop daemon is listening (usually localhost)")
         ("sispopd-rpc-port", po::value(&options_.sispopd_rpc_port), "RPC port on which the local Sispop daemon is listening")
         ("testnet", po::bool_switch(&options_.testnet), "Start storage server in testnet mode")
         ("force-start", po::bool_switch(&options_.force_start), "Ignore the initialisation ready check")
         ("bind-ip", po::value(&options_.ip)->default_value("0.0.0.0"), "IP to which to bind the server")
+        ("threads", po::value(&options_.threads), "Number of threads serving connections")
+        ("tls-session-cache-size", po::value(&options_.tls_session_cache_size), "Number of TLS sessions cached for resumption (0 to disable the cache)")
+        ("tls-session-timeout", po::value(&options_.tls_session_timeout), "How long (in seconds) a TLS session can be resumed for")
+        ("tls-ticket-key-rotation", po::value(&options_.tls_ticket_key_rotation), "How often (in seconds) the TLS session ticket key is replaced (0 to disable tickets)")
+        ("keep-alive-timeout", po::value(&options_.keep_alive_timeout), "How long (in seconds) an idle client connection is kept open")
+        ("keep-alive-max-requests", po::value(&options_.keep_alive_max_requests), "Number of requests served on one client connection before it is closed (0 to disable keep-alive)")
+        ("peer-connection-pool-size", po::value(&options_.peer_connection_pool_size), "Number of idle connections kept open to each service node (0 to disable pooling)")
+        ("enforce-peer-signatures", po::bool_switch(&options_.enforce_peer_signatures), "Reject responses from service nodes whose certificate signature doesn't verify (otherwise they are only counted)")
         ("version,v", po::bool_switch(&options_.print_version), "Print the version of this binary")
         ("help", po::bool_switch(&options_.print_help),"Shows this help message");
         // Add hidden ip and port options.  You technically can use the `--ip=` and `--port=` with
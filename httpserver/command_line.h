@@ -14,7 +14,19 @@ struct command_line_options {
     bool print_help = false;
     bool testnet = false;
     std::string ip;
+    unsigned threads = 1;
+    size_t tls_session_cache_size = 20000;
+    uint32_t tls_session_timeout = 3600;     // seconds
+    uint32_t tls_ticket_key_rotation = 3600; // seconds
+    uint32_t keep_alive_timeout = 15;        // seconds
+    uint32_t keep_alive_max_requests = 100;
+    size_t peer_connection_pool_size = 2;
+    bool enforce_peer_signatures = false;
     std::string log_level = "info";
+    size_t log_queue_size = 8192;
+    uint32_t log_flush_interval = 1; // seconds
+    std::string log_flush_level = "error";
+    std::string log_pattern;
     std::string data_dir;
     std::string sispopd_key; // test only (but needed for backwards compatibility)
     std::string sispopd_x25519_key; // test only
@@ -0,0 +1,130 @@
+#include "dns_resolver.h"
+
+#include "sispop_logger.h"
+
+#include <boost/asio/post.hpp>
+
+namespace sispop {
+
+using tcp = boost::asio::ip::tcp;
+
+// getaddrinfo doesn't tell us the records' TTL, this is short enough for
+// the few names we use (the file server and sispopd, if not an IP)
+constexpr auto DNS_CACHE_TTL = std::chrono::minutes(5);
+
+static endpoints_t with_port(endpoints_t endpoints, uint16_t port) {
+    for (auto& endpoint : endpoints) {
+        endpoint.port(port);
+    }
+    return endpoints;
+}
+
+DnsResolver::DnsResolver(std::chrono::milliseconds ttl, lookup_fn_t lookup)
+    : ttl_(ttl), lookup_(std::move(lookup)) {}
+
+void DnsResolver::resolve(boost::asio::io_context& ioc,
+                          const std::string& host, uint16_t port,
+                          resolve_callback_t cb) {
+
+    // Snodes are always given by their IP
+    boost::system::error_code ec;
+    const auto address = boost::asio::ip::make_address(host, ec);
+    if (!ec) {
+        cb(ec, endpoints_t{tcp::endpoint{address, port}});
+        return;
+    }
+
+    endpoints_t cached;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        const auto it = cache_.find(host);
+        if (it != cache_.end() &&
+            std::chrono::steady_clock::now() < it->second.expiry) {
+            cached = it->second.endpoints;
+        } else {
+            if (it != cache_.end()) {
+                cache_.erase(it);
+            }
+
+            auto& waiters = pending_[host];
+            waiters.push_back({&ioc, port, std::move(cb)});
+            if (waiters.size() > 1) {
+                // Somebody is already looking it up
+                return;
+            }
+        }
+    }
+
+    if (!cached.empty()) {
+        cb({}, with_port(std::move(cached), port));
+        return;
+    }
+
+    SISPOP_LOG(debug, "Resolving {}", host);
+
+    lookup_(ioc, host,
+            [this, host](const boost::system::error_code& ec,
+                         endpoints_t endpoints) {
+                on_lookup(host, ec, std::move(endpoints));
+            });
+}
+
+void DnsResolver::on_lookup(const std::string& host,
+                            const boost::system::error_code& ec,
+                            endpoints_t endpoints) {
+
+    std::vector<waiter_t> waiters;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        const auto it = pending_.find(host);
+        if (it != pending_.end()) {
+            waiters = std::move(it->second);
+            pending_.erase(it);
+        }
+
+        // Failures are not cached, the next request tries again
+        if (!ec && !endpoints.empty()) {
+            cache_[host] = {endpoints, std::chrono::steady_clock::now() + ttl_};
+        }
+    }
+
+    if (ec) {
+        SISPOP_LOG(error, "DNS resolution error for {}: {}", host,
+                   ec.message());
+    }
+
+    for (auto& waiter : waiters) {
+        boost::asio::post(*waiter.ioc,
+                          [ec, endpoints = with_port(endpoints, waiter.port),
+                           cb = std::move(waiter.cb)]() { cb(ec, endpoints); });
+    }
+}
+
+void DnsResolver::system_lookup(boost::asio::io_context& ioc,
+                                const std::string& host,
+                                resolve_callback_t cb) {
+
+    auto resolver = std::make_shared<tcp::resolver>(ioc);
+
+    resolver->async_resolve(
+        host, "0", tcp::resolver::numeric_service,
+        [resolver, cb = std::move(cb)](const boost::system::error_code& ec,
+                                       tcp::resolver::results_type results) {
+            endpoints_t endpoints;
+            for (const auto& result : results) {
+                endpoints.push_back(result.endpoint());
+            }
+            cb(ec, std::move(endpoints));
+        });
+}
+
+DnsResolver& get_dns_resolver() {
+    static DnsResolver resolver{DNS_CACHE_TTL};
+    return resolver;
+}
+
+} // namespace sispop
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace sispop {
+
+using endpoints_t = std::vector<boost::asio::ip::tcp::endpoint>;
+using resolve_callback_t =
+    std::function<void(const boost::system::error_code&, endpoints_t)>;
+
+/// Resolves host names for outbound requests without ever blocking the
+/// calling thread: literal addresses are used as they are, names are looked
+/// up asynchronously and remembered for `ttl`. Concurrent lookups of the
+/// same name are merged into one
+class DnsResolver {
+
+  public:
+    /// Look up the addresses of `host` (with port 0), completing on `ioc`
+    using lookup_fn_t =
+        std::function<void(boost::asio::io_context& ioc,
+                           const std::string& host, resolve_callback_t cb)>;
+
+    explicit DnsResolver(std::chrono::milliseconds ttl,
+                         lookup_fn_t lookup = system_lookup);
+
+    /// Call `cb` with the endpoints of `host`:`port`: immediately for a
+    /// literal address or a cached name, otherwise on `ioc` once the lookup
+    /// is done
+    void resolve(boost::asio::io_context& ioc, const std::string& host,
+                 uint16_t port, resolve_callback_t cb);
+
+    /// getaddrinfo, which asio runs on a thread of its own
+    static void system_lookup(boost::asio::io_context& ioc,
+                              const std::string& host, resolve_callback_t cb);
+
+  private:
+    struct entry_t {
+        endpoints_t endpoints;
+        std::chrono::steady_clock::time_point expiry;
+    };
+
+    struct waiter_t {
+        boost::asio::io_context* ioc;
+        uint16_t port;
+        resolve_callback_t cb;
+    };
+
+    const std::chrono::milliseconds ttl_;
+    const lookup_fn_t lookup_;
+
+    // Requests are made from the service node and from every thread
+    // serving connections
+    std::mutex mutex_;
+    std::unordered_map<std::string, entry_t> cache_;
+    std::unordered_map<std::string, std::vector<waiter_t>> pending_;
+
+    void on_lookup(const std::string& host,
+                   const boost::system::error_code& ec, endpoints_t endpoints);
+};
+
+DnsResolver& get_dns_resolver();
+
+} // namespace sispop
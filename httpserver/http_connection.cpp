@@ -10,13 +10,16 @@
 #include "server_certificates.h"
 #include "service_node.h"
 #include "signature.h"
+#include "signature_batcher.h"
 #include "utils.hpp"
 
 // needed for proxy requests
 #include "https_client.h"
 
+#include <atomic>
 #include <cstdlib>
 #include <ctime>
+#include <exception>
 #include <functional>
 #include <iostream>
 #include <openssl/sha.h>
@@ -67,34 +70,47 @@ std::shared_ptr<request_t> build_post_request(const char* target,
     return req;
 }
 
+// A retried push batch is a few hundred bytes of key, enough to cover
+// the retransmissions from a swarm's worth of peers
+constexpr size_t SNODE_SIGNATURE_CACHE_SIZE = 2048;
+
+SignatureCache& get_snode_signature_cache() {
+    static SignatureCache cache{SNODE_SIGNATURE_CACHE_SIZE};
+    return cache;
+}
+
 void make_http_request(boost::asio::io_context& ioc,
                        const std::string& sn_address, uint16_t port,
                        const std::shared_ptr<request_t>& req,
                        http_callback_t&& cb) {
 
-    error_code ec;
-    tcp::endpoint endpoint;
-    tcp::resolver resolver(ioc);
 #ifdef INTEGRATION_TEST
-    tcp::resolver::iterator destination =
-        resolver.resolve("0.0.0.0", "http", ec);
+    const std::string host = "0.0.0.0";
 #else
-    tcp::resolver::iterator destination =
-        resolver.resolve(sn_address, "http", ec);
+    const std::string& host = sn_address;
 #endif
-    while (destination != tcp::resolver::iterator()) {
-        const tcp::endpoint thisEndpoint = (destination++)->endpoint();
-        if (!thisEndpoint.address().is_v4()) {
-            continue;
+
+    auto on_resolve = [&ioc, req, cb = std::move(cb)](
+                          const error_code& ec, endpoints_t endpoints) mutable {
+        if (ec) {
+            cb(sn_response_t{SNodeError::NO_REACH, nullptr});
+            return;
+        }
+
+        tcp::endpoint endpoint;
+        for (const auto& candidate : endpoints) {
+            if (candidate.address().is_v4()) {
+                endpoint = candidate;
+            }
         }
-        endpoint = thisEndpoint;
-    }
-    endpoint.port(port);
 
-    auto session =
-        std::make_shared<HttpClientSession>(ioc, endpoint, req, std::move(cb));
+        auto session = std::make_shared<HttpClientSession>(ioc, endpoint, req,
+                                                           std::move(cb));
 
-    session->start();
+        session->start();
+    };
+
+    get_dns_resolver().resolve(ioc, host, port, std::move(on_resolve));
 }
 
 // ======================== Sispopd Client ========================
@@ -193,34 +209,50 @@ SispopdClient::wait_for_privkey() {
 
 namespace http_server {
 
-// "Loop" forever accepting new connections.
+using net_iocs_t = std::vector<boost::asio::io_context*>;
+
+// "Loop" forever accepting new connections, handing them out to the
+// io_contexts in `net_iocs` in turn
 static void
-accept_connection(boost::asio::io_context& ioc,
+accept_connection(const net_iocs_t& net_iocs, size_t next_ioc,
+                  boost::asio::steady_timer& acceptor_timer,
                   boost::asio::ssl::context& ssl_ctx, tcp::acceptor& acceptor,
                   ServiceNode& sn,
                   ChannelEncryption<std::string>& channel_encryption,
-                  RateLimiter& rate_limiter, const Security& security) {
+                  RateLimiter& rate_limiter, const Security& security,
+                  const keep_alive_options_t& keep_alive) {
 
-    static boost::asio::steady_timer acceptor_timer(ioc);
     constexpr std::chrono::milliseconds ACCEPT_DELAY = 50ms;
 
-    acceptor.async_accept([&](const error_code& ec, tcp::socket socket) {
+    auto& ioc = *net_iocs[next_ioc];
+
+    acceptor.async_accept(ioc, [&, next_ioc](const error_code& ec,
+                                             tcp::socket socket) {
         SISPOP_LOG(trace, "connection accepted");
+        if (ec == boost::asio::error::operation_aborted) {
+            // Shutting down (see `run`)
+            return;
+        }
         if (!ec) {
 
-            std::make_shared<connection_t>(ioc, ssl_ctx, std::move(socket), sn,
-                                           channel_encryption, rate_limiter,
-                                           security)
-                ->start();
+            auto conn = std::make_shared<connection_t>(
+                ioc, ssl_ctx, std::move(socket), sn, channel_encryption,
+                rate_limiter, security, keep_alive);
 
-            accept_connection(ioc, ssl_ctx, acceptor, sn, channel_encryption,
-                              rate_limiter, security);
+            // The connection is only ever handled by the thread running `ioc`
+            boost::asio::dispatch(ioc, [conn]() { conn->start(); });
+
+            accept_connection(net_iocs, (next_ioc + 1) % net_iocs.size(),
+                              acceptor_timer, ssl_ctx, acceptor, sn,
+                              channel_encryption, rate_limiter, security,
+                              keep_alive);
         } else {
 
             // TODO: remove this once we confirmed that there is
             // no more socket leaking
             if (ec == boost::system::errc::too_many_files_open) {
                 SISPOP_LOG(critical, "Too many open files, aborting");
+                sispop::shutdown_logging();
                 abort();
             }
 
@@ -233,16 +265,21 @@ accept_connection(boost::asio::io_context& ioc,
             // If we fail here we are unlikely to be able to accept a new
             // connection immediately, hence the delay
             acceptor_timer.expires_after(ACCEPT_DELAY);
-            acceptor_timer.async_wait([&](const error_code& ec) {
-                if (ec && ec != boost::asio::error::operation_aborted) {
+            acceptor_timer.async_wait([&, next_ioc](const error_code& ec) {
+                if (ec == boost::asio::error::operation_aborted) {
+                    return;
+                }
+                if (ec) {
                     // Not sure how to recover here, so it is probably the
                     // safest to simply abort and let the launcher/systemd
                     // restart us
+                    sispop::shutdown_logging();
                     abort();
                 }
 
-                accept_connection(ioc, ssl_ctx, acceptor, sn,
-                                  channel_encryption, rate_limiter, security);
+                accept_connection(net_iocs, next_ioc, acceptor_timer, ssl_ctx,
+                                  acceptor, sn, channel_encryption,
+                                  rate_limiter, security, keep_alive);
             });
         }
     });
@@ -251,25 +288,121 @@ accept_connection(boost::asio::io_context& ioc,
 void run(boost::asio::io_context& ioc, const std::string& ip, uint16_t port,
          const boost::filesystem::path& base_path, ServiceNode& sn,
          ChannelEncryption<std::string>& channel_encryption,
-         RateLimiter& rate_limiter, Security& security) {
+         RateLimiter& rate_limiter, Security& security, unsigned threads,
+         const tls_session_options_t& tls_options,
+         const keep_alive_options_t& keep_alive) {
 
     SISPOP_LOG(trace, "http server run");
 
     const auto address =
         boost::asio::ip::make_address(ip); /// throws if incorrect
 
-    tcp::acceptor acceptor{ioc, {address, port}};
-
     ssl::context ssl_ctx{ssl::context::tlsv12};
 
     load_server_certificate(base_path, ssl_ctx);
 
+    const auto ticket_keys =
+        enable_session_resumption(ssl_ctx, ioc, tls_options);
+
     security.generate_cert_signature();
 
-    accept_connection(ioc, ssl_ctx, acceptor, sn, channel_encryption,
-                      rate_limiter, security);
+    // Only once the certificate and its signature are there to be checked
+    tcp::acceptor acceptor{ioc, {address, port}};
+
+    // With more than one thread, connections are spread over as many
+    // single-threaded io_contexts, each run by its own thread; `ioc` keeps
+    // running the acceptor and the service node
+    std::vector<std::unique_ptr<boost::asio::io_context>> conn_iocs;
+    net_iocs_t net_iocs;
+
+    if (threads > 1) {
+        for (unsigned i = 0; i < threads; ++i) {
+            conn_iocs.push_back(std::make_unique<boost::asio::io_context>(1));
+            net_iocs.push_back(conn_iocs.back().get());
+        }
+    } else {
+        net_iocs.push_back(&ioc);
+    }
+
+    SISPOP_LOG(info, "Serving connections on {} thread(s)", net_iocs.size());
+
+    // Connection threads might be waiting on the service node (see
+    // ServiceNode::run_on_ioc) until they are done, so `ioc` keeps running
+    // until then. Only touched on `ioc`
+    bool shutting_down = false;
+    std::atomic<size_t> conn_threads_running{conn_iocs.size()};
+    std::vector<std::thread> conn_threads;
+
+    for (auto& conn_ioc : conn_iocs) {
+        conn_threads.emplace_back([&ioc, &conn_ioc = *conn_ioc, &sn,
+                                   &conn_threads_running, &shutting_down]() {
+            sn.mark_network_thread();
+
+            try {
+                const auto work = boost::asio::make_work_guard(conn_ioc);
+                conn_ioc.run();
+            } catch (const std::exception& e) {
+                SISPOP_LOG(critical,
+                           "Exception caught in a connection thread: {}",
+                           e.what());
+            } catch (...) {
+                SISPOP_LOG(critical,
+                           "Unknown exception caught in a connection thread");
+            }
+
+            // Only stopped explicitly (or by an exception): take everything
+            // down with us, or let `ioc` go once the last one is done
+            const bool last = --conn_threads_running == 0;
+            boost::asio::post(ioc, [&ioc, &shutting_down, last]() {
+                if (last || !shutting_down) {
+                    ioc.stop();
+                }
+            });
+        });
+    }
+
+    boost::asio::steady_timer acceptor_timer(ioc);
+
+    accept_connection(net_iocs, 0, acceptor_timer, ssl_ctx, acceptor, sn,
+                      channel_encryption, rate_limiter, security, keep_alive);
 
-    ioc.run();
+    std::exception_ptr error;
+    try {
+        ioc.run();
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    // No more connections (the pending accept is aborted)
+    error_code ec;
+    acceptor.close(ec);
+    acceptor_timer.cancel();
+
+    if (!conn_threads.empty()) {
+        shutting_down = true;
+        for (auto& conn_ioc : conn_iocs) {
+            conn_ioc->stop();
+        }
+
+        ioc.restart();
+        for (;;) {
+            try {
+                ioc.run();
+                break;
+            } catch (const std::exception& e) {
+                SISPOP_LOG(error, "Exception caught shutting down: {}",
+                           e.what());
+            }
+        }
+    }
+
+    for (auto& thread : conn_threads) {
+        thread.join();
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
 }
 
 /// ============ connection_t ============
@@ -277,24 +410,23 @@ void run(boost::asio::io_context& ioc, const std::string& ip, uint16_t port,
 connection_t::connection_t(boost::asio::io_context& ioc, ssl::context& ssl_ctx,
                            tcp::socket socket, ServiceNode& sn,
                            ChannelEncryption<std::string>& channel_encryption,
-                           RateLimiter& rate_limiter, const Security& security)
+                           RateLimiter& rate_limiter, const Security& security,
+                           const keep_alive_options_t& keep_alive)
     : ioc_(ioc), ssl_ctx_(ssl_ctx), socket_(std::move(socket)),
       stream_(socket_, ssl_ctx_), service_node_(sn),
       channel_cipher_(channel_encryption), rate_limiter_(rate_limiter),
       repeat_timer_(ioc),
-      deadline_(ioc, SESSION_TIME_LIMIT), notification_ctx_{boost::none},
-      security_(security) {
+      deadline_(ioc), notification_ctx_{boost::none},
+      security_(security), keep_alive_options_(keep_alive) {
 
-    static uint64_t instance_counter = 0;
+    static std::atomic<uint64_t> instance_counter{0};
     conn_idx = instance_counter++;
 
     get_net_stats().connections_in++;
 
     SISPOP_LOG(trace, "connection_t [{}]", conn_idx);
 
-    request_.body_limit(1024 * 1024 * 50); // 50 mb
-
-    start_timestamp_ = std::chrono::steady_clock::now();
+    reset_state();
 }
 
 connection_t::~connection_t() {
@@ -312,7 +444,7 @@ connection_t::~connection_t() {
 }
 
 void connection_t::start() {
-    register_deadline();
+    register_deadline(SESSION_TIME_LIMIT);
     do_handshake();
 }
 
@@ -336,6 +468,12 @@ void connection_t::on_handshake(boost::system::error_code ec) {
         return;
     }
 
+    if (SSL_session_reused(stream_.native_handle())) {
+        get_net_stats().tls_handshakes_resumed++;
+    } else {
+        get_net_stats().tls_handshakes_full++;
+    }
+
     read_request();
 }
 
@@ -344,26 +482,46 @@ void connection_t::clean_up() {
     this->do_close();
 
     if (this->notification_ctx_) {
-        this->service_node_.remove_listener(this->notification_ctx_->pubkey,
-                                            this);
+        this->service_node_.remove_listener(this);
     }
 }
 
 void connection_t::notify(boost::optional<const message_t&> msg) {
 
-    if (!notification_ctx_) {
-        SISPOP_LOG(error,
-                 "Trying to notify a connection without notification context");
-        return;
+    boost::optional<message_t> message;
+    if (msg) {
+        message = *msg;
     }
 
-    if (msg) {
-        SISPOP_LOG(trace, "Processing message notification: {}", msg->data);
-        // save messages, so we can access them once the timer event happens
-        notification_ctx_->message = msg;
+    // Called on whichever thread stored the message, which might not be ours
+    // (and while notifying other listeners, so we respond later even if it is)
+    boost::asio::post(ioc_, [self = shared_from_this(),
+                             message = std::move(message)]() mutable {
+        // A keep-alive connection might have moved on to another request
+        // by the time a notification posted before its response arrives
+        if (!self->notification_ctx_) {
+            SISPOP_LOG(trace, "Notified after the long poll was over");
+            return;
+        }
+
+        if (self->notification_ctx_->notify(std::move(message))) {
+            boost::asio::post(self->ioc_,
+                              [self]() { self->respond_to_long_poll(); });
+        }
+    });
+}
+
+void connection_t::respond_to_long_poll() {
+
+    // The notification context is there until we have responded
+    if (!notification_ctx_ || !notification_ctx_->finish()) {
+        return;
     }
-    // the timer callback will be called once we complete the current callback
-    notification_ctx_->timer.cancel();
+
+    SISPOP_LOG(trace, "Long poll notified");
+    respond_with_messages(notification_ctx_->messages());
+    // Until then, we still get notified (and ignore it)
+    service_node_.remove_listener(this);
 }
 
 // Asynchronously receive a complete request message.
@@ -374,15 +532,35 @@ void connection_t::read_request() {
         SISPOP_LOG(trace, "on data: {} bytes", bytes_transferred);
 
         if (ec) {
-            SISPOP_LOG(
-                error,
-                "Failed to read from a socket [{}: {}], connection idx: {}",
-                ec.value(), ec.message(), self->conn_idx);
+            const bool closed_while_idle =
+                self->requests_served_ > 0 &&
+                (ec == http::error::end_of_stream ||
+                 ec == ssl::error::stream_truncated);
+            if (closed_while_idle) {
+                SISPOP_LOG(trace,
+                           "Client closed persistent connection, idx: {}",
+                           self->conn_idx);
+            } else {
+                SISPOP_LOG(
+                    error,
+                    "Failed to read from a socket [{}: {}], connection idx: {}",
+                    ec.value(), ec.message(), self->conn_idx);
+            }
             self->clean_up();
             self->deadline_.cancel();
             return;
         }
 
+        self->requests_served_++;
+        self->keep_alive_ =
+            self->request_->keep_alive() &&
+            self->requests_served_ < self->keep_alive_options_.max_requests;
+
+        if (self->requests_served_ > 1) {
+            // Idle time is over, give the request the usual time limit
+            self->register_deadline(SESSION_TIME_LIMIT);
+        }
+
         // NOTE: this is blocking, we should make this asynchronous
         try {
             self->process_request();
@@ -397,16 +575,57 @@ void connection_t::read_request() {
         }
     };
 
-    http::async_read(stream_, buffer_, request_, on_data);
+    http::async_read(stream_, buffer_, *request_, on_data);
+}
+
+void connection_t::reset_state() {
+
+    request_.emplace();
+    request_->body_limit(1024 * 1024 * 50); // 50 mb
+
+    response_ = {};
+    delay_response_ = false;
+    response_modifier_ = boost::none;
+    notification_ctx_ = boost::none;
+    header_.clear();
+    body_stream_.str({});
+    body_stream_.clear();
+
+    repetition_count_ = 0;
+    start_timestamp_ = std::chrono::steady_clock::now();
+}
+
+void connection_t::read_next_request() {
+
+    SISPOP_LOG(trace, "Keeping connection {} alive ({} requests served)",
+               conn_idx, requests_served_);
+
+    // Note: `buffer_` is kept as is, it might already hold the next
+    // (pipelined) request
+    reset_state();
+
+    register_deadline(keep_alive_options_.idle_timeout);
+
+    read_request();
 }
 
 bool connection_t::validate_snode_request() {
+    if (!validate_snode_sender()) {
+        return false;
+    }
+    const auto& signature = header_[SISPOP_SNODE_SIGNATURE_HEADER];
+    const auto& public_key_b32z = header_[SISPOP_SENDER_SNODE_PUBKEY_HEADER];
+
+    return validate_snode_signature(
+        verify_signature(signature, public_key_b32z));
+}
+
+bool connection_t::validate_snode_sender() {
     if (!parse_header(SISPOP_SENDER_SNODE_PUBKEY_HEADER,
                       SISPOP_SNODE_SIGNATURE_HEADER)) {
         SISPOP_LOG(debug, "Missing signature headers for a Service Node request");
         return false;
     }
-    const auto& signature = header_[SISPOP_SNODE_SIGNATURE_HEADER];
     const auto& public_key_b32z = header_[SISPOP_SENDER_SNODE_PUBKEY_HEADER];
 
     /// Known service node
@@ -418,14 +637,18 @@ bool connection_t::validate_snode_request() {
         response_.result(http::status::unauthorized);
         return false;
     }
+    return true;
+}
 
-    if (!verify_signature(signature, public_key_b32z)) {
+bool connection_t::validate_snode_signature(bool valid) {
+    if (!valid) {
         constexpr auto msg = "Could not verify batch signature";
         SISPOP_LOG(debug, "{}", msg);
         body_stream_ << msg;
         response_.result(http::status::unauthorized);
         return false;
     }
+    const auto& public_key_b32z = header_[SISPOP_SENDER_SNODE_PUBKEY_HEADER];
     if (rate_limiter_.should_rate_limit(public_key_b32z)) {
         this->body_stream_ << "Too many requests\n";
         response_.result(http::status::too_many_requests);
@@ -436,8 +659,9 @@ bool connection_t::validate_snode_request() {
 
 bool connection_t::verify_signature(const std::string& signature,
                                     const std::string& public_key_b32z) {
-    const auto body_hash = hash_data(request_.get().body());
-    return check_signature(signature, body_hash, public_key_b32z);
+    const auto body_hash = hash_data(request_->get().body());
+    return get_snode_signature_cache().check(signature, body_hash,
+                                             public_key_b32z);
 }
 
 void connection_t::process_storage_test_req(uint64_t height,
@@ -515,14 +739,18 @@ void connection_t::process_blockchain_test_req(uint64_t,
 
     SISPOP_LOG(debug, "Performing blockchain test");
 
-    auto callback = [this](blockchain_test_answer_t answer) {
-        this->response_.result(http::status::ok);
+    auto callback = [self = shared_from_this()](
+                        blockchain_test_answer_t answer) {
+        // Called on the service node's io_context
+        boost::asio::dispatch(self->ioc_, [self, answer]() {
+            self->response_.result(http::status::ok);
 
-        nlohmann::json json_res;
-        json_res["res_height"] = answer.res_height;
+            nlohmann::json json_res;
+            json_res["res_height"] = answer.res_height;
 
-        this->body_stream_ << json_res.dump();
-        this->write_response();
+            self->body_stream_ << json_res.dump();
+            self->write_response();
+        });
     };
 
     /// TODO: this should first check if tester/testee are correct! (use `height`)
@@ -534,7 +762,7 @@ void connection_t::process_proxy_req() {
 
     SISPOP_LOG(debug, "Processing proxy request: we are first hop");
 
-    const request_t& req = this->request_.get();
+    const request_t& req = this->request_->get();
 
     delay_response_ = true;
 
@@ -547,13 +775,23 @@ void connection_t::process_proxy_req() {
     const auto& sender_key = header_[SISPOP_SENDER_KEY_HEADER];
     const auto& target_snode_key = header_[SISPOP_TARGET_SNODE_KEY];
 
-    service_node_.process_proxy_req(req.body(), sender_key, target_snode_key, [this] (sn_response_t res) {
+    // Optional, passed on to the destination node
+    std::string enc_type;
+    const auto enc_it = req.find(SISPOP_ENC_TYPE_HEADER);
+    if (enc_it != req.end()) {
+        enc_type = enc_it->value().to_string();
+    }
 
-        if (res.raw_response) {
-            this->response_ = *res.raw_response;
-        }
+    service_node_.process_proxy_req(req.body(), sender_key, target_snode_key, enc_type, [self = shared_from_this()] (sn_response_t res) {
 
-        this->write_response();
+        // Called on the service node's io_context
+        boost::asio::dispatch(self->ioc_, [self, res = std::move(res)]() {
+            if (res.raw_response) {
+                self->response_ = *res.raw_response;
+            }
+
+            self->write_response();
+        });
     });
 }
 
@@ -561,7 +799,7 @@ void connection_t::process_file_proxy_req() {
 
     SISPOP_LOG(debug, "Processing a file proxy request: we are first hop");
 
-    const request_t& original_req = this->request_.get();
+    const request_t& original_req = this->request_->get();
 
     delay_response_ = true;
 
@@ -647,13 +885,66 @@ void connection_t::process_file_proxy_req() {
 
 void connection_t::process_swarm_req(boost::string_view target) {
 
-    const request_t& req = this->request_.get();
+    if (target == "/swarms/push_batch/v1") {
+        process_push_batch_req(target);
+        return;
+    }
 
     // allow ping request as a quick workaround (and they are cheap)
     if (!validate_snode_request() && (target != "/swarms/ping_test/v1")) {
         return;
     }
 
+    process_validated_swarm_req(target);
+}
+
+void connection_t::process_push_batch_req(boost::string_view target) {
+
+    if (!validate_snode_sender()) {
+        return;
+    }
+    const auto& signature = header_[SISPOP_SNODE_SIGNATURE_HEADER];
+    const auto& public_key_b32z = header_[SISPOP_SENDER_SNODE_PUBKEY_HEADER];
+    const auto body_hash = hash_data(request_->get().body());
+
+    auto& cache = get_snode_signature_cache();
+    if (cache.contains(signature, body_hash, public_key_b32z)) {
+        if (validate_snode_signature(true)) {
+            process_validated_swarm_req(target);
+        }
+        return;
+    }
+
+    signature_check_t check;
+    if (!decode_signature_check(signature, body_hash, public_key_b32z,
+                                check)) {
+        validate_snode_signature(false);
+        return;
+    }
+
+    delay_response_ = true;
+    SignatureBatcher::get(ioc_).check(
+        check, [self = shared_from_this(), target, signature, body_hash,
+                public_key_b32z](bool valid) {
+            if (valid) {
+                get_snode_signature_cache().insert(signature, body_hash,
+                                                   public_key_b32z);
+            }
+
+            self->delay_response_ = false;
+            if (self->validate_snode_signature(valid)) {
+                self->process_validated_swarm_req(target);
+            }
+            if (!self->delay_response_) {
+                self->write_response();
+            }
+        });
+}
+
+void connection_t::process_validated_swarm_req(boost::string_view target) {
+
+    const request_t& req = this->request_->get();
+
     response_.set(SISPOP_SNODE_SIGNATURE_HEADER, security_.get_cert_signature());
 
     if (target == "/swarms/storage_test/v1") {
@@ -751,6 +1042,13 @@ void connection_t::process_swarm_req(boost::string_view target) {
 
         service_node_.process_push(messages.front());
 
+        response_.result(http::status::ok);
+    } else if (target == "/swarms/push_batch/v1") {
+
+        SISPOP_LOG(trace, "swarms/push_batch");
+
+        service_node_.process_push_batch(req.body());
+
         response_.result(http::status::ok);
     } else if (target == "/swarms/proxy_exit") {
         SISPOP_LOG(debug, "Processing proxy request: we are the destination node");
@@ -763,14 +1061,30 @@ void connection_t::process_swarm_req(boost::string_view target) {
         if (it != req.end()) {
 
             const std::string key = {it->value().data(), it->value().size()};
-            const auto plaintext = this->channel_cipher_.decrypt(req.body(), key);
+
+            EncryptType enc_type = EncryptType::aes_cbc;
+            std::string plaintext;
+            try {
+                const auto enc_it = req.find(SISPOP_ENC_TYPE_HEADER);
+                if (enc_it != req.end()) {
+                    enc_type = parse_enc_type(enc_it->value().to_string());
+                }
+                this->channel_cipher_.decrypt(req.body(), key, plaintext,
+                                              enc_type);
+            } catch (const std::exception& e) {
+                SISPOP_LOG(debug, "Could not decrypt proxy request: {}",
+                           e.what());
+                response_.result(http::status::bad_request);
+                body_stream_ << "Could not decrypt body: " << e.what();
+                return;
+            }
 
             try {
                 const json req = json::parse(plaintext, nullptr, true);
 
                 const auto body = req.at("body").get<std::string>();
 
-                this->response_modifier_ = [this, key](response_t& res) {
+                this->response_modifier_ = [this, key, enc_type](response_t& res) {
 
                     nlohmann::json json_res;
 
@@ -788,7 +1102,13 @@ void connection_t::process_swarm_req(boost::string_view target) {
 
                     const std::string res_body = json_res.dump();
 
-                    res.body() = util::base64_encode(this->channel_cipher_.encrypt(res_body, key));
+                    if (is_aead(enc_type)) {
+                        // Sent as it is, straight into the response
+                        this->channel_cipher_.encrypt(res_body, key, res.body(), enc_type);
+                        res.set(http::field::content_type, "application/octet-stream");
+                    } else {
+                        res.body() = util::base64_encode(this->channel_cipher_.encrypt(res_body, key));
+                    }
                     res.result(http::status::ok);
                 };
 
@@ -821,13 +1141,12 @@ void connection_t::process_swarm_req(boost::string_view target) {
 // Determine what needs to be done with the request message.
 void connection_t::process_request() {
 
-    const request_t& req = this->request_.get();
+    const request_t& req = this->request_->get();
 
     /// This method is responsible for filling out response_
 
     SISPOP_LOG(trace, "connection_t::process_request");
     response_.version(req.version());
-    response_.keep_alive(false);
 
     /// TODO: make sure that we always send a response!
 
@@ -952,7 +1271,7 @@ void connection_t::write_response() {
         const std::string& ephemKey = it->second;
         try {
             auto body = channel_cipher_.encrypt(body_stream_.str(), ephemKey);
-            response_.body() = boost::beast::detail::base64_encode(body);
+            response_.body() = util::base64_encode(body);
             response_.set(http::field::content_type, "text/plain");
         } catch (const std::exception& e) {
             response_.result(http::status::internal_server_error);
@@ -986,6 +1305,8 @@ void connection_t::write_response() {
 
     response_.set(http::field::content_length,
                   std::to_string(response_.body().size()));
+    // Set last: proxied responses replace `response_` entirely
+    response_.keep_alive(keep_alive_);
 
     /// This attempts to write all data to a stream
     /// TODO: handle the case when we are trying to send too much
@@ -996,6 +1317,11 @@ void connection_t::write_response() {
                          ec.message());
             }
 
+            if (!ec && self->keep_alive_) {
+                self->read_next_request();
+                return;
+            }
+
             self->clean_up();
             /// Is it too early to cancel the deadline here?
             self->deadline_.cancel();
@@ -1003,8 +1329,8 @@ void connection_t::write_response() {
 }
 
 bool connection_t::parse_header(const char* key) {
-    const auto it = request_.get().find(key);
-    if (it == request_.get().end()) {
+    const auto it = request_->get().find(key);
+    if (it == request_->get().end()) {
         body_stream_ << "Missing field in header : " << key << "\n";
         return false;
     }
@@ -1253,29 +1579,16 @@ void connection_t::poll_db(const std::string& pk,
         // until new data arrives for this PubKey
         service_node_.register_listener(pk, self);
 
-        notification_ctx_ = notification_context_t{
-            boost::asio::steady_timer{ioc_}, boost::none, pk};
-
-        notification_ctx_->timer.expires_after(LONG_POLL_TIMEOUT);
-        notification_ctx_->timer.async_wait([=](const error_code& ec) {
-            if (ec == boost::asio::error::operation_aborted) {
-                SISPOP_LOG(trace, "Notification timer manually triggered");
-                // we use timer cancellation as notification mechanism
-                std::vector<message_t> items;
-                auto msg = notification_ctx_->message;
-                if (msg) {
-                    items.push_back(*msg);
-                }
+        // As many messages as a retrieve request gets
+        notification_ctx_.emplace(ioc_, pk, CLIENT_RETRIEVE_MESSAGE_LIMIT);
 
-                respond_with_messages(items);
-            } else {
-                SISPOP_LOG(trace, "Notification timer expired");
-                // If we are here, the notification timer expired
-                // with no messages ready
-                respond_with_messages<Item>({});
-            }
-
-            service_node_.remove_listener(pk, self.get());
+        // Responding to a notification cancels this (see `notify`)
+        notification_ctx_->start(LONG_POLL_TIMEOUT, [self]() {
+            SISPOP_LOG(trace, "Notification timer expired");
+            // If we are here, the notification timer expired, most likely
+            // with no messages ready
+            self->respond_with_messages(self->notification_ctx_->messages());
+            self->service_node_.remove_listener(self.get());
         });
 
     } else {
@@ -1372,7 +1685,7 @@ void connection_t::process_client_req(const std::string& req_json) {
 
 void connection_t::process_client_req_rate_limited() {
 
-    const request_t& req = this->request_.get();
+    const request_t& req = this->request_->get();
     std::string plain_text = req.body();
     const std::string client_ip =
         socket_.remote_endpoint().address().to_string();
@@ -1393,8 +1706,7 @@ void connection_t::process_client_req_rate_limited() {
     }
 
     try {
-        const std::string decoded =
-            boost::beast::detail::base64_decode(plain_text);
+        const std::string decoded = util::base64_decode(plain_text);
         plain_text =
             channel_cipher_.decrypt(decoded, header_[SISPOP_EPHEMKEY_HEADER]);
     } catch (const std::exception& e) {
@@ -1418,28 +1730,19 @@ void connection_t::process_client_req_rate_limited() {
     this->process_client_req(plain_text);
 }
 
-void connection_t::register_deadline() {
+void connection_t::register_deadline(
+    std::chrono::steady_clock::duration timeout) {
 
     auto self = shared_from_this();
 
     // Note: deadline callback captures a shared pointer to this, so
     // the connection will not be destroyed until the timer goes off.
     // If we want to destroy it earlier, we need to manually cancel the timer.
-    deadline_.async_wait([self = std::move(self)](error_code ec) {
-        const bool cancelled =
-            (ec && ec == boost::asio::error::operation_aborted);
-
-        if (cancelled)
-            return;
-
+    // (This replaces any previous deadline.)
+    deadline_.expires_after(timeout, [self = std::move(self)]() {
         // Note: cancelled timer does absolutely nothing, so we need to make
         // sure we close the socket (and unsubscribe from notifications)
         // elsewhere if we cancel it.
-        if (ec) {
-            SISPOP_LOG(error, "Deadline timer error [{}]: {}", ec.value(),
-                     ec.message());
-        }
-
         SISPOP_LOG(debug, "Closing [connection_t] socket due to timeout");
         self->clean_up();
     });
@@ -1475,7 +1778,7 @@ void connection_t::on_get_stats() {
 void connection_t::on_get_logs() {
 
     /// Limit this call to 1 request per second
-    static time_t last_req_time = 0;
+    static std::atomic<time_t> last_req_time{0};
     const time_t now = time(nullptr);
     constexpr time_t PERIOD = 1;
 
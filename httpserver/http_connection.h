@@ -14,12 +14,18 @@
 #include <boost/filesystem.hpp>
 #include <boost/format.hpp>
 
+#include "listener_registry.h"
+#include "long_poll.h"
 #include "swarm.h"
 #include "sispopd_key.h"
+#include "timer_wheel.h"
+#include "tls_session.h"
 
 constexpr auto SISPOP_SENDER_SNODE_PUBKEY_HEADER = "X-Sispop-Snode-PubKey";
 constexpr auto SISPOP_SNODE_SIGNATURE_HEADER = "X-Sispop-Snode-Signature";
 constexpr auto SISPOP_SENDER_KEY_HEADER = "X-Sender-Public-Key";
+// How a proxied request and its response are encrypted (see EncryptType)
+constexpr auto SISPOP_ENC_TYPE_HEADER = "X-Sispop-Enc-Type";
 constexpr auto SISPOP_TARGET_SNODE_KEY = "X-Target-Snode-Key";
 
 template <typename T>
@@ -38,6 +44,11 @@ namespace sispop {
 std::shared_ptr<request_t> build_post_request(const char* target,
                                               std::string&& data);
 
+class SignatureCache;
+
+/// Signatures of requests from other snodes that have already been verified
+SignatureCache& get_snode_signature_cache();
+
 struct message_t;
 struct Security;
 
@@ -160,6 +171,15 @@ class HttpClientSession
 
 namespace http_server {
 
+/// Limits on persistent connections, used when a client asks for keep-alive
+struct keep_alive_options_t {
+    // How long an idle connection is kept open waiting for the next request
+    std::chrono::seconds idle_timeout{15};
+    // Requests served on one connection before it is closed (0 or 1
+    // disables keep-alive)
+    uint32_t max_requests = 100;
+};
+
 class connection_t : public std::enable_shared_from_this<connection_t> {
 
     using tcp = boost::asio::ip::tcp;
@@ -176,8 +196,9 @@ class connection_t : public std::enable_shared_from_this<connection_t> {
     ssl::stream<tcp::socket&> stream_;
     const Security& security_;
 
-    // Contains the request message
-    http::request_parser<http::string_body> request_;
+    // Contains the request message; a parser can only be used once, so
+    // it is replaced for every request on a persistent connection
+    boost::optional<http::request_parser<http::string_body>> request_;
 
     // The response message.
     response_t response_;
@@ -198,45 +219,42 @@ class connection_t : public std::enable_shared_from_this<connection_t> {
     std::chrono::time_point<std::chrono::steady_clock> start_timestamp_;
 
     // The timer for putting a deadline on connection processing.
-    boost::asio::steady_timer deadline_;
+    TimerWheel::timer_t deadline_;
 
     /// TODO: move these if possible
     std::map<std::string, std::string> header_;
 
     std::stringstream body_stream_;
 
-    // Note that we are only sending a single message through the
-    // notification mechanism. If we somehow accumulated multiple
-    // messages before notification event happens (unlikely), the
-    // following messages will be delivered with the client's
-    // consequent (and immediate) retrieve request
-    struct notification_context_t {
-        // The timer used for internal db polling
-        boost::asio::steady_timer timer;
-        // the message is stored here momentarily; needed because
-        // we can't pass it using current notification mechanism
-        boost::optional<message_t> message;
-        // Messenger public key that this connection is registered for
-        std::string pubkey;
-    };
-
-    boost::optional<notification_context_t> notification_ctx_;
+    // The long poll we are waiting to respond to, if any
+    boost::optional<LongPoll> notification_ctx_;
 
     // If present, this function will be called just before
     // writing the response
     boost::optional<std::function<void(response_t&)>> response_modifier_;
 
+    const keep_alive_options_t keep_alive_options_;
+    // Number of requests read on this connection so far
+    uint32_t requests_served_ = 0;
+    // Whether to wait for another request after the current response
+    bool keep_alive_ = false;
+
   public:
     connection_t(boost::asio::io_context& ioc, ssl::context& ssl_ctx,
                  tcp::socket socket, ServiceNode& sn,
                  ChannelEncryption<std::string>& channel_encryption,
-                 RateLimiter& rate_limiter, const Security& security);
+                 RateLimiter& rate_limiter, const Security& security,
+                 const keep_alive_options_t& keep_alive);
 
     ~connection_t();
 
     // Connection index, mainly used for debugging
     uint64_t conn_idx;
 
+    /// Links this connection into the service node's listeners while it is
+    /// long-polling (only touched on the service node's io_context)
+    ListenerRegistry<connection_t>::hook_t listener_hook;
+
     /// Initiate the asynchronous operations associated with the connection.
     void start();
 
@@ -248,6 +266,12 @@ class connection_t : public std::enable_shared_from_this<connection_t> {
     /// Asynchronously receive a complete request message.
     void read_request();
 
+    /// Clear everything left over from the previous request
+    void reset_state();
+
+    /// Wait (up to the idle timeout) for another request on this connection
+    void read_next_request();
+
     void do_close();
     void on_shutdown(boost::system::error_code ec);
 
@@ -260,6 +284,10 @@ class connection_t : public std::enable_shared_from_this<connection_t> {
     /// Check the database for new data, reschedule if empty
     void poll_db(const std::string& pk, const std::string& last_hash);
 
+    /// Respond to the long poll with the messages we've been notified of
+    /// (unless we have responded already)
+    void respond_to_long_poll();
+
     /// Determine what needs to be done with the request message
     /// (synchronously).
     void process_request();
@@ -288,12 +316,19 @@ class connection_t : public std::enable_shared_from_this<connection_t> {
 
     void process_swarm_req(boost::string_view target);
 
+    /// The part of `process_swarm_req` after the request has been validated
+    void process_validated_swarm_req(boost::string_view target);
+
+    /// Validate a push batch with its signature checked along with those
+    /// of other connections (see SignatureBatcher), then process it
+    void process_push_batch_req(boost::string_view target);
+
     void process_proxy_req();
 
     void process_file_proxy_req();
 
     // Check whether we have spent enough time on this connection.
-    void register_deadline();
+    void register_deadline(std::chrono::steady_clock::duration timeout);
 
     /// Process storage test request and repeat if necessary
     void process_storage_test_req(uint64_t height,
@@ -312,14 +347,23 @@ class connection_t : public std::enable_shared_from_this<connection_t> {
     void handle_wrong_swarm(const user_pubkey_t& pubKey);
 
     bool validate_snode_request();
+    /// The checks of `validate_snode_request` that come before the
+    /// signature (headers present, known sender)
+    bool validate_snode_sender();
+    /// The ones that come after, given whether the signature is valid
+    bool validate_snode_signature(bool valid);
     bool verify_signature(const std::string& signature,
                           const std::string& public_key_b32z);
 };
 
+/// Accept and serve connections on `threads` threads (`ioc` itself if
+/// there is only one) until `ioc` is stopped
 void run(boost::asio::io_context& ioc, const std::string& ip, uint16_t port,
          const boost::filesystem::path& base_path, ServiceNode& sn,
          ChannelEncryption<std::string>& channelEncryption,
-         RateLimiter& rate_limiter, Security&);
+         RateLimiter& rate_limiter, Security&, unsigned threads = 1,
+         const tls_session_options_t& tls_options = {},
+         const keep_alive_options_t& keep_alive = {});
 
 } // namespace http_server
 
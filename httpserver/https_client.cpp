@@ -6,6 +6,8 @@
 #include <openssl/x509.h>
 #include <boost/algorithm/string/erase.hpp>
 
+#include <atomic>
+
 namespace sispop {
 
 using error_code = boost::system::error_code;
@@ -16,11 +18,8 @@ void make_https_request(boost::asio::io_context& ioc,
                         const std::shared_ptr<request_t>& req,
                         http_callback_t&& cb) {
 
-    error_code ec;
-    boost::asio::ip::tcp::resolver resolver(ioc);
 #ifdef INTEGRATION_TEST
-    const auto resolve_results =
-        resolver.resolve("0.0.0.0", std::to_string(port), ec);
+    const std::string host = "0.0.0.0";
 #else
 
     if (sn_address == "0.0.0.0") {
@@ -31,32 +30,36 @@ void make_https_request(boost::asio::io_context& ioc,
         return;
     }
 
-    const auto resolve_results =
-        resolver.resolve(sn_address, std::to_string(port), ec);
+    const std::string& host = sn_address;
 #endif
-    if (ec) {
-        SISPOP_LOG(error,
-                 "https: Failed to parse the IP address. Error code = {}. "
-                 "Message: {}",
-                 ec.value(), ec.message());
-        return;
-    }
 
-    static ssl::context ctx{ssl::context::tlsv12_client};
+    auto on_resolve = [&ioc, sn_pubkey_b32z, req, cb = std::move(cb)](
+                          const error_code& ec, endpoints_t endpoints) mutable {
+        if (ec) {
+            SISPOP_LOG(error,
+                     "https: Failed to parse the IP address. Error code = {}. "
+                     "Message: {}",
+                     ec.value(), ec.message());
+            cb(sn_response_t{SNodeError::NO_REACH, nullptr});
+            return;
+        }
 
-    auto session = std::make_shared<HttpsClientSession>(
-        ioc, ctx, std::move(resolve_results), req, std::move(cb),
-        sn_pubkey_b32z);
+        static ssl::context ctx{ssl::context::tlsv12_client};
 
-    session->start();
+        auto session = std::make_shared<HttpsClientSession>(
+            ioc, ctx, std::move(endpoints), req, std::move(cb),
+            sn_pubkey_b32z);
+
+        session->start();
+    };
+
+    get_dns_resolver().resolve(ioc, host, port, std::move(on_resolve));
 }
 
 void make_https_request(boost::asio::io_context& ioc, const std::string& url,
                         const std::shared_ptr<request_t>& req,
                         http_callback_t&& cb) {
 
-    static boost::asio::ip::tcp::resolver resolver(ioc);
-
     constexpr char prefix[] = "https://";
     std::string query = url;
 
@@ -64,27 +67,24 @@ void make_https_request(boost::asio::io_context& ioc, const std::string& url,
         query.erase(0, sizeof(prefix) - 1);
     }
 
-    auto resolve_handler = [&ioc, req, query, cb = std::move(cb)] (
-                               const boost::system::error_code& ec,
-                               boost::asio::ip::tcp::resolver::results_type resolve_results) mutable {
+    auto on_resolve = [&ioc, req, query, cb = std::move(cb)](
+                          const error_code& ec, endpoints_t endpoints) mutable {
         if (ec) {
-            SISPOP_LOG(error, "DNS resolution error for {}: {}", query, ec.message());
+            // Already logged by the resolver
             return;
         }
 
         static ssl::context ctx{ssl::context::tlsv12_client};
 
         auto session = std::make_shared<HttpsClientSession>(
-            ioc, ctx, std::move(resolve_results), req, std::move(cb), boost::none);
+            ioc, ctx, std::move(endpoints), req, std::move(cb), boost::none);
 
         session->start();
     };
 
-    constexpr char https_port[] = "443";
+    constexpr uint16_t https_port = 443;
 
-    resolver.async_resolve(query, https_port,
-                           boost::asio::ip::tcp::resolver::query::numeric_service,
-                           resolve_handler);
+    get_dns_resolver().resolve(ioc, query, https_port, std::move(on_resolve));
 }
 
 static std::string x509_to_string(X509* x509) {
@@ -106,31 +106,346 @@ static std::string x509_to_string(X509* x509) {
     return pem;
 }
 
+/// ============ https_connection_t ============
+
+https_connection_t::https_connection_t(boost::asio::io_context& ioc,
+                                       ssl::context& ssl_ctx)
+    : ioc(ioc), stream(ioc, ssl_ctx) {
+    get_net_stats().https_connections_out++;
+}
+
+void https_connection_t::close() {
+    // Might be called from any thread (e.g. when evicted from the pool)
+    boost::asio::dispatch(ioc, [self = shared_from_this()]() {
+        self->stream.async_shutdown(std::bind(&https_connection_t::on_shutdown,
+                                              self, std::placeholders::_1));
+    });
+}
+
+void https_connection_t::on_shutdown(boost::system::error_code ec) {
+    if (ec == boost::asio::error::eof) {
+        // Rationale:
+        // http://stackoverflow.com/questions/25587403/boost-asio-ssl-async-shutdown-always-finishes-with-an-error
+        ec.assign(0, ec.category());
+    } else if (ec) {
+        // This one is too noisy, so demoted to debug:
+        SISPOP_LOG(debug, "could not shutdown stream gracefully: {} ({})",
+                 ec.message(), ec.value());
+    }
+
+    const auto sockfd = stream.lowest_layer().native_handle();
+    SISPOP_LOG(trace, "Close https socket: {}", sockfd);
+    get_net_stats().record_socket_close(sockfd);
+
+    stream.lowest_layer().close();
+
+    // If we get here then the connection is closed gracefully
+}
+
+https_connection_t::~https_connection_t() {
+    get_net_stats().https_connections_out--;
+}
+
+/// ============ HttpsConnectionPool ============
+
+// Below the server's default keep-alive timeout, so that we don't
+// normally pick a connection the other side is about to close
+constexpr auto POOL_IDLE_TIMEOUT = std::chrono::seconds(10);
+
+void HttpsConnectionPool::set_max_idle_per_peer(size_t max) {
+
+    std::vector<std::shared_ptr<https_connection_t>> surplus;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        max_idle_per_peer_ = max;
+
+        for (auto it = idle_.begin(); it != idle_.end();) {
+            auto& conns = it->second;
+            while (conns.size() > max) {
+                surplus.push_back(std::move(conns.front().conn));
+                conns.erase(conns.begin());
+            }
+
+            if (conns.empty()) {
+                it = idle_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    for (auto& conn : surplus) {
+        conn->close();
+    }
+}
+
+std::shared_ptr<https_connection_t>
+HttpsConnectionPool::take(boost::asio::io_context& ioc,
+                          const std::string& sn_pubkey_b32z) {
+
+    const auto now = std::chrono::steady_clock::now();
+    std::vector<std::shared_ptr<https_connection_t>> expired;
+    std::shared_ptr<https_connection_t> res;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        const auto it = idle_.find(sn_pubkey_b32z);
+        if (it == idle_.end()) {
+            return nullptr;
+        }
+
+        auto& conns = it->second;
+        // Least recently used connections are at the front (see
+        // `evict_idle`)
+        auto first_alive = conns.begin();
+        while (first_alive != conns.end() &&
+               now - first_alive->since > POOL_IDLE_TIMEOUT) {
+            expired.push_back(std::move(first_alive->conn));
+            ++first_alive;
+        }
+        conns.erase(conns.begin(), first_alive);
+
+        // The most recently used one of ours: connections are only usable
+        // from the thread running their io_context, those of other threads
+        // stay where they are
+        for (auto idle = conns.rbegin(); idle != conns.rend(); ++idle) {
+            if (&idle->conn->ioc == &ioc) {
+                res = std::move(idle->conn);
+                conns.erase(std::next(idle).base());
+                break;
+            }
+        }
+
+        if (conns.empty()) {
+            idle_.erase(it);
+        }
+    }
+
+    for (auto& conn : expired) {
+        conn->close();
+    }
+
+    return res;
+}
+
+void HttpsConnectionPool::put(const std::string& sn_pubkey_b32z,
+                              std::shared_ptr<https_connection_t> conn) {
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (max_idle_per_peer_ > 0) {
+            auto& conns = idle_[sn_pubkey_b32z];
+            if (conns.size() < max_idle_per_peer_) {
+                conns.push_back(
+                    {std::move(conn), std::chrono::steady_clock::now()});
+                return;
+            }
+        }
+    }
+
+    conn->close();
+}
+
+void HttpsConnectionPool::evict_idle() {
+
+    const auto now = std::chrono::steady_clock::now();
+    std::vector<std::shared_ptr<https_connection_t>> expired;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        for (auto it = idle_.begin(); it != idle_.end();) {
+            auto& conns = it->second;
+            // Least recently used connections are at the front
+            auto first_alive = conns.begin();
+            while (first_alive != conns.end() &&
+                   now - first_alive->since > POOL_IDLE_TIMEOUT) {
+                expired.push_back(std::move(first_alive->conn));
+                ++first_alive;
+            }
+            conns.erase(conns.begin(), first_alive);
+
+            if (conns.empty()) {
+                it = idle_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    if (!expired.empty()) {
+        SISPOP_LOG(debug, "Closing {} idle outbound connection(s)",
+                   expired.size());
+    }
+
+    for (auto& conn : expired) {
+        conn->close();
+    }
+}
+
+size_t HttpsConnectionPool::idle_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t res = 0;
+    for (const auto& peer : idle_) {
+        res += peer.second.size();
+    }
+    return res;
+}
+
+HttpsConnectionPool& get_https_pool() {
+    static HttpsConnectionPool pool;
+    return pool;
+}
+
+/// ============ PeerCertCache ============
+
+// Well above the number of nodes in the network, only there to bound
+// memory if the swarm list is unavailable for a long time
+constexpr size_t PEER_CERT_CACHE_SIZE = 10000;
+
+bool PeerCertCache::contains(const std::string& sn_pubkey_b32z,
+                             const cert_fingerprint_t& fingerprint) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = verified_.find(sn_pubkey_b32z);
+    return it != verified_.end() && it->second == fingerprint;
+}
+
+void PeerCertCache::insert(const std::string& sn_pubkey_b32z,
+                           const cert_fingerprint_t& fingerprint) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (verified_.size() >= PEER_CERT_CACHE_SIZE &&
+        verified_.find(sn_pubkey_b32z) == verified_.end()) {
+        verified_.erase(verified_.begin());
+    }
+    // A node that changed its certificate replaces the old one
+    verified_[sn_pubkey_b32z] = fingerprint;
+}
+
+void PeerCertCache::retain(
+    const std::unordered_set<std::string>& sn_pubkeys_b32z) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = verified_.begin(); it != verified_.end();) {
+        if (sn_pubkeys_b32z.find(it->first) == sn_pubkeys_b32z.end()) {
+            it = verified_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void PeerCertCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    verified_.clear();
+}
+
+size_t PeerCertCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return verified_.size();
+}
+
+PeerCertCache& get_peer_cert_cache() {
+    static PeerCertCache cache;
+    return cache;
+}
+
+static std::atomic<bool> enforce_peer_signatures{false};
+
+void set_enforce_peer_signatures(bool enforce) {
+    enforce_peer_signatures = enforce;
+}
+
+bool verify_cert_signature(X509* cert, const std::string& signature,
+                           const std::string& sn_pubkey_b32z) {
+
+    cert_fingerprint_t fingerprint;
+    unsigned int len = fingerprint.size();
+    if (!X509_digest(cert, EVP_sha256(), fingerprint.data(), &len)) {
+        SISPOP_LOG(error, "Could not compute certificate fingerprint");
+        return false;
+    }
+
+    auto& cache = get_peer_cert_cache();
+    if (cache.contains(sn_pubkey_b32z, fingerprint)) {
+        get_net_stats().peer_cert_cache_hits++;
+        return true;
+    }
+
+    get_net_stats().peer_cert_cache_misses++;
+
+    // The node signs its cert.pem, which is what we get back here
+    const auto hash = hash_data(x509_to_string(cert));
+    if (!check_signature(signature, hash, sn_pubkey_b32z)) {
+        return false;
+    }
+
+    cache.insert(sn_pubkey_b32z, fingerprint);
+    return true;
+}
+
+/// ============ HttpsClientSession ============
+
 HttpsClientSession::HttpsClientSession(
     boost::asio::io_context& ioc, ssl::context& ssl_ctx,
-    tcp::resolver::results_type resolve_results,
-    const std::shared_ptr<request_t>& req, http_callback_t&& cb,
-    boost::optional<const std::string&> sn_pubkey_b32z)
-    : ioc_(ioc), ssl_ctx_(ssl_ctx), resolve_results_(resolve_results),
-      callback_(cb), deadline_timer_(ioc), stream_(ioc, ssl_ctx_), req_(req),
+    endpoints_t endpoints, const std::shared_ptr<request_t>& req,
+    http_callback_t&& cb, boost::optional<const std::string&> sn_pubkey_b32z)
+    : ioc_(ioc), ssl_ctx_(ssl_ctx), endpoints_(std::move(endpoints)),
+      callback_(cb), deadline_timer_(ioc), req_(req),
       server_pub_key_b32z_(sn_pubkey_b32z) {
 
-    get_net_stats().https_connections_out++;
+    if (server_pub_key_b32z_) {
+        conn_ = get_https_pool().take(ioc_, *server_pub_key_b32z_);
+        reused_connection_ = conn_ != nullptr;
+    }
 
-    static uint64_t connection_count = 0;
+    static std::atomic<uint64_t> connection_count{0};
     this->connection_idx = connection_count++;
 }
 
 void HttpsClientSession::start() {
+
+    if (reused_connection_) {
+        get_net_stats().https_connections_reused++;
+        send_request();
+    } else {
+        connect();
+    }
+
+    deadline_timer_.expires_after(SESSION_TIME_LIMIT);
+    deadline_timer_.async_wait(
+        [self = shared_from_this()](const error_code& ec) {
+            if (ec) {
+                if (ec != boost::asio::error::operation_aborted) {
+                    SISPOP_LOG(error,
+                             "Deadline timer failed in https client session "
+                             "[{}: {}]",
+                             ec.value(), ec.message());
+                }
+            } else {
+                SISPOP_LOG(debug, "client socket timed out");
+                self->do_close();
+            }
+        });
+}
+
+void HttpsClientSession::connect() {
+
+    conn_ = std::make_shared<https_connection_t>(ioc_, ssl_ctx_);
+    reused_connection_ = false;
+    get_net_stats().https_connections_created++;
+
     // Set SNI Hostname (many hosts need this to handshake successfully)
-    if (!SSL_set_tlsext_host_name(stream_.native_handle(), "service node")) {
+    if (!SSL_set_tlsext_host_name(conn_->stream.native_handle(),
+                                  "service node")) {
         boost::beast::error_code ec{static_cast<int>(::ERR_get_error()),
                                     boost::asio::error::get_ssl_category()};
         SISPOP_LOG(critical, "{}", ec.message());
         return;
     }
     boost::asio::async_connect(
-        stream_.next_layer(), resolve_results_,
+        conn_->stream.next_layer(), endpoints_,
         [this, self = shared_from_this()](boost::system::error_code ec,
                                           const tcp::endpoint& endpoint) {
             /// TODO: I think I should just call again if ec ==
@@ -149,46 +464,25 @@ void HttpsClientSession::start() {
 
             self->on_connect();
         });
-
-    deadline_timer_.expires_after(SESSION_TIME_LIMIT);
-    deadline_timer_.async_wait(
-        [self = shared_from_this()](const error_code& ec) {
-            if (ec) {
-                if (ec != boost::asio::error::operation_aborted) {
-                    SISPOP_LOG(error,
-                             "Deadline timer failed in https client session "
-                             "[{}: {}]",
-                             ec.value(), ec.message());
-                }
-            } else {
-                SISPOP_LOG(debug, "client socket timed out");
-                self->do_close();
-            }
-        });
 }
 
 void HttpsClientSession::on_connect() {
     SISPOP_LOG(trace, "on connect, connection idx: {}", this->connection_idx);
 
-    const auto sockfd = stream_.lowest_layer().native_handle();
+    auto& stream = conn_->stream;
+
+    const auto sockfd = stream.lowest_layer().native_handle();
     SISPOP_LOG(trace, "Open https socket: {}", sockfd);
     get_net_stats().record_socket_open(sockfd);
 
-    stream_.set_verify_mode(ssl::verify_none);
+    // Snodes use self-signed certificates, the node's identity is checked
+    // using the signature it sends along with its responses instead
+    stream.set_verify_mode(ssl::verify_none);
 
-    stream_.set_verify_callback(
-        [this](bool preverified, ssl::verify_context& ctx) -> bool {
-            if (!preverified) {
-                X509_STORE_CTX* handle = ctx.native_handle();
-                X509* x509 = X509_STORE_CTX_get0_cert(handle);
-                server_cert_ = x509_to_string(x509);
-            }
-            return true;
-        });
-    stream_.async_handshake(ssl::stream_base::client,
-                            std::bind(&HttpsClientSession::on_handshake,
-                                      shared_from_this(),
-                                      std::placeholders::_1));
+    stream.async_handshake(ssl::stream_base::client,
+                           std::bind(&HttpsClientSession::on_handshake,
+                                     shared_from_this(),
+                                     std::placeholders::_1));
 }
 
 void HttpsClientSession::on_handshake(boost::system::error_code ec) {
@@ -199,16 +493,45 @@ void HttpsClientSession::on_handshake(boost::system::error_code ec) {
         return;
     }
 
-    http::async_write(stream_, *req_,
+    send_request();
+}
+
+void HttpsClientSession::send_request() {
+    http::async_write(conn_->stream, *req_,
                       std::bind(&HttpsClientSession::on_write,
                                 shared_from_this(), std::placeholders::_1,
                                 std::placeholders::_2));
 }
 
+bool HttpsClientSession::retry_on_new_connection(error_code ec) {
+
+    if (!reused_connection_ || used_callback_) {
+        return false;
+    }
+
+    SISPOP_LOG(debug, "Pooled connection to {} is no longer usable ({}), "
+                      "reconnecting",
+               *server_pub_key_b32z_, ec.message());
+
+    // Nothing useful can be done with the old one, just release the socket
+    auto& socket = conn_->stream.lowest_layer();
+    get_net_stats().record_socket_close(socket.native_handle());
+    boost::system::error_code ignored;
+    socket.close(ignored);
+
+    buffer_.clear();
+    res_ = {};
+    connect();
+    return true;
+}
+
 void HttpsClientSession::on_write(error_code ec, size_t bytes_transferred) {
 
     SISPOP_LOG(trace, "on write");
     if (ec) {
+        if (retry_on_new_connection(ec)) {
+            return;
+        }
         SISPOP_LOG(error, "Https error on write, ec: {}. Message: {}", ec.value(),
                  ec.message());
         trigger_callback(SNodeError::ERROR_OTHER, nullptr);
@@ -218,15 +541,20 @@ void HttpsClientSession::on_write(error_code ec, size_t bytes_transferred) {
     SISPOP_LOG(trace, "Successfully transferred {} bytes.", bytes_transferred);
 
     // Receive the HTTP response
-    http::async_read(stream_, buffer_, res_,
+    http::async_read(conn_->stream, buffer_, res_,
                      std::bind(&HttpsClientSession::on_read, shared_from_this(),
                                std::placeholders::_1, std::placeholders::_2));
 }
 
 bool HttpsClientSession::verify_signature() {
 
-    if (server_pub_key_b32z_)
+    if (!server_pub_key_b32z_)
+        return true;
+
+    // The server's certificate cannot change within a connection
+    if (conn_->verified) {
         return true;
+    }
 
     const auto it = res_.find(SISPOP_SNODE_SIGNATURE_HEADER);
     if (it == res_.end()) {
@@ -234,23 +562,45 @@ bool HttpsClientSession::verify_signature() {
                  *server_pub_key_b32z_);
         return false;
     }
+
+    X509* cert = SSL_get_peer_certificate(conn_->stream.native_handle());
+    if (!cert) {
+        SISPOP_LOG(warn, "no certificate received from {}",
+                 *server_pub_key_b32z_);
+        return false;
+    }
+
     // signature is expected to be base64 enoded
-    const auto signature = it->value().to_string();
-    const auto hash = hash_data(server_cert_);
-    return check_signature(signature, hash, *server_pub_key_b32z_);
+    conn_->verified = verify_cert_signature(cert, it->value().to_string(),
+                                            *server_pub_key_b32z_);
+    X509_free(cert);
+
+    return conn_->verified;
 }
 
 void HttpsClientSession::on_read(error_code ec, size_t bytes_transferred) {
 
     SISPOP_LOG(trace, "Successfully received {} bytes", bytes_transferred);
 
+    // The server closed a pooled connection before we got any response
+    if (ec && bytes_transferred == 0 && retry_on_new_connection(ec)) {
+        return;
+    }
+
     if (!ec || (ec == http::error::end_of_stream)) {
 
         if (http::to_status_class(res_.result_int()) ==
             http::status_class::successful) {
 
-            if (server_pub_key_b32z_ && !verify_signature()) {
-                SISPOP_LOG(debug, "Bad signature from {}", *server_pub_key_b32z_);
+            const bool verified = verify_signature();
+            if (!verified) {
+                get_net_stats().peer_signature_failures++;
+                SISPOP_LOG(debug, "Bad signature from {}{}",
+                           *server_pub_key_b32z_,
+                           enforce_peer_signatures ? "" : " (not enforced)");
+            }
+
+            if (!verified && enforce_peer_signatures) {
                 trigger_callback(SNodeError::ERROR_OTHER, nullptr, res_);
             } else {
                 auto body = std::make_shared<std::string>(res_.body());
@@ -270,6 +620,14 @@ void HttpsClientSession::on_read(error_code ec, size_t bytes_transferred) {
         trigger_callback(SNodeError::ERROR_OTHER, nullptr, res_);
     }
 
+    // Keep the connection for the next request to the same node, unless
+    // the server is about to close it or we couldn't verify its identity
+    if (!ec && server_pub_key_b32z_ && conn_->verified &&
+        res_.keep_alive()) {
+        get_https_pool().put(*server_pub_key_b32z_, std::move(conn_));
+        return;
+    }
+
     // Gracefully close the socket
     do_close();
 
@@ -292,30 +650,9 @@ void HttpsClientSession::trigger_callback(
 }
 
 void HttpsClientSession::do_close() {
-    // Gracefully close the stream
-    stream_.async_shutdown(std::bind(&HttpsClientSession::on_shutdown,
-                                     shared_from_this(),
-                                     std::placeholders::_1));
-}
-
-void HttpsClientSession::on_shutdown(boost::system::error_code ec) {
-    if (ec == boost::asio::error::eof) {
-        // Rationale:
-        // http://stackoverflow.com/questions/25587403/boost-asio-ssl-async-shutdown-always-finishes-with-an-error
-        ec.assign(0, ec.category());
-    } else if (ec) {
-        // This one is too noisy, so demoted to debug:
-        SISPOP_LOG(debug, "could not shutdown stream gracefully: {} ({})",
-                 ec.message(), ec.value());
+    if (conn_) {
+        conn_->close();
     }
-
-    const auto sockfd = stream_.lowest_layer().native_handle();
-    SISPOP_LOG(trace, "Close https socket: {}", sockfd);
-    get_net_stats().record_socket_close(sockfd);
-
-    stream_.lowest_layer().close();
-
-    // If we get here then the connection is closed gracefully
 }
 
 /// We execute callback (if haven't already) here to make sure it is called
@@ -327,7 +664,5 @@ HttpsClientSession::~HttpsClientSession() {
         ioc_.post(std::bind(callback_,
                             sn_response_t{SNodeError::ERROR_OTHER, nullptr}));
     }
-
-    get_net_stats().https_connections_out--;
 }
 } // namespace sispop
@@ -1,7 +1,17 @@
 #pragma once
 
+#include "dns_resolver.h"
 #include "http_connection.h"
+
+#include <openssl/x509.h>
+
+#include <array>
+#include <chrono>
 #include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 namespace sispop {
 using http_callback_t = std::function<void(sn_response_t)>;
@@ -15,6 +25,106 @@ void make_https_request(boost::asio::io_context& ioc, const std::string& url,
                         const std::shared_ptr<request_t>& req,
                         http_callback_t&& cb);
 
+/// An established TLS connection to a service node, which can carry several
+/// requests one after another
+class https_connection_t
+    : public std::enable_shared_from_this<https_connection_t> {
+
+    using tcp = boost::asio::ip::tcp;
+
+  public:
+    boost::asio::io_context& ioc;
+    ssl::stream<tcp::socket> stream;
+
+    // Whether the server's identity has been verified on this connection
+    bool verified = false;
+
+    https_connection_t(boost::asio::io_context& ioc, ssl::context& ssl_ctx);
+
+    /// Gracefully shut the connection down
+    void close();
+
+    ~https_connection_t();
+
+  private:
+    void on_shutdown(boost::system::error_code ec);
+};
+
+/// Idle connections to service nodes (keyed by their pubkey) kept open so
+/// that the next request to the same node can skip the TCP and TLS setup
+class HttpsConnectionPool {
+
+    struct idle_connection_t {
+        std::shared_ptr<https_connection_t> conn;
+        std::chrono::steady_clock::time_point since;
+    };
+
+    // Requests are made from the service node and from every thread
+    // serving connections
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, std::vector<idle_connection_t>> idle_;
+    size_t max_idle_per_peer_ = 2;
+
+  public:
+    /// At most `max` idle connections are kept per node (0 disables
+    /// pooling); connections above the new limit are closed
+    void set_max_idle_per_peer(size_t max);
+
+    /// Most recently used connection to `sn_pubkey_b32z` (on `ioc`), if any
+    std::shared_ptr<https_connection_t> take(boost::asio::io_context& ioc,
+                                             const std::string& sn_pubkey_b32z);
+
+    /// Keep `conn` for later use, or close it if the node already has
+    /// enough idle connections
+    void put(const std::string& sn_pubkey_b32z,
+             std::shared_ptr<https_connection_t> conn);
+
+    /// Close every connection that has been idle for too long
+    void evict_idle();
+
+    size_t idle_count() const;
+};
+
+HttpsConnectionPool& get_https_pool();
+
+using cert_fingerprint_t = std::array<unsigned char, 32>;
+
+/// Certificates of service nodes whose signature (by the node's key) we
+/// have already checked, so that repeated connections to the same node
+/// don't need to redo it
+class PeerCertCache {
+
+    mutable std::mutex mutex_;
+    // Node's pubkey -> fingerprint of its verified certificate
+    std::unordered_map<std::string, cert_fingerprint_t> verified_;
+
+  public:
+    bool contains(const std::string& sn_pubkey_b32z,
+                  const cert_fingerprint_t& fingerprint) const;
+
+    void insert(const std::string& sn_pubkey_b32z,
+                const cert_fingerprint_t& fingerprint);
+
+    /// Forget about nodes not in `sn_pubkeys_b32z` (e.g. deregistered)
+    void retain(const std::unordered_set<std::string>& sn_pubkeys_b32z);
+
+    void clear();
+
+    size_t size() const;
+};
+
+PeerCertCache& get_peer_cert_cache();
+
+/// Check that `signature` (as found in the X-Sispop-Snode-Signature header)
+/// is the signature of `cert` by the node `sn_pubkey_b32z`
+bool verify_cert_signature(X509* cert, const std::string& signature,
+                           const std::string& sn_pubkey_b32z);
+
+/// Whether responses from nodes whose signature doesn't check out are
+/// rejected. Off by default: they are only counted and logged, as nodes
+/// that haven't been upgraded might send signatures that never verify
+void set_enforce_peer_signatures(bool enforce);
+
 class HttpsClientSession
     : public std::enable_shared_from_this<HttpsClientSession> {
 
@@ -25,14 +135,15 @@ class HttpsClientSession
 
     boost::asio::io_context& ioc_;
     ssl::context& ssl_ctx_;
-    tcp::resolver::results_type resolve_results_;
+    endpoints_t endpoints_;
     http_callback_t callback_;
     boost::asio::steady_timer deadline_timer_;
 
-    // keep the cert in memory for post-handshake verification
-    std::string server_cert_;
+    std::shared_ptr<https_connection_t> conn_;
+    // Whether `conn_` came from the pool (and might have been closed by
+    // the server in the meantime)
+    bool reused_connection_ = false;
 
-    ssl::stream<tcp::socket> stream_;
     boost::beast::flat_buffer buffer_;
     /// NOTE: this needs to be a shared pointer since
     /// it is very common for the same request to be
@@ -45,12 +156,20 @@ class HttpsClientSession
 
     bool used_callback_ = false;
 
+    void connect();
+
     void on_connect();
 
+    void send_request();
+
     void on_write(boost::system::error_code ec, std::size_t bytes_transferred);
 
     void on_read(boost::system::error_code ec, std::size_t bytes_transferred);
 
+    /// If a pooled connection turned out to be closed, send the request
+    /// again on a new one; returns whether it did
+    bool retry_on_new_connection(boost::system::error_code ec);
+
     void
     trigger_callback(SNodeError error, std::shared_ptr<std::string>&& body,
                      boost::optional<response_t> raw_response = boost::none);
@@ -59,12 +178,11 @@ class HttpsClientSession
     bool verify_signature();
 
     void do_close();
-    void on_shutdown(boost::system::error_code ec);
 
   public:
     // Resolver and socket require an io_context
     HttpsClientSession(boost::asio::io_context& ioc, ssl::context& ssl_ctx,
-                       tcp::resolver::results_type resolve_results,
+                       endpoints_t endpoints,
                        const std::shared_ptr<request_t>& req,
                        http_callback_t&& cb,
                        boost::optional<const std::string&> sn_pubkey_b32z);
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <boost/intrusive/list.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace sispop {
+
+/// Long-polling listeners waiting for messages, by pubkey
+///
+/// Every listener owns the hook that links it into its pubkey's list, so
+/// registering and removing one are O(1) (no searching or shifting of
+/// vectors), and notifying the listeners of a pubkey only walks those.
+/// While registered, the registry keeps a reference to the listener.
+///
+/// Not thread safe: the service node guards it with a lock of its own
+template <typename Listener>
+class ListenerRegistry {
+
+    struct bucket_t;
+
+  public:
+    class hook_t {
+        friend class ListenerRegistry;
+
+        boost::intrusive::list_member_hook<> link_;
+        std::shared_ptr<Listener> listener_;
+        bucket_t* bucket_ = nullptr;
+
+      public:
+        hook_t() = default;
+        hook_t(const hook_t&) = delete;
+        hook_t& operator=(const hook_t&) = delete;
+
+        bool is_registered() const { return bucket_ != nullptr; }
+    };
+
+  private:
+    using list_t = boost::intrusive::list<
+        hook_t,
+        boost::intrusive::member_hook<hook_t, boost::intrusive::list_member_hook<>,
+                                      &hook_t::link_>,
+        boost::intrusive::constant_time_size<true>>;
+
+    struct bucket_t {
+        list_t listeners;
+        /// The key of this bucket in `buckets_` (null once taken out of it)
+        const std::string* pubkey = nullptr;
+    };
+
+    /// Node based, so buckets don't move as others are added
+    std::unordered_map<std::string, bucket_t> buckets_;
+    size_t size_ = 0;
+
+    /// Unlink `hook` and drop its bucket if it was the last one in it; the
+    /// registry's reference to the listener is returned
+    std::shared_ptr<Listener> unlink(hook_t& hook) {
+        bucket_t* bucket = hook.bucket_;
+        bucket->listeners.erase(bucket->listeners.iterator_to(hook));
+        hook.bucket_ = nullptr;
+        size_--;
+        if (bucket->listeners.empty() && bucket->pubkey) {
+            buckets_.erase(*bucket->pubkey);
+        }
+        return std::move(hook.listener_);
+    }
+
+    /// Unlink the listeners of `bucket`, which is no longer in `buckets_`,
+    /// calling `f` with each of them. Those still waiting can be removed
+    /// (by `f`) and the ones already notified registered again
+    template <typename F>
+    void drain(bucket_t& bucket, F& f) {
+        for (auto& hook : bucket.listeners) {
+            hook.bucket_ = &bucket;
+        }
+        while (!bucket.listeners.empty()) {
+            const auto listener = unlink(bucket.listeners.front());
+            f(*listener);
+        }
+    }
+
+  public:
+    ~ListenerRegistry() {
+        for (auto& entry : buckets_) {
+            entry.second.listeners.clear_and_dispose([](hook_t* hook) {
+                hook->bucket_ = nullptr;
+                hook->listener_.reset();
+            });
+        }
+    }
+
+    /// Register `listener` (owning `hook`) for `pubkey`; does nothing if it
+    /// is registered already
+    void add(const std::string& pubkey, hook_t& hook,
+             std::shared_ptr<Listener> listener) {
+        if (hook.is_registered()) {
+            return;
+        }
+        const auto it = buckets_.try_emplace(pubkey).first;
+        bucket_t& bucket = it->second;
+        bucket.pubkey = &it->first;
+        bucket.listeners.push_back(hook);
+        hook.bucket_ = &bucket;
+        hook.listener_ = std::move(listener);
+        size_++;
+    }
+
+    /// Unregister the listener owning `hook`; false if it wasn't registered
+    /// (e.g. because it has been notified already)
+    bool remove(hook_t& hook) {
+        if (!hook.is_registered()) {
+            return false;
+        }
+        // The listener (and `hook`) might not outlive this reference
+        const auto listener = unlink(hook);
+        return true;
+    }
+
+    /// Call `f` with each listener of `pubkey`, which stay registered (so
+    /// `f` must not remove any); returns how many there are
+    template <typename F>
+    size_t for_each(const std::string& pubkey, F&& f) const {
+        const auto it = buckets_.find(pubkey);
+        if (it == buckets_.end()) {
+            return 0;
+        }
+        for (const auto& hook : it->second.listeners) {
+            f(*hook.listener_);
+        }
+        return it->second.listeners.size();
+    }
+
+    /// Unregister all listeners and call `f` with each of them
+    template <typename F>
+    void notify_all(F&& f) {
+        auto buckets = std::move(buckets_);
+        buckets_.clear();
+        for (auto& entry : buckets) {
+            entry.second.pubkey = nullptr;
+        }
+        for (auto& entry : buckets) {
+            drain(entry.second, f);
+        }
+    }
+
+    /// Number of registered listeners
+    size_t size() const { return size_; }
+
+    /// Number of pubkeys with at least one listener
+    size_t pubkey_count() const { return buckets_.size(); }
+
+    /// Number of listeners registered for `pubkey`
+    size_t count(const std::string& pubkey) const {
+        const auto it = buckets_.find(pubkey);
+        return it == buckets_.end() ? 0 : it->second.listeners.size();
+    }
+};
+
+} // namespace sispop
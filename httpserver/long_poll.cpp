@@ -0,0 +1,40 @@
+#include "long_poll.h"
+
+#include "sispop_logger.h"
+
+namespace sispop {
+
+LongPoll::LongPoll(boost::asio::io_context& ioc, const std::string& pubkey,
+                   size_t max_messages)
+    : timer_(ioc), pubkey_(pubkey), max_messages_(max_messages) {}
+
+void LongPoll::start(TimerWheel::clock::duration timeout,
+                     std::function<void()> on_timeout) {
+    timer_.expires_after(timeout, std::move(on_timeout));
+}
+
+bool LongPoll::notify(boost::optional<message_t> message) {
+
+    // We might have responded already (the long poll has timed out), or
+    // the message is for a long poll we have moved on from
+    if (!pending() || (message && message->pub_key != pubkey_)) {
+        return false;
+    }
+
+    if (message) {
+        SISPOP_LOG(trace, "Processing message notification: {}",
+                   message->data);
+        if (messages_.size() < max_messages_) {
+            messages_.push_back(std::move(*message));
+        }
+    }
+
+    // After any other notifications that are on their way already
+    if (responding_) {
+        return false;
+    }
+    responding_ = true;
+    return true;
+}
+
+} // namespace sispop
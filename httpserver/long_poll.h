@@ -0,0 +1,62 @@
+#pragma once
+
+#include "sispop_common.h"
+#include "timer_wheel.h"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/optional.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace sispop {
+
+/// A client's long poll for the messages of a pubkey, from when it starts
+/// waiting until it gets a response (see `connection_t::poll_db`).
+///
+/// Messages it is notified of are collected until the owner gets to
+/// respond, so that a burst of them is delivered at once (up to
+/// `max_messages`). Any that don't make it are delivered with the client's
+/// consequent (and immediate) retrieve request. Not thread safe: used on
+/// the io_context of the connection only.
+class LongPoll {
+
+    // The timer for giving up on the long poll
+    TimerWheel::timer_t timer_;
+    // Messenger public key that the long poll is for
+    const std::string pubkey_;
+    const size_t max_messages_;
+    // The messages to respond with
+    std::vector<message_t> messages_;
+    // Whether responding is already scheduled
+    bool responding_ = false;
+
+  public:
+    LongPoll(boost::asio::io_context& ioc, const std::string& pubkey,
+             size_t max_messages);
+
+    /// Call `on_timeout` after `timeout`, unless finished before then
+    void start(TimerWheel::clock::duration timeout,
+               std::function<void()> on_timeout);
+
+    /// Take `message` (none if the long poll is to end with what it has);
+    /// true if the owner is to schedule a response, which is only the case
+    /// for the first one since the long poll started. Ignored once the
+    /// long poll is over, and for messages of other pubkeys
+    bool notify(boost::optional<message_t> message);
+
+    /// End the long poll before its timeout, to respond with `messages`;
+    /// false if it is over already (e.g. because it has timed out)
+    bool finish() { return timer_.cancel(); }
+
+    /// Whether the long poll is still waiting for messages
+    bool pending() const { return timer_.pending(); }
+
+    const std::string& pubkey() const { return pubkey_; }
+
+    const std::vector<message_t>& messages() const { return messages_; }
+};
+
+} // namespace sispop
@@ -1,6 +1,7 @@
 #include "channel_encryption.hpp"
 #include "command_line.h"
 #include "http_connection.h"
+#include "https_client.h"
 #include "sispop_logger.h"
 #include "sispopd_key.h"
 #include "rate_limiter.h"
@@ -75,7 +76,29 @@ int main(int argc, char* argv[]) {
         return EXIT_FAILURE;
     }
 
-    sispop::init_logging(options.data_dir, log_level);
+    sispop::log_options_t log_options;
+    log_options.queue_size = options.log_queue_size;
+    log_options.flush_interval = options.log_flush_interval;
+    if (!options.log_pattern.empty()) {
+        log_options.pattern = options.log_pattern;
+    }
+    if (!sispop::parse_log_level(options.log_flush_level,
+                                 log_options.flush_level)) {
+        std::cerr << "Incorrect log flush level: " << options.log_flush_level
+                  << std::endl;
+        sispop::print_log_levels();
+        return EXIT_FAILURE;
+    }
+
+    sispop::init_logging(options.data_dir, log_level, log_options);
+
+    if (log_level < sispop::compiled_log_level()) {
+        SISPOP_LOG(warn,
+                   "Log level {} requested, but this build only emits {} "
+                   "and above (LOG_ACTIVE_LEVEL)",
+                   options.log_level,
+                   spdlog::level::to_string_view(sispop::compiled_log_level()));
+    }
 
     if (options.testnet) {
         sispop::set_testnet();
@@ -94,12 +117,14 @@ int main(int argc, char* argv[]) {
         SISPOP_LOG(critical,
                  "Tried to bind sispop-storage to localhost, please bind "
                  "to outward facing address");
+        sispop::shutdown_logging();
         return EXIT_FAILURE;
     }
 
     if (options.port == options.sispopd_rpc_port) {
         SISPOP_LOG(error, "Storage server port must be different from that of "
                         "Sispopd! Terminating.");
+        sispop::shutdown_logging();
         exit(EXIT_INVALID_PORT);
     }
 
@@ -113,6 +138,7 @@ int main(int argc, char* argv[]) {
 
     if (sodium_init() != 0) {
         SISPOP_LOG(error, "Could not initialize libsodium");
+        sispop::shutdown_logging();
         return EXIT_FAILURE;
     }
 
@@ -185,16 +211,33 @@ int main(int argc, char* argv[]) {
         sispop::Security security(sispopd_key_pair, options.data_dir);
 
         /// Should run http server
+        sispop::tls_session_options_t tls_options;
+        tls_options.cache_size = options.tls_session_cache_size;
+        tls_options.timeout = options.tls_session_timeout;
+        tls_options.ticket_key_rotation = options.tls_ticket_key_rotation;
+
+        sispop::get_https_pool().set_max_idle_per_peer(
+            options.peer_connection_pool_size);
+        sispop::set_enforce_peer_signatures(options.enforce_peer_signatures);
+
+        sispop::http_server::keep_alive_options_t keep_alive;
+        keep_alive.idle_timeout =
+            std::chrono::seconds(options.keep_alive_timeout);
+        keep_alive.max_requests = options.keep_alive_max_requests;
+
         sispop::http_server::run(ioc, options.ip, options.port, options.data_dir,
                                service_node, channel_encryption, rate_limiter,
-                               security);
+                               security, options.threads, tls_options,
+                               keep_alive);
     } catch (const std::exception& e) {
         // It seems possible for logging to throw its own exception,
         // in which case it will be propagated to libc...
         std::cerr << "Exception caught in main: " << e.what() << std::endl;
+        sispop::shutdown_logging();
         return EXIT_FAILURE;
     } catch (...) {
         std::cerr << "Unknown exception caught in main." << std::endl;
+        sispop::shutdown_logging();
         return EXIT_FAILURE;
     }
 }
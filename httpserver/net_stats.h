@@ -1,33 +1,60 @@
 #pragma once
 
+#include <atomic>
+#include <mutex>
 #include <set>
 #include "sispop_logger.h"
 
+// Updated from every thread serving connections
 struct net_stats_t {
 
-    uint32_t connections_in = 0;
-    uint32_t http_connections_out = 0;
-    uint32_t https_connections_out = 0;
+    std::atomic<uint32_t> connections_in{0};
+    std::atomic<uint32_t> http_connections_out{0};
+    std::atomic<uint32_t> https_connections_out{0};
 
-    std::set<int> open_fds;
+    std::atomic<uint64_t> tls_handshakes_full{0};
+    std::atomic<uint64_t> tls_handshakes_resumed{0};
+
+    // Outbound requests to other snodes, by whether they had to set up
+    // a new connection or reused a pooled one
+    std::atomic<uint64_t> https_connections_created{0};
+    std::atomic<uint64_t> https_connections_reused{0};
+
+    // Checks of other snodes' certificate signatures
+    std::atomic<uint64_t> peer_cert_cache_hits{0};
+    std::atomic<uint64_t> peer_cert_cache_misses{0};
+    // Responses whose signature didn't check out (see
+    // set_enforce_peer_signatures)
+    std::atomic<uint64_t> peer_signature_failures{0};
 
     void record_socket_open(int sockfd) {
+        std::lock_guard<std::mutex> lock(fds_mutex_);
 #ifdef INTEGRATION_TEST
-        if (open_fds.find(sockfd) != open_fds.end()) {
+        if (open_fds_.find(sockfd) != open_fds_.end()) {
             SISPOP_LOG(critical, "Already recorded as open: {}!", sockfd);
         }
 #endif
-        open_fds.insert(sockfd);
+        open_fds_.insert(sockfd);
     }
 
     void record_socket_close(int sockfd) {
+        std::lock_guard<std::mutex> lock(fds_mutex_);
 #ifdef INTEGRATION_TEST
-        if (open_fds.find(sockfd) == open_fds.end()) {
+        if (open_fds_.find(sockfd) == open_fds_.end()) {
             SISPOP_LOG(critical, "Socket is NOT recorded as open: {}", sockfd);
         }
 #endif
-        open_fds.erase(sockfd);
+        open_fds_.erase(sockfd);
     }
+
+    size_t open_socket_count() const {
+        std::lock_guard<std::mutex> lock(fds_mutex_);
+        return open_fds_.size();
+    }
+
+  private:
+    mutable std::mutex fds_mutex_;
+    std::set<int> open_fds_;
 };
 
 inline net_stats_t& get_net_stats() {
@@ -48,6 +48,8 @@ bool RateLimiter::should_rate_limit(const std::string& identifier) {
 
 bool RateLimiter::should_rate_limit(const std::string& identifier,
                                     std::chrono::steady_clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
     const auto it = std::find_if(
         buckets_.begin(), buckets_.end(),
         [&](const buffer_pair_t& pair) { return pair.first == identifier; });
@@ -77,6 +79,7 @@ bool RateLimiter::should_rate_limit_client(const std::string& identifier) {
 
 bool RateLimiter::should_rate_limit_client(
     const std::string& identifier, std::chrono::steady_clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex_);
 
     const auto it = client_buckets_.find(identifier);
     if (it != client_buckets_.end()) {
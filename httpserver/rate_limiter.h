@@ -3,12 +3,15 @@
 #include <boost/circular_buffer.hpp>
 
 #include <chrono>
+#include <mutex>
 #include <stdint.h>
 #include <string>
 #include <unordered_map>
 #include <utility> // for std::pair
 
 /// https://en.wikipedia.org/wiki/Token_bucket
+///
+/// Safe to share between threads serving connections
 
 class RateLimiter {
   public:
@@ -28,6 +31,8 @@ class RateLimiter {
                                   std::chrono::steady_clock::time_point now);
 
   private:
+    std::mutex mutex_;
+
     struct TokenBucket {
         uint32_t num_tokens;
         std::chrono::steady_clock::time_point last_time_point;
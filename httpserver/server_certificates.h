@@ -23,6 +23,7 @@ void generate_dh_pem(const char* dh_path) {
     if (dh == NULL) {
         SISPOP_LOG(error, "Alloc for dh failed");
         ERR_print_errors_fp(stderr);
+        sispop::shutdown_logging();
         abort();
     }
     SISPOP_LOG(info, "Generating DH parameter, this might take a while...");
@@ -33,6 +34,7 @@ void generate_dh_pem(const char* dh_path) {
     if (!res) {
         SISPOP_LOG(error, "Alloc for dh failed");
         ERR_print_errors_fp(stderr);
+        sispop::shutdown_logging();
         abort();
     }
 
@@ -76,6 +78,7 @@ int mkcert(X509** x509p, EVP_PKEY** pkeyp, int bits, int serial, int days) {
 
     if ((pkeyp == NULL) || (*pkeyp == NULL)) {
         if ((pk = EVP_PKEY_new()) == NULL) {
+            sispop::shutdown_logging();
             abort();
             return (0);
         }
@@ -16,6 +16,7 @@
 #include <algorithm>
 #include <chrono>
 #include <fstream>
+#include <unordered_set>
 
 #include <boost/bind.hpp>
 
@@ -34,6 +35,21 @@ constexpr std::array<std::chrono::seconds, 8> RETRY_INTERVALS = {
 
 constexpr std::chrono::milliseconds RELAY_INTERVAL = 350ms;
 
+/// Set on the threads marked with `mark_network_thread` (and only there)
+static thread_local Database* thread_db = nullptr;
+
+void ServiceNode::mark_network_thread() {
+    auto db = std::make_unique<Database>(db_location_);
+    thread_db = db.get();
+
+    const std::lock_guard<std::mutex> lock(thread_dbs_mutex_);
+    thread_dbs_.push_back(std::move(db));
+}
+
+bool ServiceNode::on_network_thread() { return thread_db != nullptr; }
+
+Database& ServiceNode::db() const { return thread_db ? *thread_db : *db_; }
+
 static void make_sn_request(boost::asio::io_context& ioc, const sn_record_t& sn,
                             const std::shared_ptr<request_t>& req,
                             http_callback_t&& cb) {
@@ -101,7 +117,6 @@ constexpr std::chrono::seconds STATS_CLEANUP_INTERVAL = 60min;
 constexpr std::chrono::seconds PING_PEERS_INTERVAL = 10s;
 constexpr std::chrono::minutes SISPOPD_PING_INTERVAL = 5min;
 constexpr std::chrono::seconds VERSION_CHECK_INTERVAL = 10min;
-constexpr int CLIENT_RETRIEVE_MESSAGE_LIMIT = 10;
 static std::shared_ptr<request_t> make_push_all_request(std::string&& data) {
     return build_post_request("/swarms/push_batch/v1", std::move(data));
 }
@@ -114,6 +129,7 @@ ServiceNode::ServiceNode(boost::asio::io_context& ioc,
                          SispopdClient& sispopd_client, const bool force_start)
     : ioc_(ioc), worker_ioc_(worker_ioc),
       db_(std::make_unique<Database>(ioc, db_location)),
+      db_location_(db_location),
       swarm_update_timer_(ioc), sispopd_ping_timer_(ioc),
       stats_cleanup_timer_(ioc),
       check_version_timer_(worker_ioc), peer_ping_timer_(ioc),
@@ -121,12 +137,8 @@ ServiceNode::ServiceNode(boost::asio::io_context& ioc,
       sispopd_key_pair_x25519_(key_pair_x25519), sispopd_client_(sispopd_client),
       force_start_(force_start) {
 
-    char buf[64] = {0};
-    if (!util::base32z_encode(sispopd_key_pair_.public_key, buf)) {
-        throw std::runtime_error("Could not encode our public key");
-    }
-
-    const std::string addr = buf;
+    const auto encoded = util::base32z_encode(sispopd_key_pair_.public_key);
+    const std::string addr(encoded.begin(), encoded.end());
     SISPOP_LOG(info, "Our sispop address: {}", addr);
 
     const auto pk_hex = util::as_hex(sispopd_key_pair_.public_key);
@@ -157,76 +169,6 @@ ServiceNode::ServiceNode(boost::asio::io_context& ioc,
                       [this]() { this->check_version_timer_tick(); });
 }
 
-static block_update_t
-parse_swarm_update(const std::shared_ptr<std::string>& response_body) {
-
-    if (!response_body) {
-        SISPOP_LOG(critical, "Bad sispopd rpc response: no response body");
-        throw std::runtime_error("Failed to parse swarm update");
-    }
-    const json body = json::parse(*response_body, nullptr, false);
-
-    std::map<swarm_id_t, std::vector<sn_record_t>> swarm_map;
-    block_update_t bu;
-
-    try {
-        const json service_node_states =
-            body.at("result").at("service_node_states");
-
-        for (const auto& sn_json : service_node_states) {
-            const auto& pubkey =
-                sn_json.at("service_node_pubkey").get_ref<const std::string&>();
-
-            const swarm_id_t swarm_id =
-                sn_json.at("swarm_id").get<swarm_id_t>();
-            std::string snode_address = util::hex_to_base32z(pubkey);
-
-            const uint16_t port = sn_json.at("storage_port").get<uint16_t>();
-            const auto& snode_ip =
-                sn_json.at("public_ip").get_ref<const std::string&>();
-
-            const auto& pubkey_x25519 =
-                sn_json.at("pubkey_x25519").get_ref<const std::string&>();
-
-            const auto& pubkey_ed25519 =
-                sn_json.at("pubkey_ed25519").get_ref<const std::string&>();
-
-            const auto sn =
-                sn_record_t{port,          std::move(snode_address), pubkey,
-                            pubkey_x25519, pubkey_ed25519,           snode_ip};
-
-            const bool fully_funded = sn_json.at("funded").get<bool>();
-
-            /// We want to include (test) decommissioned nodes, but not
-            /// partially funded ones.
-            if (!fully_funded) {
-                continue;
-            }
-
-            /// Storing decommissioned nodes (with dummy swarm id) in
-            /// a separate data structure as it seems less error prone
-            if (swarm_id == INVALID_SWARM_ID) {
-                bu.decommissioned_nodes.push_back(sn);
-            } else {
-                swarm_map[swarm_id].push_back(sn);
-            }
-        }
-
-        bu.height = body.at("result").at("height").get<uint64_t>();
-        bu.block_hash = body.at("result").at("block_hash").get<std::string>();
-        bu.hardfork = body.at("result").at("hardfork").get<int>();
-
-    } catch (...) {
-      
-    }
-
-    for (auto const& swarm : swarm_map) {
-        bu.swarms.emplace_back(SwarmInfo{swarm.first, swarm.second});
-    }
-
-    return bu;
-}
-
 void ServiceNode::bootstrap_data() {
     SISPOP_LOG(trace, "Bootstrapping peer data");
 
@@ -302,9 +244,12 @@ bool ServiceNode::snode_ready(boost::optional<std::string&> reason) {
         buf += "not yet on hardfork 12; ";
         ready = false;
     }
-    if (!swarm_ || !swarm_->is_valid()) {
-        buf += "not in any swarm; ";
-        ready = false;
+    {
+        const std::shared_lock<std::shared_mutex> lock(swarm_mutex_);
+        if (!swarm_ || !swarm_->is_valid()) {
+            buf += "not in any swarm; ";
+            ready = false;
+        }
     }
     if (syncing_) {
         buf += "not done syncing; ";
@@ -358,85 +303,57 @@ void ServiceNode::relay_data_reliable(const std::shared_ptr<request_t>& req,
 void ServiceNode::register_listener(const std::string& pk,
                                     const std::shared_ptr<connection_t>& c) {
 
-    // NOTE: it is the responsibility of connection_t to deregister itself!
-    pk_to_listeners[pk].push_back(c);
-    SISPOP_LOG(debug, "Register pubkey: {}, total pubkeys: {}", pk,
-             pk_to_listeners.size());
+    const std::lock_guard<std::mutex> lock(listeners_mutex_);
 
-    SISPOP_LOG(debug, "Number of connections listening for {}: {}", pk,
-             pk_to_listeners[pk].size());
+    // NOTE: it is the responsibility of connection_t to deregister itself!
+    listeners_.add(pk, c->listener_hook, c);
+    SISPOP_LOG(trace, "Register pubkey: {}, connections listening for it: {}",
+               pk, listeners_.count(pk));
 }
 
-void ServiceNode::remove_listener(const std::string& pk,
-                                  const connection_t* const c) {
+void ServiceNode::remove_listener(connection_t* const c) {
 
-    const auto it = pk_to_listeners.find(pk);
-    if (it == pk_to_listeners.end()) {
-        /// This will sometimes happen because we reset all listeners on
-        /// push_all
-        SISPOP_LOG(debug, "Trying to remove an unknown pk from the notification "
-                        "map. Operation ignored.");
-    } else {
-        SISPOP_LOG(trace,
-                 "Deregistering notification for connection {} for pk {}",
-                 c->conn_idx, pk);
-        auto& cs = it->second;
-        const auto new_end = std::remove_if(
-            cs.begin(), cs.end(), [c](const std::shared_ptr<connection_t>& e) {
-                return e.get() == c;
-            });
-        const auto count = std::distance(new_end, cs.end());
-        cs.erase(new_end, cs.end());
+    const std::lock_guard<std::mutex> lock(listeners_mutex_);
 
-        if (count == 0) {
-            SISPOP_LOG(debug, "Connection {} in not registered for pk {}",
-                     c->conn_idx, pk);
-        } else if (count > 1) {
-            SISPOP_LOG(debug,
-                     "Multiple registrations ({}) for connection {} for pk {}",
-                     count, c->conn_idx, pk);
-        }
+    /// Already gone if reset (see reset_listeners)
+    if (listeners_.remove(c->listener_hook)) {
+        SISPOP_LOG(trace, "Deregistered notification for connection {}",
+                   c->conn_idx);
     }
 }
 
 void ServiceNode::notify_listeners(const std::string& pk,
                                    const message_t& msg) {
 
-    auto it = pk_to_listeners.find(pk);
+    const std::lock_guard<std::mutex> lock(listeners_mutex_);
 
-    if (it != pk_to_listeners.end()) {
+    // Listeners keep collecting messages until they respond (and remove
+    // themselves)
+    const size_t count = listeners_.for_each(
+        pk, [&msg](connection_t& c) { c.notify(msg); });
 
-        auto& listeners = it->second;
-
-        SISPOP_LOG(debug, "number of notified listeners: {}", listeners.size());
-
-        for (auto& c : listeners) {
-            c->notify(msg);
-        }
-        pk_to_listeners.erase(it);
+    if (count) {
+        SISPOP_LOG(debug, "number of notified listeners: {}", count);
     }
 }
 
 void ServiceNode::reset_listeners() {
 
+    const std::lock_guard<std::mutex> lock(listeners_mutex_);
+
     /// It is probably not worth it to try to
     /// determine which connections needn't
     /// be reset (most of them will need to be),
     /// so we just reset all connections for
     /// simplicity
-    for (auto& entry : pk_to_listeners) {
-        for (auto& c : entry.second) {
-            /// notify with no messages
-            c->notify(boost::none);
-        }
-    }
-
-    pk_to_listeners.clear();
+    listeners_.notify_all([](connection_t& c) {
+        /// notify with no messages
+        c.notify(boost::none);
+    });
 }
 
 /// do this asynchronously on a different thread? (on the same thread?)
 bool ServiceNode::process_store(const message_t& msg) {
-
     /// only accept a message if we are in a swarm
     if (!swarm_) {
         // This should never be printed now that we have "snode_ready"
@@ -451,7 +368,12 @@ bool ServiceNode::process_store(const message_t& msg) {
 
     // Instead of sending the messages immediatly, store them in a buffer
     // and periodically send all messages from there as batches
-    this->relay_buffer_.push_back(msg);
+    if (on_network_thread()) {
+        boost::asio::post(ioc_,
+                          [this, msg]() { this->relay_buffer_.push_back(msg); });
+    } else {
+        this->relay_buffer_.push_back(msg);
+    }
 
     return true;
 }
@@ -463,7 +385,17 @@ void ServiceNode::process_push(const message_t& msg) {
 void ServiceNode::process_proxy_req(const std::string& req_body,
                                     const std::string& sender_key,
                                     const std::string& target_snode,
+                                    const std::string& enc_type,
                                     http_callback_t&& on_proxy_response) {
+    if (on_network_thread()) {
+        boost::asio::post(ioc_, [this, req_body, sender_key, target_snode,
+                                 enc_type, on_proxy_response = std::move(
+                                               on_proxy_response)]() mutable {
+            process_proxy_req(req_body, sender_key, target_snode, enc_type,
+                              std::move(on_proxy_response));
+        });
+        return;
+    }
 
     auto sn = swarm_->find_node_by_ed25519_pk(target_snode);
 
@@ -479,6 +411,9 @@ void ServiceNode::process_proxy_req(const std::string& req_body,
     auto req = build_post_request("/swarms/proxy_exit", std::move(body_clone));
 
     req->insert(SISPOP_SENDER_KEY_HEADER, sender_key);
+    if (!enc_type.empty()) {
+        req->insert(SISPOP_ENC_TYPE_HEADER, enc_type);
+    }
 
     this->sign_request(req);
 
@@ -487,7 +422,7 @@ void ServiceNode::process_proxy_req(const std::string& req_body,
 
 void ServiceNode::save_if_new(const message_t& msg) {
 
-    if (db_->store(msg.hash, msg.pub_key, msg.data, msg.ttl, msg.timestamp,
+    if (db().store(msg.hash, msg.pub_key, msg.data, msg.ttl, msg.timestamp,
                    msg.nonce)) {
         notify_listeners(msg.pub_key, msg);
         SISPOP_LOG(trace, "saved message: {}", msg.data);
@@ -496,7 +431,7 @@ void ServiceNode::save_if_new(const message_t& msg) {
 
 void ServiceNode::save_bulk(const std::vector<Item>& items) {
 
-    if (!db_->bulk_store(items)) {
+    if (!db().bulk_store(items)) {
         SISPOP_LOG(error, "failed to save batch to the database");
         return;
     }
@@ -511,7 +446,10 @@ void ServiceNode::save_bulk(const std::vector<Item>& items) {
 
 void ServiceNode::on_bootstrap_update(const block_update_t& bu) {
 
-    swarm_->apply_swarm_changes(bu.swarms);
+    {
+        const std::unique_lock<std::shared_mutex> lock(swarm_mutex_);
+        swarm_->apply_swarm_changes(bu.swarms);
+    }
     target_height_ = std::max(target_height_, bu.height);
 }
 
@@ -560,7 +498,10 @@ void ServiceNode::on_swarm_update(const block_update_t& bu) {
 
     const SwarmEvents events = swarm_->derive_swarm_events(bu.swarms);
 
-    swarm_->set_swarm_id(events.our_swarm_id);
+    {
+        const std::unique_lock<std::shared_mutex> lock(swarm_mutex_);
+        swarm_->set_swarm_id(events.our_swarm_id);
+    }
 
     std::string reason;
     if (!snode_ready(boost::optional<std::string&>(reason))) {
@@ -579,7 +520,24 @@ void ServiceNode::on_swarm_update(const block_update_t& bu) {
         }
     }
 
-    swarm_->update_state(bu.swarms, bu.decommissioned_nodes, events);
+    {
+        const std::unique_lock<std::shared_mutex> lock(swarm_mutex_);
+        swarm_->update_state(bu.swarms, bu.decommissioned_nodes, events);
+    }
+
+    {
+        // Don't keep vouching for certificates of nodes that have left
+        std::unordered_set<std::string> known_pubkeys;
+        for (const auto& swarm : bu.swarms) {
+            for (const auto& sn : swarm.snodes) {
+                known_pubkeys.insert(sn.pub_key_base32z());
+            }
+        }
+        for (const auto& sn : bu.decommissioned_nodes) {
+            known_pubkeys.insert(sn.pub_key_base32z());
+        }
+        get_peer_cert_cache().retain(known_pubkeys);
+    }
 
     if (!events.new_snodes.empty()) {
         bootstrap_peers(events.new_snodes);
@@ -643,12 +601,32 @@ void ServiceNode::swarm_timer_tick() {
 
     params["active_only"] = false;
 
+    // Sispopd leaves the nodes out if the block hasn't changed since (older
+    // versions ignore this and send everything, which is handled below)
+    if (!block_hash_.empty()) {
+        params["poll_block_hash"] = block_hash_;
+    }
+
     sispopd_client_.make_sispopd_request(
         "get_n_service_nodes", params, [this](const sn_response_t&& res) {
             if (res.error_code == SNodeError::NO_ERROR) {
+                if (res.body) {
+                    all_stats_.bump_swarm_update_bytes(res.body->size());
+                }
                 try {
-                    const block_update_t bu = parse_swarm_update(res.body);
-                    on_swarm_update(bu);
+                    // Most ticks happen within the same block, for which
+                    // there is nothing to parse
+                    if (!syncing_ && res.body && !block_hash_.empty() &&
+                        peek_block_hash(*res.body) == block_hash_) {
+                        SISPOP_LOG(trace, "already seen this block");
+                    } else {
+                        const block_update_t bu = parse_swarm_update(res.body);
+                        if (bu.unchanged) {
+                            SISPOP_LOG(trace, "already seen this block");
+                        } else {
+                            on_swarm_update(bu);
+                        }
+                    }
                 } catch (const std::exception& e) {
                     SISPOP_LOG(error, "Exception caught on swarm update: {}",
                              e.what());
@@ -680,6 +658,9 @@ void ServiceNode::ping_peers_tick() {
     this->peer_ping_timer_.async_wait(
         std::bind(&ServiceNode::ping_peers_tick, this));
 
+    // Connections to nodes we no longer talk to would stay open otherwise
+    get_https_pool().evict_idle();
+
     /// TODO: To be safe, let's not even test peers until we
     /// have reached the right hardfork height
     if (hardfork_ < ENFORCED_REACHABILITY_HARDFORK) {
@@ -809,6 +790,13 @@ make_batch_requests(std::vector<std::string>&& data) {
 void ServiceNode::perform_blockchain_test(
     bc_test_params_t test_params,
     std::function<void(blockchain_test_answer_t)>&& cb) const {
+    if (on_network_thread()) {
+        boost::asio::post(ioc_, [this, test_params,
+                                 cb = std::move(cb)]() mutable {
+            perform_blockchain_test(test_params, std::move(cb));
+        });
+        return;
+    }
 
     SISPOP_LOG(debug, "Delegating blockchain test to Sispopd");
 
@@ -866,6 +854,7 @@ void ServiceNode::attach_pubkey(std::shared_ptr<request_t>& request) const {
 void abort_if_integration_test() {
 #ifdef INTEGRATION_TEST
     SISPOP_LOG(critical, "ABORT in integration test");
+    sispop::shutdown_logging();
     abort();
 #endif
 }
@@ -1160,6 +1149,12 @@ bool ServiceNode::derive_tester_testee(uint64_t blk_height, sn_record_t& tester,
 MessageTestStatus ServiceNode::process_storage_test_req(
     uint64_t blk_height, const std::string& tester_pk,
     const std::string& msg_hash, std::string& answer) {
+    if (on_network_thread()) {
+        return run_on_ioc([&]() {
+            return process_storage_test_req(blk_height, tester_pk, msg_hash,
+                                            answer);
+        });
+    }
 
     // 1. Check height, retry if we are behind
     std::string block_hash;
@@ -1388,7 +1383,8 @@ void ServiceNode::bootstrap_swarms(
                 continue;
             }
 
-            swarm_id = get_swarm_by_pk(all_swarms, pk);
+            const SwarmInfo* swarm = swarm_->get_swarm_by_pk(pk);
+            swarm_id = swarm ? swarm->swarm_id : INVALID_SWARM_ID;
             cache.insert({entry.pub_key, swarm_id});
         } else {
             swarm_id = it->second;
@@ -1465,7 +1461,7 @@ void ServiceNode::salvage_data() const {
 bool ServiceNode::retrieve(const std::string& pubKey,
                            const std::string& last_hash,
                            std::vector<Item>& items) {
-    return db_->retrieve(pubKey, items, last_hash,
+    return db().retrieve(pubKey, items, last_hash,
                          CLIENT_RETRIEVE_MESSAGE_LIMIT);
 }
 
@@ -1488,6 +1484,12 @@ static nlohmann::json to_json(const all_stats_t& stats) {
     json["previous_period_retrieve_requests"] =
         stats.get_previous_period_retrieve_requests();
 
+    // The period is an hour (STATS_CLEANUP_INTERVAL)
+    json["total_swarm_update_bytes"] = stats.get_total_swarm_update_bytes();
+    json["recent_swarm_update_bytes"] = stats.get_recent_swarm_update_bytes();
+    json["previous_period_swarm_update_bytes"] =
+        stats.get_previous_period_swarm_update_bytes();
+
     json["reset_time"] = stats.get_reset_time();
 
     nlohmann::json peers;
@@ -1506,6 +1508,9 @@ static nlohmann::json to_json(const all_stats_t& stats) {
 }
 
 std::string ServiceNode::get_stats() const {
+    if (on_network_thread()) {
+        return run_on_ioc([&]() { return get_stats(); });
+    }
 
     auto val = to_json(all_stats_);
 
@@ -1518,10 +1523,37 @@ std::string ServiceNode::get_stats() const {
         val["total_stored"] = total_stored;
     }
 
-    val["connections_in"] = get_net_stats().connections_in;
-    val["http_connections_out"] = get_net_stats().http_connections_out;
-    val["https_connections_out"] = get_net_stats().https_connections_out;
-    val["open_socket_count"] = get_net_stats().open_fds.size();
+    val["connections_in"] = get_net_stats().connections_in.load();
+    val["http_connections_out"] = get_net_stats().http_connections_out.load();
+    val["https_connections_out"] =
+        get_net_stats().https_connections_out.load();
+    val["open_socket_count"] = get_net_stats().open_socket_count();
+    val["tls_handshakes_full"] = get_net_stats().tls_handshakes_full.load();
+    val["tls_handshakes_resumed"] =
+        get_net_stats().tls_handshakes_resumed.load();
+    val["https_connections_created"] =
+        get_net_stats().https_connections_created.load();
+    val["https_connections_reused"] =
+        get_net_stats().https_connections_reused.load();
+    val["https_connections_idle"] = get_https_pool().idle_count();
+    val["peer_cert_cache_hits"] = get_net_stats().peer_cert_cache_hits.load();
+    val["peer_cert_cache_misses"] =
+        get_net_stats().peer_cert_cache_misses.load();
+    val["peer_signature_failures"] =
+        get_net_stats().peer_signature_failures.load();
+    val["snode_signature_cache_hits"] = get_snode_signature_cache().hits();
+    val["snode_signature_cache_misses"] = get_snode_signature_cache().misses();
+    if (swarm_) {
+        const uint64_t hits = swarm_->swarm_cache_hits();
+        const uint64_t misses = swarm_->swarm_cache_misses();
+        val["swarm_cache_hits"] = hits;
+        val["swarm_cache_misses"] = misses;
+        val["swarm_cache_hit_ratio"] =
+            hits + misses ? static_cast<double>(hits) / (hits + misses) : 0.0;
+    }
+    val["listeners"] = listeners_.size();
+    val["listener_pubkeys"] = listeners_.pubkey_count();
+    val["dropped_log_messages"] = get_dropped_log_count();
 
     /// we want pretty (indented) json, but might change that in the future
     constexpr bool PRETTY = true;
@@ -1531,10 +1563,9 @@ std::string ServiceNode::get_stats() const {
 
 
 bool ServiceNode::get_all_messages(std::vector<Item>& all_entries) const {
-
     SISPOP_LOG(trace, "Get all messages");
 
-    return db_->retrieve("", all_entries, "");
+    return db().retrieve("", all_entries, "");
 }
 
 void ServiceNode::process_push_batch(const std::string& blob) {
@@ -1568,6 +1599,9 @@ void ServiceNode::process_push_batch(const std::string& blob) {
 }
 
 bool ServiceNode::is_pubkey_for_us(const user_pubkey_t& pk) const {
+
+    const std::shared_lock<std::shared_mutex> lock(swarm_mutex_);
+
     if (!swarm_) {
         SISPOP_LOG(error, "Swarm data missing");
         return false;
@@ -1578,30 +1612,27 @@ bool ServiceNode::is_pubkey_for_us(const user_pubkey_t& pk) const {
 std::vector<sn_record_t>
 ServiceNode::get_snodes_by_pk(const user_pubkey_t& pk) {
 
+    const std::shared_lock<std::shared_mutex> lock(swarm_mutex_);
+
     if (!swarm_) {
         SISPOP_LOG(error, "Swarm data missing");
         return {};
     }
 
-    const auto& all_swarms = swarm_->all_valid_swarms();
+    const SwarmInfo* swarm = swarm_->get_swarm_by_pk(pk);
 
-    swarm_id_t swarm_id = get_swarm_by_pk(all_swarms, pk);
-
-    // TODO: have get_swarm_by_pk return idx into all_swarms instead,
-    // so we don't have to find it again
-
-    for (const auto& si : all_swarms) {
-        if (si.swarm_id == swarm_id)
-            return si.snodes;
+    if (!swarm) {
+        SISPOP_LOG(critical, "Something went wrong in get_snodes_by_pk");
+        return {};
     }
 
-    SISPOP_LOG(critical, "Something went wrong in get_snodes_by_pk");
-
-    return {};
+    return swarm->snodes;
 }
 
 bool ServiceNode::is_snode_address_known(const std::string& sn_address) {
 
+    const std::shared_lock<std::shared_mutex> lock(swarm_mutex_);
+
     // TODO: need more robust handling of uninitialized swarm_
     if (!swarm_) {
         SISPOP_LOG(error, "Swarm data missing");
@@ -1,11 +1,16 @@
 #pragma once
 
 #include <Database.hpp>
+#include <atomic>
 #include <chrono>
 #include <fstream>
+#include <future>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <unordered_map>
+#include <vector>
 
 #include <boost/asio.hpp>
 #include <boost/beast/http.hpp>
@@ -13,6 +18,7 @@
 #include <boost/optional.hpp>
 #include <boost/thread/thread.hpp>
 
+#include "listener_registry.h"
 #include "sispop_common.h"
 #include "sispopd_key.h"
 #include "reachability_testing.h"
@@ -22,6 +28,8 @@
 static constexpr size_t BLOCK_HASH_CACHE_SIZE = 30;
 static constexpr int STORAGE_SERVER_HARDFORK = 12;
 static constexpr int ENFORCED_REACHABILITY_HARDFORK = 13;
+/// The most messages a client gets for a retrieve request, or a long poll
+static constexpr int CLIENT_RETRIEVE_MESSAGE_LIMIT = 10;
 
 class Database;
 
@@ -84,22 +92,38 @@ class FailedRequestHandler
 /// WRONG_REQ - request was ignored as not valid (e.g. incorrect tester)
 enum class MessageTestStatus { SUCCESS, RETRY, ERROR, WRONG_REQ };
 
-/// All service node logic that is not network-specific
+/// All service node logic that is not network-specific.
+///
+/// Service node state is only ever changed on `ioc_`. Connections may be
+/// served by other threads (see `http_server::run`), which don't wait for
+/// `ioc_` on the common requests: they store and retrieve messages on a
+/// database connection of their own, look the swarms up under
+/// `swarm_mutex_` and (de)register listeners under `listeners_mutex_`.
+/// Proxy and blockchain test requests are posted to `ioc_` (with callbacks
+/// invoked there); the rare storage tests and stats run on `ioc_` while
+/// the calling thread waits.
 class ServiceNode {
     using pub_key_t = std::string;
-    using listeners_t = std::vector<connection_ptr>;
 
     boost::asio::io_context& ioc_;
     boost::asio::io_context& worker_ioc_;
 
-    bool syncing_ = true;
-    int hardfork_ = 0;
+    std::atomic<bool> syncing_{true};
+    std::atomic<int> hardfork_{0};
     uint64_t block_height_ = 0;
     uint64_t target_height_ = 0;
     const SispopdClient& sispopd_client_;
     std::string block_hash_;
     std::unique_ptr<Swarm> swarm_;
+    /// Taken by `ioc_` to change the swarms, and by other threads to read
+    /// them (`ioc_` reads them as is)
+    mutable std::shared_mutex swarm_mutex_;
     std::unique_ptr<Database> db_;
+    const std::string db_location_;
+    /// Connections to the database of the threads marked with
+    /// `mark_network_thread`
+    std::vector<std::unique_ptr<Database>> thread_dbs_;
+    std::mutex thread_dbs_mutex_;
 
     sn_record_t our_address_;
 
@@ -120,8 +144,9 @@ class ServiceNode {
     /// Used to periodially send messages from relay_buffer_
     boost::asio::steady_timer relay_timer_;
 
-    /// map pubkeys to a list of connections to be notified
-    std::unordered_map<pub_key_t, listeners_t> pk_to_listeners;
+    /// Connections to be notified of new messages, by pubkey
+    ListenerRegistry<http_server::connection_t> listeners_;
+    std::mutex listeners_mutex_;
 
     sispop::sispopd_key_pair_t sispopd_key_pair_;
     sispop::sispopd_key_pair_t sispopd_key_pair_x25519_;
@@ -225,6 +250,16 @@ class ServiceNode {
     // Ping some node and record its reachability
     void test_reachability(const sn_record_t& sn);
 
+    /// Whether the calling thread was marked with `mark_network_thread`
+    static bool on_network_thread();
+
+    /// The database connection of the calling thread
+    Database& db() const;
+
+    /// Run `f` on `ioc_` and wait for its result
+    template <typename F>
+    auto run_on_ioc(F&& f) const -> decltype(f());
+
   public:
     ServiceNode(boost::asio::io_context& ioc,
                 boost::asio::io_context& worker_ioc, uint16_t port,
@@ -237,6 +272,11 @@ class ServiceNode {
 
     mutable all_stats_t all_stats_;
 
+    /// Mark the calling thread as one serving connections in parallel with
+    /// `ioc_`, giving it a database connection of its own (for as long as
+    /// this service node lives)
+    void mark_network_thread();
+
     // Return true if the service node is ready to start running
     bool snode_ready(boost::optional<std::string&> reason);
 
@@ -244,8 +284,8 @@ class ServiceNode {
     void register_listener(const std::string& pk,
                            const connection_ptr& connection);
 
-    void remove_listener(const std::string& pk,
-                         const http_server::connection_t* const connection);
+    // Deregister a connection (if still registered)
+    void remove_listener(http_server::connection_t* connection);
 
     // Notify listeners of a new message for pk
     void notify_listeners(const std::string& pk, const message_t& msg);
@@ -260,6 +300,7 @@ class ServiceNode {
     void
     process_proxy_req(const std::string& req, const std::string& sender_key,
                       const std::string& target_snode,
+                      const std::string& enc_type,
                       std::function<void(sn_response_t)>&& on_proxy_response);
 
     /// Process message relayed from another SN from our swarm
@@ -294,4 +335,13 @@ class ServiceNode {
     std::string get_stats() const;
 };
 
+template <typename F>
+auto ServiceNode::run_on_ioc(F&& f) const -> decltype(f()) {
+
+    std::packaged_task<decltype(f())()> task(std::forward<F>(f));
+    auto result = task.get_future();
+    boost::asio::post(ioc_, [&task]() { task(); });
+    return result.get();
+}
+
 } // namespace sispop
@@ -0,0 +1,50 @@
+#include "signature_batcher.h"
+
+#include <boost/asio/post.hpp>
+
+namespace sispop {
+
+boost::asio::io_context::id SignatureBatcher::id;
+
+SignatureBatcher& SignatureBatcher::get(boost::asio::io_context& ioc) {
+    return boost::asio::use_service<SignatureBatcher>(ioc);
+}
+
+SignatureBatcher::SignatureBatcher(boost::asio::io_context& ioc)
+    : boost::asio::io_context::service(ioc), ioc_(ioc) {}
+
+void SignatureBatcher::check(const signature_check_t& check,
+                             std::function<void(bool)> callback) {
+    // The first one of a batch schedules checking it, after whatever else
+    // is ready to run (which might add to it)
+    if (checks_.empty()) {
+        boost::asio::post(ioc_, [this]() { check_all(); });
+    }
+    checks_.push_back(check);
+    callbacks_.push_back(std::move(callback));
+}
+
+void SignatureBatcher::check_all() {
+
+    // Callbacks can queue checks of their own, for the next batch
+    std::vector<signature_check_t> checks;
+    std::vector<std::function<void(bool)>> callbacks;
+    checks.swap(checks_);
+    callbacks.swap(callbacks_);
+
+    const auto valid = check_signatures(checks);
+    batches_++;
+    checked_ += checks.size();
+
+    for (size_t i = 0; i < callbacks.size(); ++i) {
+        callbacks[i](valid[i]);
+    }
+}
+
+void SignatureBatcher::shutdown() {
+    // The callbacks might hold on to connections
+    checks_.clear();
+    callbacks_.clear();
+}
+
+} // namespace sispop
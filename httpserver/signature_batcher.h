@@ -0,0 +1,53 @@
+#pragma once
+
+#include "signature.h"
+
+#include <boost/asio/io_context.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace sispop {
+
+/// Signatures that the connections of an io_context need checked, collected
+/// while the handlers that are ready to run do so, then checked together
+/// with `check_signatures` (one batcher per io_context, see `get`). Peers
+/// bootstrapping us push their batches at about the same time, and so end
+/// up sharing the cost of a batch.
+///
+/// Nothing ever waits for a batch: the callbacks run from a handler posted
+/// to the io_context, on its thread, like the connections. Not thread safe
+/// for that reason.
+class SignatureBatcher : public boost::asio::io_context::service {
+
+    boost::asio::io_context& ioc_;
+
+    std::vector<signature_check_t> checks_;
+    std::vector<std::function<void(bool)>> callbacks_;
+
+    uint64_t batches_ = 0;
+    uint64_t checked_ = 0;
+
+    void check_all();
+
+    void shutdown() override;
+
+  public:
+    static boost::asio::io_context::id id;
+
+    /// The batcher of `ioc` (created on first use)
+    static SignatureBatcher& get(boost::asio::io_context& ioc);
+
+    explicit SignatureBatcher(boost::asio::io_context& ioc);
+
+    /// Call `callback` with whether `check` passes, once the signatures
+    /// queued along with it have been checked
+    void check(const signature_check_t& check,
+               std::function<void(bool)> callback);
+
+    uint64_t batches() const { return batches_; }
+    uint64_t checked() const { return checked_; }
+};
+
+} // namespace sispop
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "sispop_common.h"
+#include <atomic>
 #include <ctime>
 #include <deque>
 #include <unordered_map>
@@ -48,20 +49,29 @@ struct peer_stats_t {
     std::deque<test_result_t> blockchain_tests;
 };
 
+/// Request counters may be bumped from any thread serving connections;
+/// everything else is only accessed on the service node's io_context
 class all_stats_t {
 
     // ===== This node's stats =====
-    uint64_t total_client_store_requests = 0;
+    std::atomic<uint64_t> total_client_store_requests{0};
     // Number of requests in the latest x min interval
-    uint64_t previous_period_store_requests = 0;
+    std::atomic<uint64_t> previous_period_store_requests{0};
     // Number of requests after the latest x min interval
-    uint64_t recent_store_requests = 0;
+    std::atomic<uint64_t> recent_store_requests{0};
 
-    uint64_t total_client_retrieve_requests = 0;
+    std::atomic<uint64_t> total_client_retrieve_requests{0};
     // Number of requests in the latest x min interval
-    uint64_t previous_period_retrieve_requests = 0;
+    std::atomic<uint64_t> previous_period_retrieve_requests{0};
     // Number of requests after the latest x min interval
-    uint64_t recent_retrieve_requests = 0;
+    std::atomic<uint64_t> recent_retrieve_requests{0};
+
+    // Bytes of sispopd's responses to get_n_service_nodes
+    std::atomic<uint64_t> total_swarm_update_bytes{0};
+    // In the latest x min interval
+    std::atomic<uint64_t> previous_period_swarm_update_bytes{0};
+    // After the latest x min interval
+    std::atomic<uint64_t> recent_swarm_update_bytes{0};
 
     time_t reset_time_ = time(nullptr);
     // =============================
@@ -69,10 +79,11 @@ class all_stats_t {
     /// update period moving recent request counters to
     /// the `previous period`
     void next_period() {
-        previous_period_store_requests = recent_store_requests;
-        previous_period_retrieve_requests = recent_retrieve_requests;
-        recent_store_requests = 0;
-        recent_retrieve_requests = 0;
+        previous_period_store_requests = recent_store_requests.exchange(0);
+        previous_period_retrieve_requests =
+            recent_retrieve_requests.exchange(0);
+        previous_period_swarm_update_bytes =
+            recent_swarm_update_bytes.exchange(0);
     }
 
   public:
@@ -111,6 +122,11 @@ class all_stats_t {
         recent_retrieve_requests++;
     }
 
+    void bump_swarm_update_bytes(uint64_t bytes) {
+        total_swarm_update_bytes += bytes;
+        recent_swarm_update_bytes += bytes;
+    }
+
     uint64_t get_total_store_requests() const {
         return total_client_store_requests;
     }
@@ -133,6 +149,18 @@ class all_stats_t {
         return previous_period_retrieve_requests;
     }
 
+    uint64_t get_total_swarm_update_bytes() const {
+        return total_swarm_update_bytes;
+    }
+
+    uint64_t get_recent_swarm_update_bytes() const {
+        return recent_swarm_update_bytes;
+    }
+
+    uint64_t get_previous_period_swarm_update_bytes() const {
+        return previous_period_swarm_update_bytes;
+    }
+
     time_t get_reset_time() const { return reset_time_; }
 };
 
@@ -4,6 +4,10 @@
 
 #include "service_node.h"
 
+#include <algorithm>
+#include <cctype>
+#include <map>
+#include <mutex>
 #include <stdlib.h>
 #include <unordered_map>
 #include <ostream>
@@ -12,6 +16,9 @@
 
 namespace sispop {
 
+/// Pubkeys to remember the swarm of, many more than are active at a time
+constexpr size_t SWARM_CACHE_SIZE = 10000;
+
 static bool swarm_exists(const all_swarms_t& all_swarms,
                          const swarm_id_t& swarm) {
 
@@ -40,14 +47,448 @@ void debug_print(std::ostream& os, const block_update_t& bu) {
     os << "}\n";
 }
 
+namespace {
+
+/// A scalar from the response, converted the way nlohmann::json::get would
+class sax_value_t {
+
+    enum class kind_t { missing, string, boolean, integer, unsigned_, real, other };
+
+    kind_t kind_ = kind_t::missing;
+    std::string str_;
+    bool boolean_ = false;
+    int64_t integer_ = 0;
+    uint64_t unsigned_ = 0;
+    double real_ = 0;
+
+  public:
+    void reset() { kind_ = kind_t::missing; }
+
+    void set_string(std::string& val) {
+        kind_ = kind_t::string;
+        str_.swap(val);
+    }
+    void set_boolean(bool val) {
+        kind_ = kind_t::boolean;
+        boolean_ = val;
+    }
+    void set_integer(int64_t val) {
+        kind_ = kind_t::integer;
+        integer_ = val;
+    }
+    void set_unsigned(uint64_t val) {
+        kind_ = kind_t::unsigned_;
+        unsigned_ = val;
+    }
+    void set_real(double val) {
+        kind_ = kind_t::real;
+        real_ = val;
+    }
+    /// null, an object or an array
+    void set_other() { kind_ = kind_t::other; }
+
+    bool is_string() const { return kind_ == kind_t::string; }
+    bool is_boolean() const { return kind_ == kind_t::boolean; }
+    bool is_number() const {
+        return kind_ == kind_t::integer || kind_ == kind_t::unsigned_ ||
+               kind_ == kind_t::real;
+    }
+
+    std::string& str() { return str_; }
+    bool boolean() const { return boolean_; }
+
+    template <typename T>
+    T number() const {
+        return kind_ == kind_t::integer ? static_cast<T>(integer_)
+               : kind_ == kind_t::unsigned_ ? static_cast<T>(unsigned_)
+                                            : static_cast<T>(real_);
+    }
+};
+
+/// Builds a block update from the response as it is being parsed, without
+/// a DOM. Mirrors what walking the DOM did: nothing on invalid JSON or
+/// without a "result.service_node_states" array, and only the nodes before
+/// the first one with a missing (or mistyped) field, in which case the
+/// height, hash and hardfork are left out too.
+class swarm_update_sax_t : public nlohmann::json_sax<nlohmann::json> {
+
+    enum class field_t {
+        other,
+        result,
+        service_node_states,
+        height,
+        block_hash,
+        hardfork,
+        unchanged,
+        service_node_pubkey,
+        swarm_id,
+        storage_port,
+        public_ip,
+        pubkey_x25519,
+        pubkey_ed25519,
+        funded,
+    };
+
+    static constexpr size_t NUM_FIELDS = static_cast<size_t>(field_t::funded) + 1;
+
+    /// Number of open objects and arrays
+    size_t depth_ = 0;
+    /// Depth of the (last) object or array that is not of interest
+    size_t skip_depth_ = 0;
+    bool in_result_ = false;
+    bool in_states_ = false;
+    bool in_node_ = false;
+    bool seen_states_ = false;
+    /// Set on the first node that doesn't have all of its fields
+    bool failed_ = false;
+    field_t field_ = field_t::other;
+    sax_value_t values_[NUM_FIELDS];
+
+    std::map<swarm_id_t, std::vector<sn_record_t>> swarm_map_;
+    std::vector<sn_record_t> decommissioned_;
+
+    sax_value_t& value(field_t field) {
+        return values_[static_cast<size_t>(field)];
+    }
+
+    static field_t result_field(const std::string& key) {
+        if (key == "service_node_states")
+            return field_t::service_node_states;
+        if (key == "height")
+            return field_t::height;
+        if (key == "block_hash")
+            return field_t::block_hash;
+        if (key == "hardfork")
+            return field_t::hardfork;
+        if (key == "unchanged")
+            return field_t::unchanged;
+        return field_t::other;
+    }
+
+    static field_t node_field(const std::string& key) {
+        if (key == "service_node_pubkey")
+            return field_t::service_node_pubkey;
+        if (key == "swarm_id")
+            return field_t::swarm_id;
+        if (key == "storage_port")
+            return field_t::storage_port;
+        if (key == "public_ip")
+            return field_t::public_ip;
+        if (key == "pubkey_x25519")
+            return field_t::pubkey_x25519;
+        if (key == "pubkey_ed25519")
+            return field_t::pubkey_ed25519;
+        if (key == "funded")
+            return field_t::funded;
+        return field_t::other;
+    }
+
+    bool skipping() const { return skip_depth_ != 0; }
+
+    /// Whether a scalar is the value of a field we are after
+    bool is_field() const {
+        return !skipping() && field_ != field_t::other &&
+               field_ != field_t::result &&
+               field_ != field_t::service_node_states;
+    }
+
+    void finish_node() {
+
+        const auto& pubkey = value(field_t::service_node_pubkey);
+        const auto& swarm_id = value(field_t::swarm_id);
+        const auto& port = value(field_t::storage_port);
+        auto& ip = value(field_t::public_ip);
+        auto& pubkey_x25519 = value(field_t::pubkey_x25519);
+        auto& pubkey_ed25519 = value(field_t::pubkey_ed25519);
+        const auto& funded = value(field_t::funded);
+
+        if (!pubkey.is_string() || !swarm_id.is_number() ||
+            !port.is_number() || !ip.is_string() ||
+            !pubkey_x25519.is_string() || !pubkey_ed25519.is_string() ||
+            !funded.is_boolean()) {
+            failed_ = true;
+            return;
+        }
+
+        const auto& pubkey_hex = value(field_t::service_node_pubkey).str();
+
+        try {
+            auto sn = sn_record_t{port.number<uint16_t>(),
+                                  util::hex_to_base32z(pubkey_hex),
+                                  pubkey_hex,
+                                  pubkey_x25519.str(),
+                                  pubkey_ed25519.str(),
+                                  ip.str()};
+
+            /// We want to include (test) decommissioned nodes, but not
+            /// partially funded ones.
+            if (!funded.boolean()) {
+                return;
+            }
+
+            /// Storing decommissioned nodes (with dummy swarm id) in
+            /// a separate data structure as it seems less error prone
+            const auto sid = swarm_id.number<swarm_id_t>();
+            if (sid == INVALID_SWARM_ID) {
+                decommissioned_.push_back(std::move(sn));
+            } else {
+                swarm_map_[sid].push_back(std::move(sn));
+            }
+        } catch (const std::exception&) {
+            failed_ = true;
+        }
+    }
+
+    /// Whether a value other than an object or array is a field's value,
+    /// and where it is worth checking
+    bool on_scalar(bool is_null) {
+        if (skipping()) {
+            return false;
+        }
+        if (in_states_ && !in_node_ && depth_ == 3) {
+            // Not a node
+            failed_ = true;
+        } else if (field_ == field_t::service_node_states && depth_ == 2 &&
+                   in_result_) {
+            // No nodes in a null, a single invalid one in anything else
+            seen_states_ = true;
+            failed_ = failed_ || !is_null;
+        }
+        return is_field() && !failed_;
+    }
+
+    bool set_field(void (sax_value_t::*setter)()) {
+        if (on_scalar(true)) {
+            (value(field_).*setter)();
+        }
+        return true;
+    }
+
+    template <typename T>
+    bool set_field(void (sax_value_t::*setter)(T), T val) {
+        if (on_scalar(false)) {
+            (value(field_).*setter)(val);
+        }
+        return true;
+    }
+
+    bool start_container(bool is_object) {
+        depth_++;
+        if (skipping())
+            return true;
+
+        if (depth_ == 1) {
+            return true;
+        }
+
+        if (field_ == field_t::result && depth_ == 2 && is_object &&
+            !in_result_) {
+            in_result_ = true;
+        } else if (field_ == field_t::service_node_states && depth_ == 3 &&
+                   !in_states_) {
+            // Normally an array, but the values of an object are nodes too
+            seen_states_ = true;
+            in_states_ = true;
+        } else if (in_states_ && depth_ == 4 && !in_node_) {
+            if (!is_object) {
+                // Not a node
+                failed_ = true;
+                skip_depth_ = depth_;
+                field_ = field_t::other;
+                return true;
+            }
+            in_node_ = true;
+            for (size_t i = static_cast<size_t>(field_t::service_node_pubkey);
+                 i < NUM_FIELDS; ++i) {
+                values_[i].reset();
+            }
+        } else {
+            // An object or array as a field's value
+            if (is_field() && !failed_) {
+                value(field_).set_other();
+            }
+            skip_depth_ = depth_;
+        }
+        field_ = field_t::other;
+        return true;
+    }
+
+    bool end_container() {
+        if (skip_depth_ == depth_) {
+            skip_depth_ = 0;
+        } else if (!skipping()) {
+            if (in_node_ && depth_ == 4) {
+                in_node_ = false;
+                if (!failed_) {
+                    finish_node();
+                }
+            } else if (in_states_ && depth_ == 3) {
+                in_states_ = false;
+            } else if (in_result_ && depth_ == 2) {
+                in_result_ = false;
+            }
+        }
+        depth_--;
+        field_ = field_t::other;
+        return true;
+    }
+
+  public:
+    bool null() override { return set_field(&sax_value_t::set_other); }
+
+    bool boolean(bool val) override {
+        return set_field(&sax_value_t::set_boolean, val);
+    }
+
+    bool number_integer(number_integer_t val) override {
+        return set_field(&sax_value_t::set_integer, int64_t{val});
+    }
+
+    bool number_unsigned(number_unsigned_t val) override {
+        return set_field(&sax_value_t::set_unsigned, uint64_t{val});
+    }
+
+    bool number_float(number_float_t val, const string_t&) override {
+        return set_field(&sax_value_t::set_real, double{val});
+    }
+
+    bool string(string_t& val) override {
+        if (on_scalar(false)) {
+            value(field_).set_string(val);
+        }
+        return true;
+    }
+
+    bool start_object(std::size_t) override { return start_container(true); }
+
+    bool end_object() override { return end_container(); }
+
+    bool start_array(std::size_t) override { return start_container(false); }
+
+    bool end_array() override { return end_container(); }
+
+    bool key(string_t& val) override {
+        if (skipping()) {
+            return true;
+        }
+        if (depth_ == 1) {
+            field_ = val == "result" ? field_t::result : field_t::other;
+        } else if (in_node_ && depth_ == 4) {
+            field_ = node_field(val);
+        } else if (in_result_ && depth_ == 2) {
+            field_ = result_field(val);
+        } else {
+            field_ = field_t::other;
+        }
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string&,
+                     const nlohmann::detail::exception&) override {
+        return false;
+    }
+
+    block_update_t result() {
+
+        block_update_t bu;
+
+        const auto& unchanged = value(field_t::unchanged);
+        bu.unchanged = unchanged.is_boolean() && unchanged.boolean();
+
+        if (!seen_states_) {
+            return bu;
+        }
+
+        bu.swarms.reserve(swarm_map_.size());
+        for (auto& swarm : swarm_map_) {
+            bu.swarms.emplace_back(
+                SwarmInfo{swarm.first, std::move(swarm.second)});
+        }
+        bu.decommissioned_nodes = std::move(decommissioned_);
+
+        if (failed_) {
+            return bu;
+        }
+
+        const auto& height = value(field_t::height);
+        auto& block_hash = value(field_t::block_hash);
+        const auto& hardfork = value(field_t::hardfork);
+
+        if (!height.is_number())
+            return bu;
+        bu.height = height.number<uint64_t>();
+
+        if (!block_hash.is_string())
+            return bu;
+        bu.block_hash = std::move(block_hash.str());
+
+        if (!hardfork.is_number())
+            return bu;
+        bu.hardfork = hardfork.number<int>();
+
+        return bu;
+    }
+};
+
+} // namespace
+
+block_update_t
+parse_swarm_update(const std::shared_ptr<std::string>& response_body) {
+
+    if (!response_body) {
+        SISPOP_LOG(critical, "Bad sispopd rpc response: no response body");
+        throw std::runtime_error("Failed to parse swarm update");
+    }
+
+    swarm_update_sax_t sax;
+    if (!nlohmann::json::sax_parse(*response_body, &sax)) {
+        return {};
+    }
+
+    return sax.result();
+}
+
+std::string_view peek_block_hash(std::string_view response_body) {
+
+    // The hash comes after the nodes in sispopd's response
+    constexpr std::string_view key = "\"block_hash\"";
+    const size_t key_pos = response_body.rfind(key);
+    if (key_pos == std::string_view::npos)
+        return {};
+
+    size_t pos = key_pos + key.size();
+    const auto skip_space = [&] {
+        while (pos < response_body.size() &&
+               std::isspace(static_cast<unsigned char>(response_body[pos])))
+            pos++;
+    };
+
+    skip_space();
+    if (pos == response_body.size() || response_body[pos] != ':')
+        return {};
+    pos++;
+    skip_space();
+    if (pos == response_body.size() || response_body[pos] != '"')
+        return {};
+    pos++;
+
+    const size_t end = response_body.find('"', pos);
+    if (end == std::string_view::npos)
+        return {};
+
+    return response_body.substr(pos, end - pos);
+}
+
 Swarm::~Swarm() = default;
 
 bool Swarm::is_existing_swarm(swarm_id_t sid) const {
 
-    return std::any_of(all_valid_swarms_.begin(), all_valid_swarms_.end(),
-                       [sid](const SwarmInfo& cur_swarm_info) {
-                           return cur_swarm_info.swarm_id == sid;
-                       });
+    // Sorted by id in apply_swarm_changes
+    const auto it = std::lower_bound(
+        all_valid_swarms_.begin(), all_valid_swarms_.end(), sid,
+        [](const SwarmInfo& si, swarm_id_t id) { return si.swarm_id < id; });
+
+    return it != all_valid_swarms_.end() && it->swarm_id == sid;
 }
 
 SwarmEvents Swarm::derive_swarm_events(const all_swarms_t& swarms) const {
@@ -134,33 +575,40 @@ void Swarm::set_swarm_id(swarm_id_t sid) {
     cur_swarm_id_ = sid;
 }
 
-static std::unordered_map<std::string, sn_record_t>
-get_snode_map_from_swarms(const all_swarms_t& swarms) {
+/// IPs by sn address (pointing into the records of `swarms`)
+static std::unordered_map<std::string_view, uint32_t>
+get_snode_ips_from_swarms(const all_swarms_t& swarms) {
 
-    std::unordered_map<std::string, sn_record_t> snode_map;
+    size_t count = 0;
+    for (const auto& swarm : swarms) {
+        count += swarm.snodes.size();
+    }
+
+    std::unordered_map<std::string_view, uint32_t> snode_ips;
+    snode_ips.reserve(count);
     for (const auto& swarm : swarms) {
         for (const auto& snode : swarm.snodes) {
-            snode_map.insert({snode.sn_address(), snode});
+            snode_ips.emplace(snode.sn_address(), snode.ip_v4());
         }
     }
-    return snode_map;
+    return snode_ips;
 }
 
 static all_swarms_t apply_ips(const all_swarms_t& swarms_to_keep,
                               const all_swarms_t& other_swarms) {
 
     all_swarms_t result_swarms = swarms_to_keep;
-    const auto other_snode_map = get_snode_map_from_swarms(other_swarms);
+    const auto other_snode_ips = get_snode_ips_from_swarms(other_swarms);
     for (auto& swarm : result_swarms) {
         for (auto& snode : swarm.snodes) {
+            // Keep swarms_to_keep but don't overwrite with default IPs
+            if (snode.ip_v4() != 0) {
+                continue;
+            }
             const auto other_snode_it =
-                other_snode_map.find(snode.sn_address());
-            if (other_snode_it != other_snode_map.end()) {
-                const auto& other_snode = other_snode_it->second;
-                // Keep swarms_to_keep but don't overwrite with default IPs
-                if (snode.ip() == "0.0.0.0") {
-                    snode.set_ip(other_snode.ip());
-                }
+                other_snode_ips.find(snode.sn_address());
+            if (other_snode_it != other_snode_ips.end()) {
+                snode.set_ip(other_snode_it->second);
             }
         }
     }
@@ -170,6 +618,21 @@ static all_swarms_t apply_ips(const all_swarms_t& swarms_to_keep,
 void Swarm::apply_swarm_changes(const all_swarms_t& new_swarms) {
 
     all_valid_swarms_ = apply_ips(new_swarms, all_valid_swarms_);
+    swarm_epoch_++;
+
+    std::sort(all_valid_swarms_.begin(), all_valid_swarms_.end(),
+              [](const SwarmInfo& lhs, const SwarmInfo& rhs) {
+                  return lhs.swarm_id < rhs.swarm_id;
+              });
+
+    // The sentinel id (if any) sorts last and is left out
+    swarm_ring_.clear();
+    swarm_ring_.reserve(all_valid_swarms_.size());
+    for (const auto& si : all_valid_swarms_) {
+        if (si.swarm_id != INVALID_SWARM_ID) {
+            swarm_ring_.push_back(si.swarm_id);
+        }
+    }
 }
 
 void Swarm::update_state(const all_swarms_t& swarms,
@@ -204,17 +667,39 @@ void Swarm::update_state(const all_swarms_t& swarms,
         [this](const sn_record_t& record) { return record != our_address_; });
 
     // Store a copy of every node in a separate data structure
-    all_funded_nodes_.clear();
+    std::vector<sn_record_t> all_funded_nodes;
+    size_t num_nodes = decommissioned.size();
+    for (const auto& si : swarms) {
+        num_nodes += si.snodes.size();
+    }
+    all_funded_nodes.reserve(num_nodes);
 
     for (const auto& si : swarms) {
         for (const auto& sn : si.snodes) {
-            all_funded_nodes_.push_back(sn);
+            all_funded_nodes.push_back(sn);
         }
     }
 
     for (const auto& sn : decommissioned) {
-        all_funded_nodes_.push_back(sn);
+        all_funded_nodes.push_back(sn);
+    }
+
+    // Index the new nodes before replacing the old ones (the keys point into
+    // the records' shared keys). On duplicates the first node wins, as it
+    // would in a linear search
+    std::unordered_map<std::string_view, size_t> by_pk, by_ed25519_pk;
+    by_pk.reserve(all_funded_nodes.size());
+    by_ed25519_pk.reserve(all_funded_nodes.size());
+
+    for (size_t i = 0; i < all_funded_nodes.size(); ++i) {
+        const auto& sn = all_funded_nodes[i];
+        by_pk.emplace(sn.pub_key_base32z(), i);
+        by_ed25519_pk.emplace(sn.pubkey_ed25519_hex(), i);
     }
+
+    all_funded_nodes_.swap(all_funded_nodes);
+    funded_by_pk_.swap(by_pk);
+    funded_by_ed25519_pk_.swap(by_ed25519_pk);
 }
 
 boost::optional<sn_record_t> Swarm::choose_funded_node() const {
@@ -243,25 +728,23 @@ boost::optional<sn_record_t> Swarm::find_node_by_port(uint16_t port) const {
 boost::optional<sn_record_t>
 Swarm::find_node_by_ed25519_pk(const std::string& pk) const {
 
-    for (const auto& sn : all_funded_nodes_) {
-        if (sn.pubkey_ed25519_hex() == pk) {
-            return sn;
-        }
+    const auto it = funded_by_ed25519_pk_.find(pk);
+    if (it == funded_by_ed25519_pk_.end()) {
+        return boost::none;
     }
 
-    return boost::none;
+    return all_funded_nodes_[it->second];
 }
 
 boost::optional<sn_record_t>
 Swarm::get_node_by_pk(const sn_pub_key_t& pk) const {
 
-    for (const auto& sn : all_funded_nodes_) {
-        if (sn.pub_key_base32z() == pk) {
-            return sn;
-        }
+    const auto it = funded_by_pk_.find(pk);
+    if (it == funded_by_pk_.end()) {
+        return boost::none;
     }
 
-    return boost::none;
+    return all_funded_nodes_[it->second];
 }
 
 static uint64_t hex_to_u64(const user_pubkey_t& pk) {
@@ -287,15 +770,89 @@ static uint64_t hex_to_u64(const user_pubkey_t& pk) {
 bool Swarm::is_pubkey_for_us(const user_pubkey_t& pk) const {
 
     /// TODO: Make sure no exceptions bubble up from here!
-    return cur_swarm_id_ == get_swarm_by_pk(all_valid_swarms_, pk);
+    const SwarmInfo* swarm = get_swarm_by_pk(pk);
+    // Without any swarms, a pubkey has none, just like we don't
+    const swarm_id_t swarm_id = swarm ? swarm->swarm_id : INVALID_SWARM_ID;
+    return cur_swarm_id_ == swarm_id;
+}
+
+/// Index of the closest id to `res` in `ring` (sorted, not empty), going
+/// around the ends the same way as get_swarm_by_pk below
+static size_t closest_on_ring(const std::vector<swarm_id_t>& ring,
+                              uint64_t res) {
+
+    constexpr swarm_id_t MAX_ID = INVALID_SWARM_ID - 1;
+
+    const size_t last = ring.size() - 1;
+    const auto it = std::lower_bound(ring.begin(), ring.end(), res);
+
+    if (it == ring.end()) {
+        // res is past the rightmost swarm
+        const uint64_t dist = res - ring[last];
+        const uint64_t wrap_dist = (MAX_ID - res) + ring[0];
+        return wrap_dist < dist ? 0 : last;
+    }
+
+    const size_t idx = it - ring.begin();
+
+    if (*it == res) {
+        return idx;
+    }
+
+    if (idx == 0) {
+        // res is before the leftmost swarm
+        const uint64_t dist = ring[0] - res;
+        const uint64_t wrap_dist = res + (MAX_ID - ring[last]);
+        return wrap_dist < dist ? last : 0;
+    }
+
+    // On a tie the lower id wins, as it comes first in a linear scan
+    return (ring[idx] - res < res - ring[idx - 1]) ? idx : idx - 1;
+}
+
+const SwarmInfo* Swarm::get_swarm_by_pk(const user_pubkey_t& pk) const {
+
+    if (swarm_ring_.empty()) {
+        return nullptr;
+    }
+
+    const std::lock_guard<std::mutex> lock(swarm_cache_mutex_);
+
+    const auto it = swarm_cache_.find(pk.str());
+    if (it != swarm_cache_.end() && it->second.epoch == swarm_epoch_) {
+        swarm_cache_hits_++;
+        return &all_valid_swarms_[it->second.idx];
+    }
+
+    swarm_cache_misses_++;
+
+    const size_t idx = closest_on_ring(swarm_ring_, hex_to_u64(pk));
+
+    if (it != swarm_cache_.end()) {
+        it->second = {swarm_epoch_, idx};
+    } else {
+        if (swarm_cache_.size() >= SWARM_CACHE_SIZE) {
+            swarm_cache_.clear();
+        }
+        swarm_cache_.emplace(pk.str(), cached_swarm_t{swarm_epoch_, idx});
+    }
+
+    return &all_valid_swarms_[idx];
 }
 
 bool Swarm::is_fully_funded_node(const std::string& sn_address) const {
 
-    return std::any_of(all_funded_nodes_.begin(), all_funded_nodes_.end(),
-                       [&sn_address](const sn_record_t& sn) {
-                           return sn.sn_address() == sn_address;
-                       });
+    // Addresses are base32z public keys followed by ".snode"
+    constexpr std::string_view suffix = ".snode";
+    const std::string_view address = sn_address;
+
+    if (address.size() <= suffix.size() ||
+        address.substr(address.size() - suffix.size()) != suffix) {
+        return false;
+    }
+
+    return funded_by_pk_.count(
+               address.substr(0, address.size() - suffix.size())) > 0;
 }
 
 swarm_id_t get_swarm_by_pk(const std::vector<SwarmInfo>& all_swarms,
@@ -1,7 +1,11 @@
 #pragma once
 
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 #include "sispop_common.h"
@@ -26,14 +30,26 @@ using all_swarms_t = std::vector<SwarmInfo>;
 struct block_update_t {
     all_swarms_t swarms;
     std::vector<sn_record_t> decommissioned_nodes;
-    uint64_t height;
+    uint64_t height = 0;
     std::string block_hash;
-    int hardfork;
+    int hardfork = 0;
+    /// Sispopd left the nodes out as the block is the one we polled with
+    bool unchanged = false;
 };
 
 
 void debug_print(std::ostream& os, const block_update_t& bu);
 
+/// Parse sispopd's response to get_n_service_nodes (as it is read, without
+/// building a DOM of it)
+block_update_t
+parse_swarm_update(const std::shared_ptr<std::string>& response_body);
+
+/// The block hash in the same response, found without parsing the rest of
+/// it (which can be skipped when the block hasn't changed); empty if there
+/// isn't one
+std::string_view peek_block_hash(std::string_view response_body);
+
 swarm_id_t get_swarm_by_pk(const std::vector<SwarmInfo>& all_swarms,
                            const user_pubkey_t& pk);
 
@@ -55,12 +71,37 @@ struct SwarmEvents {
 class Swarm {
 
     swarm_id_t cur_swarm_id_ = INVALID_SWARM_ID;
-    /// Note: this excludes the "dummy" swarm
+    /// Note: this excludes the "dummy" swarm; sorted by swarm id
     std::vector<SwarmInfo> all_valid_swarms_;
+    /// Ids of `all_valid_swarms_` (at the same indices) to binary search
+    /// pubkeys in, rebuilt with it
+    std::vector<swarm_id_t> swarm_ring_;
+    /// Incremented whenever `all_valid_swarms_` changes, which invalidates
+    /// the swarms cached for pubkeys
+    uint64_t swarm_epoch_ = 0;
+
+    struct cached_swarm_t {
+        uint64_t epoch;
+        /// Index into `all_valid_swarms_`
+        size_t idx;
+    };
+
+    /// Swarms of recently seen pubkeys (cleared when it gets too large).
+    /// Lookups might come from several threads at once (see
+    /// ServiceNode), so the cache has a lock of its own
+    mutable std::mutex swarm_cache_mutex_;
+    mutable std::unordered_map<std::string, cached_swarm_t> swarm_cache_;
+    mutable uint64_t swarm_cache_hits_ = 0;
+    mutable uint64_t swarm_cache_misses_ = 0;
     sn_record_t our_address_;
     std::vector<sn_record_t> swarm_peers_;
     /// This includes decommissioned nodes
     std::vector<sn_record_t> all_funded_nodes_;
+    /// Indices into `all_funded_nodes_` by base32z and by ed25519 (hex)
+    /// public key. The keys point into the records' keys, so they are
+    /// replaced together with it
+    std::unordered_map<std::string_view, size_t> funded_by_pk_;
+    std::unordered_map<std::string_view, size_t> funded_by_ed25519_pk_;
 
     /// Check if `sid` is an existing (active) swarm
     bool is_existing_swarm(swarm_id_t sid) const;
@@ -82,6 +123,20 @@ class Swarm {
 
     bool is_pubkey_for_us(const user_pubkey_t& pk) const;
 
+    /// The swarm responsible for `pk` (same as `get_swarm_by_pk` above, in
+    /// O(log n), or a single hash lookup for pubkeys seen since the swarms
+    /// last changed), nullptr if there are no swarms
+    const SwarmInfo* get_swarm_by_pk(const user_pubkey_t& pk) const;
+
+    uint64_t swarm_cache_hits() const {
+        const std::lock_guard<std::mutex> lock(swarm_cache_mutex_);
+        return swarm_cache_hits_;
+    }
+    uint64_t swarm_cache_misses() const {
+        const std::lock_guard<std::mutex> lock(swarm_cache_mutex_);
+        return swarm_cache_misses_;
+    }
+
     /// Whether `sn_address` is found in any of the swarms, including the
     /// dummy swarm with decommissioned nodes
     bool is_fully_funded_node(const std::string& sn_address) const;
@@ -0,0 +1,175 @@
+#include "timer_wheel.h"
+
+#include <algorithm>
+
+namespace sispop {
+
+constexpr std::chrono::milliseconds TimerWheel::TICK;
+
+boost::asio::io_context::id TimerWheel::id;
+
+TimerWheel& TimerWheel::get(boost::asio::io_context& ioc) {
+    return boost::asio::use_service<TimerWheel>(ioc);
+}
+
+TimerWheel::TimerWheel(boost::asio::io_context& ioc)
+    : boost::asio::io_context::service(ioc), ticker_(ioc) {}
+
+uint64_t TimerWheel::tick_of(clock::time_point t) const {
+    if (t <= epoch_) {
+        return 0;
+    }
+    return (t - epoch_ + TICK - clock::duration{1}) / TICK;
+}
+
+uint64_t TimerWheel::last_tick(clock::time_point t) const {
+    if (t <= epoch_) {
+        return 0;
+    }
+    return (t - epoch_) / TICK;
+}
+
+void TimerWheel::timer_t::expires_at(clock::time_point time,
+                                     std::function<void()> callback) {
+    cancel();
+    expiry_ = wheel_.tick_of(time);
+    callback_ = std::move(callback);
+    wheel_.add(*this);
+}
+
+bool TimerWheel::timer_t::cancel() {
+    // Note: the wheel might be gone by now if we aren't pending
+    if (!link_.is_linked()) {
+        return false;
+    }
+    link_.unlink();
+    wheel_.size_--;
+    // The callback might hold the last reference to our owner
+    std::function<void()> callback;
+    callback.swap(callback_);
+    return true;
+}
+
+void TimerWheel::add(timer_t& timer) {
+    if (size_ == 0) {
+        // The ticks since the last timer went off don't need running
+        next_tick_ = std::max(next_tick_, last_tick(clock::now()) + 1);
+    }
+    place(timer);
+    size_++;
+    if (!ticking_) {
+        schedule_tick();
+    }
+}
+
+void TimerWheel::place(timer_t& timer) {
+    // Overdue timers go off with the next tick
+    timer.expiry_ = std::max(timer.expiry_, next_tick_);
+    if (timer.expiry_ - next_tick_ >= MAX_TICKS) {
+        timer.expiry_ = next_tick_ + MAX_TICKS - 1;
+    }
+    const uint64_t delta = timer.expiry_ - next_tick_;
+
+    if (delta < ROOT_SIZE) {
+        root_[timer.expiry_ & (ROOT_SIZE - 1)].push_back(timer);
+        return;
+    }
+
+    int level = 0;
+    while (delta >= uint64_t{1} << (ROOT_BITS + (level + 1) * LEVEL_BITS)) {
+        level++;
+    }
+    const uint64_t slot =
+        (timer.expiry_ >> (ROOT_BITS + level * LEVEL_BITS)) & (LEVEL_SIZE - 1);
+    levels_[level][slot].push_back(timer);
+}
+
+uint64_t TimerWheel::cascade(int level) {
+    const uint64_t slot =
+        (next_tick_ >> (ROOT_BITS + level * LEVEL_BITS)) & (LEVEL_SIZE - 1);
+    list_t timers;
+    timers.swap(levels_[level][slot]);
+    while (!timers.empty()) {
+        timer_t& timer = timers.front();
+        timers.pop_front();
+        place(timer);
+    }
+    return slot;
+}
+
+void TimerWheel::run_until(clock::time_point now) {
+
+    const uint64_t last = last_tick(now);
+
+    while (next_tick_ <= last) {
+
+        if (size_ == 0) {
+            next_tick_ = last + 1;
+            break;
+        }
+
+        if ((next_tick_ & (ROOT_SIZE - 1)) == 0) {
+            // Moving to the next slot of a level also moves to the next one
+            // of the level above when the slot wraps around
+            for (int level = 0; level < LEVELS && cascade(level) == 0;
+                 level++) {
+            }
+        }
+
+        list_t due;
+        due.swap(root_[next_tick_ & (ROOT_SIZE - 1)]);
+        next_tick_++;
+
+        // Callbacks can arm and cancel timers (including the ones in `due`)
+        // and destroy them
+        while (!due.empty()) {
+            timer_t& timer = due.front();
+            due.pop_front();
+            size_--;
+            std::function<void()> callback;
+            callback.swap(timer.callback_);
+            callback();
+        }
+    }
+}
+
+void TimerWheel::schedule_tick() {
+    ticking_ = true;
+    ticker_.expires_at(epoch_ + next_tick_ * TICK);
+    ticker_.async_wait([this](const boost::system::error_code& ec) {
+        ticking_ = false;
+        if (ec == boost::asio::error::operation_aborted) {
+            return;
+        }
+        run_until(clock::now());
+        if (size_ > 0 && !ticking_) {
+            schedule_tick();
+        }
+    });
+}
+
+void TimerWheel::shutdown() {
+    ticker_.cancel();
+
+    // Dropping a callback can destroy other timers, so no iterating
+    const auto drop_all = [this](list_t& timers) {
+        while (!timers.empty()) {
+            timer_t& timer = timers.front();
+            timers.pop_front();
+            size_--;
+            std::function<void()> callback;
+            callback.swap(timer.callback_);
+        }
+    };
+
+    for (auto& timers : root_) {
+        drop_all(timers);
+    }
+    for (auto& level : levels_) {
+        for (auto& timers : level) {
+            drop_all(timers);
+        }
+    }
+}
+
+} // namespace sispop
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/intrusive/list.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+namespace sispop {
+
+/// Coarse timeouts (connection deadlines, long polls) shared by everything
+/// on an io_context: one hierarchical timing wheel per io_context (see
+/// `get`), ticking every `TICK` while any of its timers is pending, instead
+/// of an entry in asio's timer heap for each of them.
+///
+/// Arming and cancelling a timer are O(1); callbacks run on the io_context
+/// up to `TICK` after their timeout. Not thread safe: timers must only be
+/// used by the thread running the io_context, which is how connections are
+/// handled.
+class TimerWheel : public boost::asio::io_context::service {
+
+    using hook_t = boost::intrusive::list_member_hook<
+        boost::intrusive::link_mode<boost::intrusive::auto_unlink>>;
+
+  public:
+    using clock = std::chrono::steady_clock;
+
+    static constexpr std::chrono::milliseconds TICK{100};
+
+    static boost::asio::io_context::id id;
+
+    /// A callback to run once, after a timeout; owned by whoever needs it,
+    /// and cancelled when destroyed
+    class timer_t {
+
+        friend class TimerWheel;
+
+        hook_t link_;
+        TimerWheel& wheel_;
+        std::function<void()> callback_;
+        uint64_t expiry_ = 0;
+
+      public:
+        explicit timer_t(boost::asio::io_context& ioc)
+            : wheel_(TimerWheel::get(ioc)) {}
+
+        explicit timer_t(TimerWheel& wheel) : wheel_(wheel) {}
+
+        timer_t(const timer_t&) = delete;
+        timer_t& operator=(const timer_t&) = delete;
+
+        ~timer_t() { cancel(); }
+
+        /// Call `callback` after `timeout` (rounded up to a tick), instead
+        /// of any pending one
+        void expires_after(clock::duration timeout,
+                           std::function<void()> callback) {
+            expires_at(clock::now() + timeout, std::move(callback));
+        }
+
+        void expires_at(clock::time_point time,
+                        std::function<void()> callback);
+
+        /// Drop the pending callback; false if there wasn't one (e.g.
+        /// because it has run already)
+        bool cancel();
+
+        bool pending() const { return link_.is_linked(); }
+    };
+
+    /// The wheel of `ioc` (created on first use)
+    static TimerWheel& get(boost::asio::io_context& ioc);
+
+    explicit TimerWheel(boost::asio::io_context& ioc);
+
+    /// Run the callbacks of the timers due by `now` (done by the wheel
+    /// itself as time passes; public for tests)
+    void run_until(clock::time_point now);
+
+    /// Number of pending timers
+    size_t size() const { return size_; }
+
+  private:
+    /// The first level has a slot per tick, the others a slot per
+    /// (1 << LEVEL_BITS) slots of the one below
+    static constexpr int ROOT_BITS = 8;
+    static constexpr int LEVEL_BITS = 6;
+    static constexpr int LEVELS = 3;
+    static constexpr uint64_t ROOT_SIZE = uint64_t{1} << ROOT_BITS;
+    static constexpr uint64_t LEVEL_SIZE = uint64_t{1} << LEVEL_BITS;
+    /// Timers further away than this (about 77 days) fire early
+    static constexpr uint64_t MAX_TICKS = uint64_t{1}
+                                          << (ROOT_BITS + LEVELS * LEVEL_BITS);
+
+    using list_t = boost::intrusive::list<
+        timer_t,
+        boost::intrusive::member_hook<timer_t, hook_t, &timer_t::link_>,
+        boost::intrusive::constant_time_size<false>>;
+
+    const clock::time_point epoch_ = clock::now();
+    /// The next tick to run the timers of
+    uint64_t next_tick_ = 0;
+    size_t size_ = 0;
+
+    std::array<list_t, ROOT_SIZE> root_;
+    std::array<std::array<list_t, LEVEL_SIZE>, LEVELS> levels_;
+
+    boost::asio::steady_timer ticker_;
+    bool ticking_ = false;
+
+    /// The first tick at or after `t`
+    uint64_t tick_of(clock::time_point t) const;
+
+    /// The last tick at or before `t`
+    uint64_t last_tick(clock::time_point t) const;
+
+    void add(timer_t& timer);
+
+    /// Put `timer` in the slot for its expiry
+    void place(timer_t& timer);
+
+    /// Move the timers of the slot of `level` that `next_tick_` falls in
+    /// one level down; returns the slot
+    uint64_t cascade(int level);
+
+    void schedule_tick();
+
+    void shutdown() override;
+};
+
+} // namespace sispop
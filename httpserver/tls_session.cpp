@@ -0,0 +1,155 @@
+#include "tls_session.h"
+
+#include "sispop_logger.h"
+
+#include <openssl/rand.h>
+
+#include <cstring>
+
+namespace sispop {
+
+constexpr unsigned char SESSION_ID_CONTEXT[] = "sispop-storage";
+
+static int ticket_keys_index() {
+    static const int index =
+        SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+    return index;
+}
+
+static int ticket_key_cb(SSL* ssl, unsigned char* key_name, unsigned char* iv,
+                         EVP_CIPHER_CTX* cipher_ctx, HMAC_CTX* hmac_ctx,
+                         int enc) {
+
+    auto keys = static_cast<SessionTicketKeys*>(
+        SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), ticket_keys_index()));
+
+    if (!keys) {
+        return -1;
+    }
+
+    return keys->on_ticket(key_name, iv, cipher_ctx, hmac_ctx, enc);
+}
+
+SessionTicketKeys::SessionTicketKeys(boost::asio::io_context& ioc,
+                                     std::chrono::seconds rotation_period)
+    : current_(generate_key()), rotation_timer_(ioc),
+      rotation_period_(rotation_period) {
+    schedule_rotation();
+}
+
+SessionTicketKeys::key_t SessionTicketKeys::generate_key() {
+
+    key_t key;
+    if (RAND_bytes(key.name.data(), key.name.size()) != 1 ||
+        RAND_bytes(key.aes_key.data(), key.aes_key.size()) != 1 ||
+        RAND_bytes(key.hmac_key.data(), key.hmac_key.size()) != 1) {
+        throw std::runtime_error("Could not generate session ticket key");
+    }
+    return key;
+}
+
+void SessionTicketKeys::rotate() {
+
+    const key_t key = generate_key();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    previous_ = current_;
+    has_previous_ = true;
+    current_ = key;
+
+    SISPOP_LOG(debug, "Rotated session ticket key");
+}
+
+void SessionTicketKeys::schedule_rotation() {
+
+    rotation_timer_.expires_after(rotation_period_);
+    rotation_timer_.async_wait([this](const boost::system::error_code& ec) {
+        if (ec) {
+            return;
+        }
+        rotate();
+        schedule_rotation();
+    });
+}
+
+int SessionTicketKeys::on_ticket(unsigned char* key_name, unsigned char* iv,
+                                 EVP_CIPHER_CTX* cipher_ctx,
+                                 HMAC_CTX* hmac_ctx, int enc) {
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (enc) {
+        // Issuing a new ticket
+        if (RAND_bytes(iv, EVP_MAX_IV_LENGTH) != 1) {
+            return -1;
+        }
+        std::memcpy(key_name, current_.name.data(), current_.name.size());
+        if (EVP_EncryptInit_ex(cipher_ctx, EVP_aes_256_cbc(), nullptr,
+                               current_.aes_key.data(), iv) != 1 ||
+            HMAC_Init_ex(hmac_ctx, current_.hmac_key.data(),
+                         current_.hmac_key.size(), EVP_sha256(),
+                         nullptr) != 1) {
+            return -1;
+        }
+        return 1;
+    }
+
+    const key_t* key = nullptr;
+    if (std::memcmp(key_name, current_.name.data(), current_.name.size()) ==
+        0) {
+        key = &current_;
+    } else if (has_previous_ &&
+               std::memcmp(key_name, previous_.name.data(),
+                           previous_.name.size()) == 0) {
+        key = &previous_;
+    }
+
+    if (!key) {
+        // Unknown or expired key: fall back to a full handshake
+        return 0;
+    }
+
+    if (HMAC_Init_ex(hmac_ctx, key->hmac_key.data(), key->hmac_key.size(),
+                     EVP_sha256(), nullptr) != 1 ||
+        EVP_DecryptInit_ex(cipher_ctx, EVP_aes_256_cbc(), nullptr,
+                           key->aes_key.data(), iv) != 1) {
+        return -1;
+    }
+
+    // Have the client replace tickets issued with the previous key
+    return key == &current_ ? 1 : 2;
+}
+
+std::unique_ptr<SessionTicketKeys>
+enable_session_resumption(boost::asio::ssl::context& ctx,
+                          boost::asio::io_context& ioc,
+                          const tls_session_options_t& options) {
+
+    SSL_CTX* ssl_ctx = ctx.native_handle();
+
+    SSL_CTX_set_session_id_context(ssl_ctx, SESSION_ID_CONTEXT,
+                                   sizeof(SESSION_ID_CONTEXT) - 1);
+    SSL_CTX_set_timeout(ssl_ctx, options.timeout);
+
+    if (options.cache_size > 0) {
+        SSL_CTX_set_session_cache_mode(ssl_ctx, SSL_SESS_CACHE_SERVER);
+        SSL_CTX_sess_set_cache_size(ssl_ctx, options.cache_size);
+    } else {
+        SSL_CTX_set_session_cache_mode(ssl_ctx, SSL_SESS_CACHE_OFF);
+    }
+
+    if (options.ticket_key_rotation == 0) {
+        SSL_CTX_set_options(ssl_ctx, SSL_OP_NO_TICKET);
+        return nullptr;
+    }
+
+    auto keys = std::make_unique<SessionTicketKeys>(
+        ioc, std::chrono::seconds(options.ticket_key_rotation));
+
+    SSL_CTX_set_ex_data(ssl_ctx, ticket_keys_index(), keys.get());
+    SSL_CTX_set_tlsext_ticket_key_cb(ssl_ctx, ticket_key_cb);
+
+    return keys;
+}
+
+} // namespace sispop
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ssl/context.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+
+#include <array>
+#include <chrono>
+#include <memory>
+#include <mutex>
+
+namespace sispop {
+
+/// Tuning for TLS session resumption on the server
+struct tls_session_options_t {
+    // Number of sessions kept for resumption by session id (0 disables it)
+    size_t cache_size = 20000;
+    // How long (in seconds) a session can be resumed for
+    uint32_t timeout = 3600;
+    // How often (in seconds) the session ticket key is replaced; tickets
+    // issued with the previous key are still accepted. 0 disables tickets
+    uint32_t ticket_key_rotation = 3600;
+};
+
+/// Keys used to encrypt session tickets, replaced periodically so that
+/// a leaked key only exposes recent sessions
+class SessionTicketKeys {
+
+    struct key_t {
+        std::array<unsigned char, 16> name;
+        std::array<unsigned char, 32> aes_key;
+        std::array<unsigned char, 32> hmac_key;
+    };
+
+    // Accessed from handshakes on every thread serving connections
+    std::mutex mutex_;
+    key_t current_;
+    key_t previous_;
+    bool has_previous_ = false;
+
+    boost::asio::steady_timer rotation_timer_;
+    const std::chrono::seconds rotation_period_;
+
+    static key_t generate_key();
+
+    void schedule_rotation();
+
+  public:
+    SessionTicketKeys(boost::asio::io_context& ioc,
+                      std::chrono::seconds rotation_period);
+
+    void rotate();
+
+    /// Implements SSL_CTX_set_tlsext_ticket_key_cb
+    int on_ticket(unsigned char* key_name, unsigned char* iv,
+                  EVP_CIPHER_CTX* cipher_ctx, HMAC_CTX* hmac_ctx, int enc);
+};
+
+/// Enable session resumption (session cache and/or tickets, as per
+/// `options`) on a server context. Ticket keys are rotated on `ioc`; the
+/// returned object must outlive any use of `ctx`
+std::unique_ptr<SessionTicketKeys>
+enable_session_resumption(boost::asio::ssl::context& ctx,
+                          boost::asio::io_context& ioc,
+                          const tls_session_options_t& options);
+
+} // namespace sispop
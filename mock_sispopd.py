@@ -1,5 +1,7 @@
 import time
 import json
+import random
+import sys
 from http.server import BaseHTTPRequestHandler, HTTPServer
 
 SWARMS = """0 s5ejmf538y6kk7rxmpx9aei9fze11ox84wuakzmogkenffi7yeqy.snode e3eai9uukrm1khk8w9exji1pu5bo4jmzz4gwyzyoyx6hqssge3jo.snode\n
@@ -10,6 +12,53 @@ SWARMS = """0 s5ejmf538y6kk7rxmpx9aei9fze11ox84wuakzmogkenffi7yeqy.snode e3eai9u
 """
 
 
+def service_node_states(count):
+  """ A network of `count` nodes in swarms of 5, like get_n_service_nodes
+  returns it (5% decommissioned, 2% not fully funded) """
+  rng = random.Random(4)
+  key = lambda: '%064x' % rng.getrandbits(256)
+  swarm_ids = [rng.getrandbits(64) % (2**64 - 2) for _ in range(max(count // 5, 1))]
+  states = []
+  for i in range(count):
+    states.append({
+      'funded': i % 50 != 49,
+      'public_ip': '10.0.%d.%d' % (i // 256 % 256, i % 256),
+      'pubkey_ed25519': key(),
+      'pubkey_x25519': key(),
+      'service_node_pubkey': key(),
+      'storage_port': 1000 + i,
+      'swarm_id': 2**64 - 1 if i % 20 == 19 else swarm_ids[i % len(swarm_ids)],
+    })
+  return states
+
+
+# Number of nodes to report (first argument)
+NUM_NODES = int(sys.argv[1]) if len(sys.argv) > 1 else 2000
+START_TIME = time.time()
+# A new block every 2 minutes
+BLOCK_TIME = 120
+
+N_SERVICE_NODES = service_node_states(NUM_NODES)
+
+
+def get_n_service_nodes(request_id, params):
+  height = 100000 + int((time.time() - START_TIME) // BLOCK_TIME)
+  block_hash = '%064x' % height
+  result = {
+    'height': height,
+    'target_height': height,
+    'block_hash': block_hash,
+    'hardfork': 14,
+    'status': 'OK',
+  }
+  # Like sispopd, leave the nodes out if the caller has seen this block
+  if params.get('poll_block_hash') == block_hash:
+    result['unchanged'] = True
+  else:
+    result['service_node_states'] = N_SERVICE_NODES
+  return json.dumps({'id': request_id, 'jsonrpc': '2.0', 'result': result})
+
+
 class sispopdHandler(BaseHTTPRequestHandler):
   def do_POST(self):
     if self.path != '/json_rpc':
@@ -26,7 +75,11 @@ class sispopdHandler(BaseHTTPRequestHandler):
 
     message = self.rfile.read(int(length))
     j = json.loads(message)
-    if j['method']!= 'get_service_nodes':
+    if j['method'] == 'get_service_nodes':
+      response = SWARMS
+    elif j['method'] == 'get_n_service_nodes':
+      response = get_n_service_nodes(j.get('id', '0'), j.get('params', {}))
+    else:
       self.send_response(405)
       self.end_headers()
       return
@@ -34,7 +87,7 @@ class sispopdHandler(BaseHTTPRequestHandler):
     self.send_response(200)
     self.send_header('Content-Type', 'application/json')
     self.end_headers()
-    self.wfile.write(bytes(SWARMS, "utf8"))
+    self.wfile.write(bytes(response, "utf8"))
 
 def run():
   # Server settings
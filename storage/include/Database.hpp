@@ -20,6 +20,9 @@ namespace sispop {
 class Database {
   public:
     Database(boost::asio::io_context& ioc, const std::string& db_path);
+    /// Another connection to the same database, which leaves deleting
+    /// expired messages to the one above; e.g. for use on another thread
+    explicit Database(const std::string& db_path);
     ~Database();
 
     enum class DuplicateHandling { IGNORE, FAIL };
@@ -61,7 +64,7 @@ class Database {
     sqlite3_stmt* get_by_hash_stmt;
     sqlite3_stmt* delete_expired_stmt;
 
-    boost::asio::steady_timer cleanup_timer_;
+    std::unique_ptr<boost::asio::steady_timer> cleanup_timer_;
 };
 
 } // namespace sispop
\ No newline at end of file
@@ -9,6 +9,9 @@ namespace sispop {
 using namespace storage;
 
 constexpr auto CLEANUP_PERIOD = std::chrono::seconds(10);
+/// How long a connection waits for another one (e.g. on another thread)
+/// to finish writing before giving up with SQLITE_BUSY
+constexpr int BUSY_TIMEOUT_MS = 1000;
 
 Database::~Database() {
     sqlite3_finalize(save_stmt);
@@ -16,18 +19,25 @@ Database::~Database() {
     sqlite3_finalize(get_all_for_pk_stmt);
     sqlite3_finalize(get_all_stmt);
     sqlite3_finalize(get_stmt);
+    sqlite3_finalize(get_row_count_stmt);
+    sqlite3_finalize(get_by_index_stmt);
+    sqlite3_finalize(get_by_hash_stmt);
     sqlite3_finalize(delete_expired_stmt);
+    // Only closes (and cleans up the write-ahead log, if it was the last
+    // connection) once all statements are finalized
     sqlite3_close(db);
     std::cerr << "~Database\n";
 }
 
 Database::Database(boost::asio::io_context& ioc, const std::string& db_path)
-    : cleanup_timer_(ioc) {
+    : cleanup_timer_(std::make_unique<boost::asio::steady_timer>(ioc)) {
     open_and_prepare(db_path);
 
     perform_cleanup();
 }
 
+Database::Database(const std::string& db_path) { open_and_prepare(db_path); }
+
 void Database::perform_cleanup() {
     const auto now_ms = util::get_time_ms();
 
@@ -53,8 +63,8 @@ void Database::perform_cleanup() {
         fprintf(stderr, "sql error: unexpected value from sqlite3_reset");
     }
 
-    cleanup_timer_.expires_after(CLEANUP_PERIOD);
-    cleanup_timer_.async_wait(std::bind(&Database::perform_cleanup, this));
+    cleanup_timer_->expires_after(CLEANUP_PERIOD);
+    cleanup_timer_->async_wait(std::bind(&Database::perform_cleanup, this));
 }
 
 sqlite3_stmt* Database::prepare_statement(const std::string& query) {
@@ -82,7 +92,11 @@ void Database::open_and_prepare(const std::string& db_path) {
         return;
     }
 
+    sqlite3_busy_timeout(db, BUSY_TIMEOUT_MS);
+
+    // Readers (on other connections) don't block the writer, nor each other
     const char* create_table_query =
+        "PRAGMA journal_mode=WAL;"
         "CREATE TABLE IF NOT EXISTS `Data`("
         "    `Hash` VARCHAR(128) NOT NULL,"
         "    `Owner` VARCHAR(256) NOT NULL,"
@@ -321,7 +335,9 @@ bool Database::store(const std::string& hash, const std::string& pubKey,
 
 bool Database::bulk_store(const std::vector<Item>& items) {
     char* errmsg = 0;
-    if (sqlite3_exec(db, "BEGIN TRANSACTION;", NULL, NULL, &errmsg) !=
+    // Take the write lock upfront: a deferred transaction that finds
+    // another connection writing can't wait for it when it upgrades
+    if (sqlite3_exec(db, "BEGIN IMMEDIATE TRANSACTION;", NULL, NULL, &errmsg) !=
         SQLITE_OK) {
         return false;
     }
@@ -0,0 +1,173 @@
+#include "channel_encryption.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <sodium.h>
+
+#include <array>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+const std::vector<uint8_t> private_key{
+    114, 19,  233, 130, 59,  240, 42,  209, 251, 142, 29,
+    59,  200, 89,  234, 154, 202, 12,  29,  44,  180, 111,
+    36,  158, 126, 252, 198, 236, 141, 163, 95,  15};
+
+const std::string pub_key =
+    "86fe0345719904c47d9d3d24d742d110cab95f9386173057bd59f1c2249da174";
+
+const std::string other_pub_key =
+    "0549b42c7600a25ab9800903630a57f157a1a0f771cac31df559eb13fc5cc0c8";
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(channel_encryption)
+
+BOOST_AUTO_TEST_CASE(it_encrypts_and_decrypts) {
+    ChannelEncryption<std::string> channel(private_key);
+
+    const std::string plaintext = "params\":{\"pubKey\":\"0549b42c7600\"}}";
+
+    const auto ciphertext = channel.encrypt(plaintext, pub_key);
+    BOOST_CHECK(ciphertext.find(plaintext) == std::string::npos);
+    BOOST_CHECK_EQUAL(channel.decrypt(ciphertext, pub_key), plaintext);
+
+    // A new IV each time
+    BOOST_CHECK(channel.encrypt(plaintext, pub_key) != ciphertext);
+
+    ChannelEncryption<std::vector<uint8_t>> bytes_channel(private_key);
+    const std::vector<uint8_t> bytes(100, 42);
+    BOOST_CHECK(bytes_channel.decrypt(bytes_channel.encrypt(bytes, pub_key),
+                                      pub_key) == bytes);
+}
+
+BOOST_AUTO_TEST_CASE(it_writes_into_given_buffers) {
+    ChannelEncryption<std::string> channel(private_key);
+
+    std::string ciphertext;
+    std::string decrypted = "leftovers";
+
+    // Several keys and sizes through the same buffers
+    for (size_t size : {1000, 0, 15, 16, 17}) {
+        for (const auto& key : {pub_key, other_pub_key}) {
+            const std::string plaintext(size, 'x');
+            channel.encrypt(plaintext, key, ciphertext);
+            channel.decrypt(ciphertext, key, decrypted);
+            BOOST_CHECK_EQUAL(decrypted, plaintext);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(it_rejects_bad_inputs) {
+    ChannelEncryption<std::string> channel(private_key);
+
+    BOOST_CHECK_THROW(channel.encrypt("hello", "abcd"), std::exception);
+    BOOST_CHECK_THROW(channel.decrypt("short", pub_key), std::exception);
+    BOOST_CHECK_THROW(channel.decrypt(std::string(20, 'x'), pub_key),
+                      std::exception);
+
+    // Still usable afterwards
+    BOOST_CHECK_EQUAL(
+        channel.decrypt(channel.encrypt("hello", pub_key), pub_key), "hello");
+}
+
+BOOST_AUTO_TEST_CASE(it_encrypts_with_aead) {
+    ChannelEncryption<std::string> channel(private_key);
+
+    const std::string plaintext(1000, 'x');
+
+    for (const auto type : {EncryptType::xchacha20, EncryptType::aes_gcm}) {
+        std::string ciphertext;
+        try {
+            channel.encrypt(plaintext, pub_key, ciphertext, type);
+        } catch (const std::exception&) {
+            // AES-GCM needs AES-NI
+            BOOST_CHECK(type == EncryptType::aes_gcm);
+            continue;
+        }
+
+        // nonce + ciphertext + tag
+        BOOST_CHECK_GT(ciphertext.size(), plaintext.size() + 16);
+        BOOST_CHECK_EQUAL(channel.decrypt(ciphertext, pub_key, type),
+                          plaintext);
+
+        // Authenticated: any change is detected
+        ciphertext[ciphertext.size() / 2] ^= 1;
+        BOOST_CHECK_THROW(channel.decrypt(ciphertext, pub_key, type),
+                          std::exception);
+
+        // Nor with another key
+        ciphertext[ciphertext.size() / 2] ^= 1;
+        BOOST_CHECK_THROW(channel.decrypt(ciphertext, other_pub_key, type),
+                          std::exception);
+
+        BOOST_CHECK_EQUAL(
+            channel.decrypt(channel.encrypt("", pub_key, type), pub_key, type),
+            "");
+        BOOST_CHECK_THROW(channel.decrypt("short", pub_key, type),
+                          std::exception);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(it_derives_aead_keys_from_both_public_keys) {
+    ChannelEncryption<std::string> channel(private_key);
+
+    // What a client does to read a response
+    std::array<unsigned char, 32> client_sk, client_pk, server_pk, shared;
+    randombytes_buf(client_sk.data(), client_sk.size());
+    BOOST_REQUIRE_EQUAL(
+        crypto_scalarmult_base(client_pk.data(), client_sk.data()), 0);
+    BOOST_REQUIRE_EQUAL(
+        crypto_scalarmult_base(server_pk.data(), private_key.data()), 0);
+    BOOST_REQUIRE_EQUAL(
+        crypto_scalarmult(shared.data(), client_sk.data(), server_pk.data()),
+        0);
+
+    const std::string mode = "xchacha20";
+    std::array<unsigned char, crypto_aead_xchacha20poly1305_ietf_KEYBYTES> key;
+    crypto_generichash_state state;
+    crypto_generichash_init(&state, nullptr, 0, key.size());
+    crypto_generichash_update(
+        &state, reinterpret_cast<const unsigned char*>(mode.data()),
+        mode.size());
+    crypto_generichash_update(&state, shared.data(), shared.size());
+    crypto_generichash_update(&state, client_pk.data(), client_pk.size());
+    crypto_generichash_update(&state, server_pk.data(), server_pk.size());
+    crypto_generichash_final(&state, key.data(), key.size());
+
+    std::string client_pk_hex;
+    for (const auto byte : client_pk) {
+        char hex[3];
+        std::snprintf(hex, sizeof(hex), "%02x", byte);
+        client_pk_hex += hex;
+    }
+
+    const std::string plaintext = "a response for the client";
+    const auto ciphertext =
+        channel.encrypt(plaintext, client_pk_hex, EncryptType::xchacha20);
+
+    constexpr size_t nonce_size = crypto_aead_xchacha20poly1305_ietf_NPUBBYTES;
+    BOOST_REQUIRE_GT(ciphertext.size(), nonce_size);
+    const auto in = reinterpret_cast<const unsigned char*>(ciphertext.data());
+    std::string decrypted(ciphertext.size(), '\0');
+    unsigned long long len = 0;
+    BOOST_REQUIRE_EQUAL(
+        crypto_aead_xchacha20poly1305_ietf_decrypt(
+            reinterpret_cast<unsigned char*>(&decrypted[0]), &len, nullptr,
+            in + nonce_size, ciphertext.size() - nonce_size, nullptr, 0, in,
+            key.data()),
+        0);
+    decrypted.resize(len);
+    BOOST_CHECK_EQUAL(decrypted, plaintext);
+}
+
+BOOST_AUTO_TEST_CASE(it_parses_enc_types) {
+    BOOST_CHECK(parse_enc_type("aes-cbc") == EncryptType::aes_cbc);
+    BOOST_CHECK(parse_enc_type("aes-gcm") == EncryptType::aes_gcm);
+    BOOST_CHECK(parse_enc_type("xchacha20") == EncryptType::xchacha20);
+    BOOST_CHECK_THROW(parse_enc_type("rot13"), std::exception);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
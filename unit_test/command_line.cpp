@@ -123,6 +123,76 @@ BOOST_AUTO_TEST_CASE(it_parses_log_levels) {
     BOOST_CHECK_EQUAL(options.log_level, "foobar");
 }
 
+BOOST_AUTO_TEST_CASE(it_parses_log_tuning) {
+    sispop::command_line_parser parser;
+    const char* argv[] = {"httpserver",
+                          "0.0.0.0",
+                          "80",
+                          "--log-queue-size",
+                          "0",
+                          "--log-flush-interval",
+                          "5",
+                          "--log-flush-level",
+                          "warning"};
+    BOOST_CHECK_NO_THROW(parser.parse_args(sizeof(argv) / sizeof(char*),
+                                           const_cast<char**>(argv)));
+    const auto options = parser.get_options();
+    BOOST_CHECK_EQUAL(options.log_queue_size, 0);
+    BOOST_CHECK_EQUAL(options.log_flush_interval, 5);
+    BOOST_CHECK_EQUAL(options.log_flush_level, "warning");
+}
+
+BOOST_AUTO_TEST_CASE(it_parses_threads) {
+    sispop::command_line_parser parser;
+    const char* argv[] = {"httpserver", "0.0.0.0", "80", "--threads", "4"};
+    BOOST_CHECK_NO_THROW(parser.parse_args(sizeof(argv) / sizeof(char*),
+                                           const_cast<char**>(argv)));
+    const auto options = parser.get_options();
+    BOOST_CHECK_EQUAL(options.threads, 4);
+}
+
+BOOST_AUTO_TEST_CASE(it_parses_tls_session_options) {
+    sispop::command_line_parser parser;
+    const char* argv[] = {"httpserver",
+                          "0.0.0.0",
+                          "80",
+                          "--tls-session-cache-size",
+                          "0",
+                          "--tls-session-timeout",
+                          "600",
+                          "--tls-ticket-key-rotation",
+                          "900"};
+    BOOST_CHECK_NO_THROW(parser.parse_args(sizeof(argv) / sizeof(char*),
+                                           const_cast<char**>(argv)));
+    const auto options = parser.get_options();
+    BOOST_CHECK_EQUAL(options.tls_session_cache_size, 0);
+    BOOST_CHECK_EQUAL(options.tls_session_timeout, 600);
+    BOOST_CHECK_EQUAL(options.tls_ticket_key_rotation, 900);
+}
+
+BOOST_AUTO_TEST_CASE(it_parses_keep_alive_options) {
+    sispop::command_line_parser parser;
+    const char* argv[] = {"httpserver",           "0.0.0.0",
+                          "80",                   "--keep-alive-timeout",
+                          "30",                   "--keep-alive-max-requests",
+                          "0"};
+    BOOST_CHECK_NO_THROW(parser.parse_args(sizeof(argv) / sizeof(char*),
+                                           const_cast<char**>(argv)));
+    const auto options = parser.get_options();
+    BOOST_CHECK_EQUAL(options.keep_alive_timeout, 30);
+    BOOST_CHECK_EQUAL(options.keep_alive_max_requests, 0);
+}
+
+BOOST_AUTO_TEST_CASE(it_parses_peer_connection_pool_size) {
+    sispop::command_line_parser parser;
+    const char* argv[] = {"httpserver", "0.0.0.0", "80",
+                          "--peer-connection-pool-size", "4"};
+    BOOST_CHECK_NO_THROW(parser.parse_args(sizeof(argv) / sizeof(char*),
+                                           const_cast<char**>(argv)));
+    const auto options = parser.get_options();
+    BOOST_CHECK_EQUAL(options.peer_connection_pool_size, 4);
+}
+
 BOOST_AUTO_TEST_CASE(it_throws_with_config_file_not_found) {
     sispop::command_line_parser parser;
     const char* argv[] = {"httpserver", "0.0.0.0", "80", "--config-file",
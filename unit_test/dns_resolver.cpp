@@ -0,0 +1,177 @@
+#include "dns_resolver.h"
+
+#include <boost/asio/steady_timer.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <memory>
+#include <thread>
+
+using namespace std::literals;
+
+using sispop::DnsResolver;
+using sispop::endpoints_t;
+using sispop::resolve_callback_t;
+
+namespace {
+
+/// Stands in for a slow DNS server: every lookup of any name answers
+/// 10.0.0.1 after `delay`
+struct slow_lookup_t {
+
+    std::chrono::milliseconds delay;
+    std::shared_ptr<int> calls = std::make_shared<int>(0);
+    bool fail = false;
+
+    void operator()(boost::asio::io_context& ioc, const std::string&,
+                    resolve_callback_t cb) const {
+        (*calls)++;
+        auto timer = std::make_shared<boost::asio::steady_timer>(ioc, delay);
+        timer->async_wait([timer, cb = std::move(cb),
+                           fail = fail](const boost::system::error_code&) {
+            if (fail) {
+                cb(boost::asio::error::host_not_found, {});
+            } else {
+                cb({}, {{boost::asio::ip::make_address("10.0.0.1"), 0}});
+            }
+        });
+    }
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(dns_resolver)
+
+BOOST_AUTO_TEST_CASE(it_uses_literal_addresses_without_lookup) {
+    boost::asio::io_context ioc;
+    slow_lookup_t lookup{1s};
+    DnsResolver resolver{1min, lookup};
+
+    endpoints_t v4, v6;
+    resolver.resolve(ioc, "1.2.3.4", 22021,
+                     [&](const boost::system::error_code& ec, endpoints_t res) {
+                         BOOST_CHECK(!ec);
+                         v4 = res;
+                     });
+    resolver.resolve(ioc, "::1", 443,
+                     [&](const boost::system::error_code& ec, endpoints_t res) {
+                         BOOST_CHECK(!ec);
+                         v6 = res;
+                     });
+
+    // Answered right away, without running the io_context
+    BOOST_REQUIRE_EQUAL(v4.size(), 1);
+    BOOST_CHECK_EQUAL(v4[0].address().to_string(), "1.2.3.4");
+    BOOST_CHECK_EQUAL(v4[0].port(), 22021);
+    BOOST_REQUIRE_EQUAL(v6.size(), 1);
+    BOOST_CHECK(v6[0].address().is_v6());
+    BOOST_CHECK_EQUAL(*lookup.calls, 0);
+}
+
+BOOST_AUTO_TEST_CASE(it_does_not_block_on_slow_lookups) {
+    boost::asio::io_context ioc;
+    slow_lookup_t lookup{200ms};
+    DnsResolver resolver{1min, lookup};
+
+    bool resolved = false;
+    bool other_work_done = false;
+    bool other_work_done_first = false;
+
+    const auto start = std::chrono::steady_clock::now();
+    resolver.resolve(ioc, "file.example", 443,
+                     [&](const boost::system::error_code& ec, endpoints_t res) {
+                         BOOST_CHECK(!ec);
+                         BOOST_REQUIRE_EQUAL(res.size(), 1);
+                         BOOST_CHECK_EQUAL(res[0].port(), 443);
+                         resolved = true;
+                     });
+    BOOST_CHECK(std::chrono::steady_clock::now() - start < 100ms);
+    BOOST_CHECK(!resolved);
+
+    boost::asio::post(ioc, [&]() {
+        other_work_done = true;
+        other_work_done_first = !resolved;
+    });
+
+    ioc.run();
+
+    BOOST_CHECK(resolved);
+    BOOST_CHECK(other_work_done);
+    BOOST_CHECK(other_work_done_first);
+}
+
+BOOST_AUTO_TEST_CASE(it_caches_names_until_ttl) {
+    boost::asio::io_context ioc;
+    slow_lookup_t lookup{10ms};
+    DnsResolver resolver{100ms, lookup};
+
+    int answers = 0;
+    const auto cb = [&](const boost::system::error_code& ec, endpoints_t res) {
+        BOOST_CHECK(!ec);
+        BOOST_CHECK_EQUAL(res.size(), 1);
+        answers++;
+    };
+
+    resolver.resolve(ioc, "file.example", 443, cb);
+    ioc.run();
+    BOOST_CHECK_EQUAL(answers, 1);
+
+    // Cached: answered right away
+    resolver.resolve(ioc, "file.example", 80, cb);
+    BOOST_CHECK_EQUAL(answers, 2);
+    BOOST_CHECK_EQUAL(*lookup.calls, 1);
+
+    std::this_thread::sleep_for(150ms);
+
+    resolver.resolve(ioc, "file.example", 443, cb);
+    BOOST_CHECK_EQUAL(answers, 2);
+    ioc.restart();
+    ioc.run();
+    BOOST_CHECK_EQUAL(answers, 3);
+    BOOST_CHECK_EQUAL(*lookup.calls, 2);
+}
+
+BOOST_AUTO_TEST_CASE(it_merges_concurrent_lookups) {
+    boost::asio::io_context ioc;
+    slow_lookup_t lookup{50ms};
+    DnsResolver resolver{1min, lookup};
+
+    std::vector<uint16_t> ports;
+    const auto cb = [&](const boost::system::error_code& ec, endpoints_t res) {
+        BOOST_CHECK(!ec);
+        BOOST_REQUIRE_EQUAL(res.size(), 1);
+        ports.push_back(res[0].port());
+    };
+
+    resolver.resolve(ioc, "file.example", 443, cb);
+    resolver.resolve(ioc, "file.example", 8080, cb);
+    ioc.run();
+
+    BOOST_CHECK_EQUAL(*lookup.calls, 1);
+    BOOST_REQUIRE_EQUAL(ports.size(), 2);
+    BOOST_CHECK_EQUAL(ports[0], 443);
+    BOOST_CHECK_EQUAL(ports[1], 8080);
+}
+
+BOOST_AUTO_TEST_CASE(it_does_not_cache_failures) {
+    boost::asio::io_context ioc;
+    slow_lookup_t lookup{10ms};
+    lookup.fail = true;
+    DnsResolver resolver{1min, lookup};
+
+    int failures = 0;
+    const auto cb = [&](const boost::system::error_code& ec, endpoints_t) {
+        BOOST_CHECK(ec);
+        failures++;
+    };
+
+    resolver.resolve(ioc, "nowhere.example", 443, cb);
+    ioc.run();
+    resolver.resolve(ioc, "nowhere.example", 443, cb);
+    ioc.restart();
+    ioc.run();
+
+    BOOST_CHECK_EQUAL(failures, 2);
+    BOOST_CHECK_EQUAL(*lookup.calls, 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
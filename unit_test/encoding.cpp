@@ -0,0 +1,192 @@
+#include "utils.hpp"
+
+#include <boost/beast/core/detail/base64.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <array>
+#include <cctype>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+namespace base64 = boost::beast::detail::base64;
+
+// What the codecs replaced
+std::string beast_base64_encode(const std::string& s) {
+    std::string dest;
+    dest.resize(base64::encoded_size(s.size()));
+    dest.resize(base64::encode(&dest[0], s.data(), s.size()));
+    return dest;
+}
+
+std::string beast_base64_decode(const std::string& s) {
+    std::string dest;
+    // decoded_size() rounds down when the input isn't padded
+    dest.resize(base64::decoded_size(s.size()) + 3);
+    dest.resize(base64::decode(&dest[0], s.data(), s.size()).first);
+    return dest;
+}
+
+std::string random_bytes(std::mt19937& rng, size_t len) {
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::string bytes(len, '\0');
+    for (auto& c : bytes) {
+        c = static_cast<char>(byte(rng));
+    }
+    return bytes;
+}
+
+const std::vector<util::simd_t> simd_levels{
+    util::simd_t::none, util::simd_t::ssse3, util::simd_t::avx2};
+
+/// Run `test` with every instruction set this CPU supports
+template <typename F>
+void for_each_simd(F test) {
+    for (const auto level : simd_levels) {
+        if (level > util::simd_supported()) {
+            continue;
+        }
+        util::set_simd(level);
+        test();
+    }
+    util::set_simd(util::simd_supported());
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(encoding)
+
+BOOST_AUTO_TEST_CASE(it_encodes_base64) {
+    BOOST_CHECK_EQUAL(util::base64_encode(""), "");
+    BOOST_CHECK_EQUAL(util::base64_encode("f"), "Zg==");
+    BOOST_CHECK_EQUAL(util::base64_encode("fo"), "Zm8=");
+    BOOST_CHECK_EQUAL(util::base64_encode("foo"), "Zm9v");
+    BOOST_CHECK_EQUAL(util::base64_decode("Zm9vYg=="), "foob");
+    BOOST_CHECK_EQUAL(util::base64_decode("Zm9vYmE="), "fooba");
+    BOOST_CHECK_EQUAL(util::base64_decode("Zm9vYmFy"), "foobar");
+
+    std::mt19937 rng(7);
+    for_each_simd([&] {
+        for (size_t len = 0; len < 200; ++len) {
+            const auto bytes = random_bytes(rng, len);
+            const auto encoded = util::base64_encode(bytes);
+            BOOST_REQUIRE_EQUAL(encoded, beast_base64_encode(bytes));
+            BOOST_REQUIRE(util::base64_decode(encoded) == bytes);
+        }
+    });
+}
+
+BOOST_AUTO_TEST_CASE(it_stops_decoding_base64_where_beast_does) {
+    std::mt19937 rng(11);
+    const std::string bad_chars = "=-_ \n.*\x80\xff";
+    for_each_simd([&] {
+        for (size_t len = 1; len < 120; ++len) {
+            auto encoded = util::base64_encode(random_bytes(rng, len));
+            // unpadded and truncated input
+            const auto trimmed = encoded.substr(0, encoded.find('='));
+            for (size_t cut = 0; cut <= trimmed.size(); ++cut) {
+                const auto partial = trimmed.substr(0, cut);
+                BOOST_REQUIRE(util::base64_decode(partial) ==
+                              beast_base64_decode(partial));
+            }
+            // anything outside of the alphabet
+            encoded[rng() % encoded.size()] =
+                bad_chars[rng() % bad_chars.size()];
+            BOOST_REQUIRE(util::base64_decode(encoded) ==
+                          beast_base64_decode(encoded));
+        }
+    });
+}
+
+BOOST_AUTO_TEST_CASE(it_encodes_hex) {
+    BOOST_CHECK_EQUAL(util::as_hex(std::string{}), "");
+    BOOST_CHECK_EQUAL(util::as_hex(std::string{"\x01\xab\xff"}), "01abff");
+    BOOST_CHECK_EQUAL(util::hex_to_bytes("01aBfF"), "\x01\xab\xff");
+    // odd characters are ignored, non-hex ones are zeroes
+    BOOST_CHECK_EQUAL(util::hex_to_bytes("01abf"), "\x01\xab");
+    BOOST_CHECK_EQUAL(util::hex_to_bytes("0g1x"), std::string("\x00\x10", 2));
+
+    std::mt19937 rng(13);
+    for_each_simd([&] {
+        for (size_t len = 0; len < 150; ++len) {
+            const auto bytes = random_bytes(rng, len);
+            const auto hex = util::as_hex(bytes);
+            BOOST_REQUIRE_EQUAL(hex, util::as_hex(bytes.begin(), bytes.end()));
+            BOOST_REQUIRE(util::hex_to_bytes(hex) == bytes);
+
+            std::string upper = hex;
+            for (auto& c : upper) {
+                c = std::toupper(c);
+            }
+            BOOST_REQUIRE(util::hex_to_bytes(upper) == bytes);
+        }
+
+        // every character in every position of a vector
+        std::string hex(128, '0');
+        for (int c = 0; c < 256; ++c) {
+            const size_t pos = c % hex.size();
+            hex[pos] = static_cast<char>(c);
+            const auto bytes = util::hex_to_bytes(hex);
+            const bool is_hex = std::isxdigit(c);
+            const int nibble = !is_hex ? 0
+                               : c <= '9' ? c - '0'
+                                          : (std::tolower(c) - 'a' + 10);
+            const int expected = pos % 2 ? nibble : nibble << 4;
+            BOOST_REQUIRE_EQUAL(
+                static_cast<int>(static_cast<uint8_t>(bytes[pos / 2])),
+                                expected);
+            hex[pos] = '0';
+        }
+    });
+}
+
+BOOST_AUTO_TEST_CASE(it_encodes_base32z_keys) {
+    std::mt19937 rng(17);
+    std::uniform_int_distribution<int> byte(0, 255);
+    for (int i = 0; i < 1000; ++i) {
+        std::array<uint8_t, 32> key;
+        for (auto& b : key) {
+            b = byte(rng);
+        }
+
+        char buf[64] = {0};
+        const std::string generic = util::base32z_encode(key, buf);
+        const auto fixed = util::base32z_encode(key);
+        BOOST_REQUIRE_EQUAL(generic, std::string(fixed.begin(), fixed.end()));
+        BOOST_REQUIRE_EQUAL(util::hex_to_base32z(util::as_hex(key)), generic);
+
+        // through the generic decoder and the fixed size one
+        std::array<uint8_t, 32> generic_key{}, fixed_key{};
+        BOOST_REQUIRE(util::base32z_decode(generic.c_str(), generic_key));
+        BOOST_REQUIRE(util::base32z_decode(generic, fixed_key));
+        BOOST_REQUIRE(generic_key == key);
+        BOOST_REQUIRE(fixed_key == key);
+    }
+
+    // Odd sizes
+    const std::array<uint8_t, 3> bytes{{1, 2, 3}};
+    char buf[64] = {0};
+    const auto fixed = util::base32z_encode(bytes);
+    BOOST_CHECK_EQUAL(std::string(fixed.begin(), fixed.end()),
+                      util::base32z_encode(bytes, buf));
+}
+
+BOOST_AUTO_TEST_CASE(it_rejects_bad_base32z_keys) {
+    const std::string good =
+        "yy1ze3ndzsy5wzhiw8wgxnfp5ogrymqa5ic4ucecopsy6pchmfho";
+    std::array<uint8_t, 32> key;
+    BOOST_REQUIRE(util::base32z_decode(good, key));
+
+    for (const auto& bad :
+         {std::string{}, good.substr(1), good + "y", good + ".snode",
+          "Y" + good.substr(1), "l" + good.substr(1), "v" + good.substr(1),
+          good.substr(0, 51) + "2", good.substr(0, 20) + '\0' +
+                                        good.substr(21)}) {
+        BOOST_CHECK(!util::base32z_decode(bad, key));
+        BOOST_CHECK(!util::base32z_decode(bad.c_str(), key));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,52 @@
+#include "https_client.h"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ssl/context.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <memory>
+
+using sispop::HttpsConnectionPool;
+using sispop::https_connection_t;
+
+namespace {
+
+/// Connections of two threads, each with its own io_context
+struct pool_fixture_t {
+    boost::asio::io_context ioc_a;
+    boost::asio::io_context ioc_b;
+    ssl::context ssl_ctx{ssl::context::tlsv12_client};
+    HttpsConnectionPool pool;
+
+    std::shared_ptr<https_connection_t> make(boost::asio::io_context& ioc) {
+        return std::make_shared<https_connection_t>(ioc, ssl_ctx);
+    }
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(https_connection_pool)
+
+BOOST_FIXTURE_TEST_CASE(it_skips_connections_of_other_threads,
+                        pool_fixture_t) {
+    pool.set_max_idle_per_peer(3);
+
+    const auto a1 = make(ioc_a);
+    const auto b = make(ioc_b);
+    const auto a2 = make(ioc_a);
+    pool.put("sn", a1);
+    pool.put("sn", a2);
+    // The most recently used one is another thread's
+    pool.put("sn", b);
+
+    BOOST_CHECK(pool.take(ioc_a, "sn") == a2);
+    BOOST_CHECK(pool.take(ioc_a, "sn") == a1);
+    BOOST_CHECK(pool.take(ioc_a, "sn") == nullptr);
+    BOOST_CHECK(pool.take(ioc_a, "other") == nullptr);
+    BOOST_CHECK_EQUAL(pool.idle_count(), 1);
+
+    BOOST_CHECK(pool.take(ioc_b, "sn") == b);
+    BOOST_CHECK_EQUAL(pool.idle_count(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
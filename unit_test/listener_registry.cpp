@@ -0,0 +1,161 @@
+#include "listener_registry.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct listener_t {
+    sispop::ListenerRegistry<listener_t>::hook_t hook;
+    int id;
+
+    explicit listener_t(int id) : id(id) {}
+};
+
+using registry_t = sispop::ListenerRegistry<listener_t>;
+
+std::vector<std::shared_ptr<listener_t>> make_listeners(int count) {
+    std::vector<std::shared_ptr<listener_t>> listeners;
+    for (int i = 0; i < count; ++i) {
+        listeners.push_back(std::make_shared<listener_t>(i));
+    }
+    return listeners;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(listener_registry)
+
+BOOST_AUTO_TEST_CASE(it_counts_listeners_per_pubkey) {
+    registry_t registry;
+    auto listeners = make_listeners(4);
+
+    registry.add("a", listeners[0]->hook, listeners[0]);
+    registry.add("a", listeners[1]->hook, listeners[1]);
+    registry.add("b", listeners[2]->hook, listeners[2]);
+    // Registering twice does nothing
+    registry.add("b", listeners[1]->hook, listeners[1]);
+
+    BOOST_CHECK_EQUAL(registry.size(), 3);
+    BOOST_CHECK_EQUAL(registry.pubkey_count(), 2);
+    BOOST_CHECK_EQUAL(registry.count("a"), 2);
+    BOOST_CHECK_EQUAL(registry.count("b"), 1);
+    BOOST_CHECK_EQUAL(registry.count("c"), 0);
+    BOOST_CHECK(listeners[1]->hook.is_registered());
+    BOOST_CHECK(!listeners[3]->hook.is_registered());
+
+    BOOST_CHECK(registry.remove(listeners[0]->hook));
+    BOOST_CHECK(!registry.remove(listeners[0]->hook));
+    BOOST_CHECK(!registry.remove(listeners[3]->hook));
+    BOOST_CHECK_EQUAL(registry.count("a"), 1);
+
+    BOOST_CHECK(registry.remove(listeners[2]->hook));
+    BOOST_CHECK_EQUAL(registry.count("b"), 0);
+    BOOST_CHECK_EQUAL(registry.pubkey_count(), 1);
+    BOOST_CHECK_EQUAL(registry.size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(it_keeps_listeners_alive_while_registered) {
+    registry_t registry;
+    auto listener = std::make_shared<listener_t>(1);
+    const std::weak_ptr<listener_t> weak = listener;
+
+    registry.add("a", listener->hook, listener);
+    auto& hook = listener->hook;
+    listener.reset();
+    BOOST_CHECK(!weak.expired());
+
+    BOOST_CHECK(registry.remove(hook));
+    BOOST_CHECK(weak.expired());
+    BOOST_CHECK_EQUAL(registry.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(it_notifies_all_listeners) {
+    registry_t registry;
+    auto listeners = make_listeners(5);
+    for (int i = 0; i < 5; ++i) {
+        registry.add(i % 2 ? "odd" : "even", listeners[i]->hook, listeners[i]);
+    }
+    BOOST_CHECK(registry.remove(listeners[2]->hook));
+
+    std::vector<int> notified;
+    registry.notify_all([&](listener_t& l) {
+        BOOST_CHECK(!l.hook.is_registered());
+        notified.push_back(l.id);
+    });
+    std::sort(notified.begin(), notified.end());
+    BOOST_CHECK(notified == std::vector<int>({0, 1, 3, 4}));
+    BOOST_CHECK_EQUAL(registry.size(), 0);
+    BOOST_CHECK_EQUAL(registry.pubkey_count(), 0);
+
+    // Already notified
+    BOOST_CHECK(!registry.remove(listeners[0]->hook));
+}
+
+BOOST_AUTO_TEST_CASE(it_visits_listeners_without_unregistering_them) {
+    registry_t registry;
+    auto listeners = make_listeners(3);
+    for (int i = 0; i < 3; ++i) {
+        registry.add(i < 2 ? "a" : "b", listeners[i]->hook, listeners[i]);
+    }
+
+    std::vector<int> visited;
+    const auto record = [&](listener_t& l) {
+        BOOST_CHECK(l.hook.is_registered());
+        visited.push_back(l.id);
+    };
+
+    BOOST_CHECK_EQUAL(registry.for_each("a", record), 2);
+    BOOST_CHECK_EQUAL(registry.for_each("c", record), 0);
+    BOOST_CHECK(visited == std::vector<int>({0, 1}));
+    BOOST_CHECK_EQUAL(registry.count("a"), 2);
+    BOOST_CHECK_EQUAL(registry.size(), 3);
+
+    BOOST_CHECK(registry.remove(listeners[0]->hook));
+    visited.clear();
+    BOOST_CHECK_EQUAL(registry.for_each("a", record), 1);
+    BOOST_CHECK(visited == std::vector<int>({1}));
+}
+
+BOOST_AUTO_TEST_CASE(it_can_be_changed_while_notifying) {
+    registry_t registry;
+    auto listeners = make_listeners(6);
+    for (int i = 0; i < 6; ++i) {
+        registry.add(i < 3 ? "a" : "b", listeners[i]->hook, listeners[i]);
+    }
+
+    // The first listener of each pubkey removes the last one and registers
+    // again, for another pubkey
+    std::vector<int> notified;
+    registry.notify_all([&](listener_t& l) {
+        notified.push_back(l.id);
+        if (l.id == 0 || l.id == 3) {
+            BOOST_CHECK(registry.remove(listeners[l.id + 2]->hook));
+            registry.add("c", l.hook, listeners[l.id]);
+        }
+    });
+
+    BOOST_CHECK_EQUAL(notified.size(), 4);
+    BOOST_CHECK_EQUAL(registry.size(), 2);
+    BOOST_CHECK_EQUAL(registry.count("c"), 2);
+    BOOST_CHECK_EQUAL(registry.count("a"), 0);
+
+    // Visited listeners are removed once they respond, after the visit
+    std::vector<listener_t*> responding;
+    BOOST_CHECK_EQUAL(registry.for_each("c",
+                                        [&](listener_t& l) {
+                                            responding.push_back(&l);
+                                        }),
+                      2);
+    for (listener_t* l : responding) {
+        BOOST_CHECK(registry.remove(l->hook));
+    }
+    BOOST_CHECK_EQUAL(registry.size(), 0);
+    BOOST_CHECK_EQUAL(registry.pubkey_count(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,117 @@
+#include "long_poll.h"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <string>
+
+using namespace std::chrono_literals;
+using sispop::LongPoll;
+using sispop::TimerWheel;
+using sispop::message_t;
+
+namespace {
+
+constexpr size_t MAX_MESSAGES = 10;
+constexpr auto TIMEOUT = 20s;
+
+const std::string PUBKEY = "05" + std::string(64, 'a');
+
+message_t make_message(const std::string& pubkey, int i) {
+    return message_t(pubkey, "data " + std::to_string(i),
+                     "hash " + std::to_string(i), 86400000, 0);
+}
+
+/// A long poll for `PUBKEY`, on a wheel driven by hand
+struct long_poll_fixture_t {
+    boost::asio::io_context ioc;
+    TimerWheel& wheel = TimerWheel::get(ioc);
+    LongPoll long_poll{ioc, PUBKEY, MAX_MESSAGES};
+    int timeouts = 0;
+
+    long_poll_fixture_t() {
+        long_poll.start(TIMEOUT, [this]() { timeouts++; });
+    }
+
+    void time_out() {
+        wheel.run_until(TimerWheel::clock::now() + TIMEOUT +
+                        TimerWheel::TICK);
+    }
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(long_poll)
+
+BOOST_FIXTURE_TEST_CASE(it_collects_a_burst_for_one_response,
+                        long_poll_fixture_t) {
+    // Only the first one schedules responding
+    BOOST_CHECK(long_poll.notify(make_message(PUBKEY, 0)));
+    BOOST_CHECK(!long_poll.notify(make_message(PUBKEY, 1)));
+    BOOST_CHECK(!long_poll.notify(make_message(PUBKEY, 2)));
+    BOOST_CHECK(long_poll.pending());
+
+    BOOST_REQUIRE_EQUAL(long_poll.messages().size(), 3);
+    for (int i = 0; i < 3; ++i) {
+        BOOST_CHECK_EQUAL(long_poll.messages()[i].data,
+                          "data " + std::to_string(i));
+    }
+
+    BOOST_CHECK(long_poll.finish());
+    BOOST_CHECK(!long_poll.finish());
+    BOOST_CHECK(!long_poll.notify(make_message(PUBKEY, 3)));
+    BOOST_CHECK_EQUAL(long_poll.messages().size(), 3);
+
+    // Finishing cancels the timeout
+    time_out();
+    BOOST_CHECK_EQUAL(timeouts, 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(it_keeps_at_most_the_limit_of_messages,
+                        long_poll_fixture_t) {
+    for (size_t i = 0; i < MAX_MESSAGES + 5; ++i) {
+        long_poll.notify(make_message(PUBKEY, i));
+    }
+
+    // The first ones; the client retrieves the rest
+    BOOST_REQUIRE_EQUAL(long_poll.messages().size(), MAX_MESSAGES);
+    BOOST_CHECK_EQUAL(long_poll.messages().back().data,
+                      "data " + std::to_string(MAX_MESSAGES - 1));
+}
+
+BOOST_FIXTURE_TEST_CASE(it_ignores_notifications_after_the_timeout,
+                        long_poll_fixture_t) {
+    time_out();
+    BOOST_CHECK_EQUAL(timeouts, 1);
+    BOOST_CHECK(!long_poll.pending());
+
+    BOOST_CHECK(!long_poll.notify(make_message(PUBKEY, 0)));
+    BOOST_CHECK(!long_poll.notify(boost::none));
+    BOOST_CHECK(long_poll.messages().empty());
+    BOOST_CHECK(!long_poll.finish());
+}
+
+BOOST_FIXTURE_TEST_CASE(it_ignores_messages_of_other_pubkeys,
+                        long_poll_fixture_t) {
+    const std::string stale = "05" + std::string(64, 'b');
+    BOOST_CHECK(!long_poll.notify(make_message(stale, 0)));
+    BOOST_CHECK(long_poll.messages().empty());
+
+    BOOST_CHECK(long_poll.notify(make_message(PUBKEY, 1)));
+    BOOST_REQUIRE_EQUAL(long_poll.messages().size(), 1);
+    BOOST_CHECK_EQUAL(long_poll.messages()[0].data, "data 1");
+}
+
+BOOST_FIXTURE_TEST_CASE(it_responds_without_messages_when_reset,
+                        long_poll_fixture_t) {
+    BOOST_CHECK(long_poll.notify(boost::none));
+    BOOST_CHECK(long_poll.messages().empty());
+    BOOST_CHECK(long_poll.pending());
+
+    // Already scheduled
+    BOOST_CHECK(!long_poll.notify(boost::none));
+    BOOST_CHECK(long_poll.finish());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
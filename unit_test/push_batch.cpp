@@ -0,0 +1,312 @@
+#include "channel_encryption.hpp"
+#include "http_connection.h"
+#include "rate_limiter.h"
+#include "security.h"
+#include "serialization.h"
+#include "service_node.h"
+#include "signature.h"
+#include "sispopd_key.h"
+#include "Item.hpp"
+#include "utils.hpp"
+
+#include <boost/asio/ssl.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <openssl/dh.h>
+#include <openssl/obj_mac.h>
+#include <openssl/pem.h>
+
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = boost::filesystem;
+namespace http = boost::beast::http;
+namespace ssl = boost::asio::ssl;
+using tcp = boost::asio::ip::tcp;
+
+namespace {
+
+const std::string PUBKEY =
+    "054368520005786b249bcd461d28f75e560ea794014eeb17fcf6003f37d876783e";
+
+const auto LOCALHOST = boost::asio::ip::make_address("127.0.0.1");
+
+// Certificates are generated on first use, reuse them between runs
+fs::path test_data_dir() {
+
+    const auto dir = fs::temp_directory_path() / "sispop-storage-test";
+    fs::create_directories(dir);
+
+    // The server would generate its own parameters, which takes minutes:
+    // use a well-known group instead
+    const auto dh_path = (dir / "dh.pem").string();
+    if (!fs::exists(dh_path)) {
+        DH* dh = DH_new_by_nid(NID_ffdhe2048);
+        FILE* f = fopen(dh_path.c_str(), "wt");
+        PEM_write_DHparams(f, dh);
+        fclose(f);
+        DH_free(dh);
+    }
+
+    return dir;
+}
+
+uint16_t pick_free_port() {
+    boost::asio::io_context ioc;
+    tcp::acceptor acceptor{ioc, {LOCALHOST, 0}};
+    return acceptor.local_endpoint().port();
+}
+
+sispop::sispopd_key_pair_t test_key_pair() {
+    sispop::sispopd_key_pair_t key_pair;
+    key_pair.private_key = {151, 254, 73,  194, 212, 54,  229, 163,
+                            159, 138, 162, 227, 55,  77,  25,  181,
+                            50,  238, 207, 178, 176, 54,  126, 170,
+                            111, 112, 50,  121, 227, 78,  193, 2};
+    key_pair.public_key = sispop::derive_pubkey_legacy(key_pair.private_key);
+    return key_pair;
+}
+
+/// Sispopd's RPC, telling everyone that the network is just the node with
+/// `key_pair` (in a swarm of its own, responsible for all pubkeys)
+class fake_sispopd_t {
+
+    boost::asio::io_context ioc_{1};
+    tcp::acceptor acceptor_{ioc_, {LOCALHOST, 0}};
+    const std::string response_;
+    std::thread thread_;
+
+    void accept() {
+        acceptor_.async_accept(
+            [this](boost::system::error_code ec, tcp::socket socket) {
+                if (ec) {
+                    return;
+                }
+                serve(socket);
+                accept();
+            });
+    }
+
+    void serve(tcp::socket& socket) {
+        boost::system::error_code ec;
+        boost::beast::flat_buffer buffer;
+        http::request<http::string_body> req;
+        http::read(socket, buffer, req, ec);
+        if (ec) {
+            return;
+        }
+
+        http::response<http::string_body> res{http::status::ok, 11};
+        res.set(http::field::content_type, "application/json");
+        res.keep_alive(false);
+        res.body() = response_;
+        res.prepare_payload();
+        http::write(socket, res, ec);
+        socket.shutdown(tcp::socket::shutdown_both, ec);
+    }
+
+  public:
+    fake_sispopd_t(const sispop::sispopd_key_pair_t& key_pair, uint16_t port)
+        : response_(
+              R"({"id":"0","jsonrpc":"2.0","result":{"service_node_states":[)"
+              R"({"funded":true,"public_ip":"127.0.0.1","pubkey_ed25519":")" +
+              util::as_hex(key_pair.public_key) + R"(","pubkey_x25519":")" +
+              util::as_hex(key_pair.public_key) +
+              R"(","service_node_pubkey":")" +
+              util::as_hex(key_pair.public_key) + R"(","storage_port":)" +
+              std::to_string(port) + R"(,"swarm_id":1}],"height":1,)"
+              R"("block_hash":")" + std::string(64, 'a') +
+              R"(","hardfork":14,"status":"OK"}})") {
+        accept();
+        thread_ = std::thread([this]() { ioc_.run(); });
+    }
+
+    ~fake_sispopd_t() {
+        ioc_.stop();
+        thread_.join();
+    }
+
+    uint16_t port() const { return acceptor_.local_endpoint().port(); }
+};
+
+/// A storage server (as set up by main.cpp) listening on localhost, which
+/// is the only node there is
+struct server_fixture_t {
+
+    boost::asio::io_context ioc{1};
+    boost::asio::io_context worker_ioc{1};
+
+    const fs::path data_dir = test_data_dir();
+    const uint16_t port = pick_free_port();
+
+    const sispop::sispopd_key_pair_t key_pair = test_key_pair();
+    fake_sispopd_t sispopd{key_pair, port};
+    sispop::SispopdClient sispopd_client{ioc, "127.0.0.1", sispopd.port()};
+    ChannelEncryption<std::string> channel_encryption{
+        std::vector<uint8_t>(32, 1)};
+    RateLimiter rate_limiter;
+
+    std::unique_ptr<sispop::Security> security;
+    std::unique_ptr<sispop::ServiceNode> service_node;
+
+    std::thread thread;
+
+    server_fixture_t() {
+
+        // Fresh database for every run
+        fs::remove(data_dir / "storage.db");
+
+        security = std::make_unique<sispop::Security>(key_pair, data_dir);
+        service_node = std::make_unique<sispop::ServiceNode>(
+            ioc, worker_ioc, port, key_pair, key_pair, data_dir.string(),
+            sispopd_client, true);
+
+        thread = std::thread([this]() {
+            sispop::http_server::run(ioc, "127.0.0.1", port, data_dir.string(),
+                                     *service_node, channel_encryption,
+                                     rate_limiter, *security, 1);
+        });
+    }
+
+    ~server_fixture_t() {
+        ioc.stop();
+        thread.join();
+    }
+
+    /// Our signature of `body`, as a service node attaches it to a request
+    std::string sign(const std::string& body) const {
+        const auto sig =
+            sispop::generate_signature(sispop::hash_data(body), key_pair);
+        std::string raw_sig(sig.c.begin(), sig.c.end());
+        raw_sig.append(sig.r.begin(), sig.r.end());
+        return util::base64_encode(raw_sig);
+    }
+
+    /// POST `body` to `target` as this very node would to a swarm member,
+    /// with `signature` (one connection per request); returns the response
+    /// status, or 0 if the server couldn't be reached
+    unsigned post_signed(const std::string& target, const std::string& body,
+                         const std::string& signature) {
+
+        boost::asio::io_context client_ioc;
+        ssl::context ssl_ctx{ssl::context::tlsv12_client};
+        ssl::stream<tcp::socket> stream{client_ioc, ssl_ctx};
+
+        boost::system::error_code ec;
+        stream.next_layer().connect({LOCALHOST, port}, ec);
+        if (ec) {
+            return 0;
+        }
+        stream.handshake(ssl::stream_base::client, ec);
+        if (ec) {
+            return 0;
+        }
+
+        const auto pubkey_b32z = util::base32z_encode(key_pair.public_key);
+
+        http::request<http::string_body> req{http::verb::post, target, 11};
+        req.set(http::field::host, "service node");
+        req.set(SISPOP_SENDER_SNODE_PUBKEY_HEADER,
+                std::string(pubkey_b32z.begin(), pubkey_b32z.end()));
+        req.set(SISPOP_SNODE_SIGNATURE_HEADER, signature);
+        req.keep_alive(false);
+        req.body() = body;
+        req.prepare_payload();
+
+        http::write(stream, req, ec);
+        if (ec) {
+            return 0;
+        }
+        boost::beast::flat_buffer buffer;
+        http::response<http::string_body> res;
+        http::read(stream, buffer, res, ec);
+        if (ec) {
+            return 0;
+        }
+        stream.shutdown(ec);
+        return res.result_int();
+    }
+
+    /// Until the server has heard from sispopd it doesn't know any service
+    /// node (and turns signed requests away)
+    unsigned post_signed_when_known(const std::string& target,
+                                    const std::string& body) {
+        const auto deadline =
+            std::chrono::steady_clock::now() + std::chrono::seconds(30);
+        for (;;) {
+            const unsigned status = post_signed(target, body, sign(body));
+            if ((status != 0 &&
+                 status != static_cast<unsigned>(http::status::unauthorized)) ||
+                std::chrono::steady_clock::now() > deadline) {
+                return status;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+
+    std::vector<sispop::storage::Item> retrieve(const std::string& pubkey) {
+        std::promise<std::vector<sispop::storage::Item>> items;
+        boost::asio::post(ioc, [&]() {
+            std::vector<sispop::storage::Item> result;
+            service_node->retrieve(pubkey, "", result);
+            items.set_value(std::move(result));
+        });
+        return items.get_future().get();
+    }
+};
+
+std::string make_batch(size_t count) {
+    const uint64_t timestamp =
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    std::vector<sispop::message_t> messages;
+    for (size_t i = 0; i < count; ++i) {
+        messages.emplace_back(PUBKEY, "data " + std::to_string(i),
+                              "hash " + std::to_string(i), 86400000,
+                              timestamp);
+    }
+    const auto batches = sispop::serialize_messages(messages);
+    BOOST_REQUIRE_EQUAL(batches.size(), 1);
+    return batches.front();
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(push_batch)
+
+BOOST_FIXTURE_TEST_CASE(it_stores_the_messages_of_a_verified_batch,
+                        server_fixture_t) {
+
+    const auto status =
+        post_signed_when_known("/swarms/push_batch/v1", make_batch(3));
+    BOOST_REQUIRE_EQUAL(status, static_cast<unsigned>(http::status::ok));
+
+    const auto items = retrieve(PUBKEY);
+    BOOST_REQUIRE_EQUAL(items.size(), 3);
+    for (size_t i = 0; i < items.size(); ++i) {
+        BOOST_CHECK_EQUAL(items[i].hash, "hash " + std::to_string(i));
+        BOOST_CHECK_EQUAL(items[i].data, "data " + std::to_string(i));
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(it_drops_a_batch_that_fails_verification,
+                        server_fixture_t) {
+
+    BOOST_REQUIRE_EQUAL(post_signed_when_known("/swarms/ping_test/v1", ""),
+                        static_cast<unsigned>(http::status::ok));
+
+    // Signed by a known node, but not what it signed
+    const auto status = post_signed("/swarms/push_batch/v1", make_batch(3),
+                                    sign(make_batch(2)));
+    BOOST_CHECK_EQUAL(status, static_cast<unsigned>(http::status::unauthorized));
+
+    BOOST_CHECK(retrieve(PUBKEY).empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -75,6 +75,27 @@ BOOST_AUTO_TEST_CASE(it_signs_and_verifies_encoded_inputs) {
     BOOST_CHECK(verified);
 }
 
+BOOST_AUTO_TEST_CASE(it_signs_many_payloads) {
+    using namespace sispop;
+
+    const public_key_t public_key{227, 91,  124, 245, 5,   120, 69,  40,
+                                  71,  64,  175, 73,  110, 195, 35,  20,
+                                  141, 182, 138, 194, 85,  58,  5,   228,
+                                  103, 123, 150, 243, 175, 218, 188, 209};
+    const private_key_t secret_key{151, 254, 73,  194, 212, 54, 229, 163,
+                                   159, 138, 162, 227, 55,  77, 25,  181,
+                                   50,  238, 207, 178, 176, 54, 126, 170,
+                                   111, 112, 50,  121, 227, 78, 193, 2};
+    sispopd_key_pair_t key_pair{secret_key, public_key};
+
+    // Every signature uses a new random nonce, i.e. other table entries
+    for (int i = 0; i < 64; ++i) {
+        const auto hash = hash_data("payload " + std::to_string(i));
+        BOOST_CHECK(check_signature(generate_signature(hash, key_pair), hash,
+                                    public_key));
+    }
+}
+
 BOOST_AUTO_TEST_CASE(it_rejects_wrong_signature) {
     using namespace sispop;
 
@@ -97,4 +118,212 @@ BOOST_AUTO_TEST_CASE(it_rejects_wrong_signature) {
     BOOST_CHECK(!verified);
 }
 
+BOOST_AUTO_TEST_CASE(it_checks_signatures_in_batches) {
+    using namespace sispop;
+
+    const public_key_t public_key{227, 91,  124, 245, 5,   120, 69,  40,
+                                  71,  64,  175, 73,  110, 195, 35,  20,
+                                  141, 182, 138, 194, 85,  58,  5,   228,
+                                  103, 123, 150, 243, 175, 218, 188, 209};
+    const private_key_t secret_key{151, 254, 73,  194, 212, 54, 229, 163,
+                                   159, 138, 162, 227, 55,  77, 25,  181,
+                                   50,  238, 207, 178, 176, 54, 126, 170,
+                                   111, 112, 50,  121, 227, 78, 193, 2};
+    sispopd_key_pair_t key_pair{secret_key, public_key};
+
+    const auto hash = hash_data("This is the payload");
+    const auto other_hash = hash_data("This is another payload");
+
+    std::vector<signature_check_t> checks;
+    checks.push_back({generate_signature(hash, key_pair), hash, public_key});
+    checks.push_back({generate_signature(hash, key_pair), other_hash,
+                      public_key});
+    checks.push_back({generate_signature(hash, key_pair), hash, public_key});
+    checks.back().sig.c[4]++;
+    checks.push_back({generate_signature(hash, key_pair), hash, public_key});
+    checks.back().sig.r.fill(0xff); // not reduced
+    checks.push_back(
+        {generate_signature(other_hash, key_pair), other_hash, public_key});
+
+    const auto valid = check_signatures(checks);
+    BOOST_REQUIRE_EQUAL(valid.size(), checks.size());
+    BOOST_CHECK(valid[0]);
+    BOOST_CHECK(!valid[1]);
+    BOOST_CHECK(!valid[2]);
+    BOOST_CHECK(!valid[3]);
+    BOOST_CHECK(valid[4]);
+
+    // Same answers one by one
+    for (size_t i = 0; i < checks.size(); ++i) {
+        BOOST_CHECK_EQUAL(check_signature(checks[i].sig,
+                                          checks[i].prefix_hash,
+                                          checks[i].pub),
+                          valid[i]);
+    }
+
+    BOOST_CHECK(check_signatures({}).empty());
+}
+
+static std::string sign_b64(const sispop::hash& hash,
+                            const sispop::sispopd_key_pair_t& key_pair) {
+    const auto sig = sispop::generate_signature(hash, key_pair);
+    std::string raw_sig;
+    raw_sig.reserve(sig.c.size() + sig.r.size());
+    raw_sig.insert(raw_sig.begin(), sig.c.begin(), sig.c.end());
+    raw_sig.insert(raw_sig.end(), sig.r.begin(), sig.r.end());
+    return util::base64_encode(raw_sig);
+}
+
+BOOST_AUTO_TEST_CASE(it_caches_verified_signatures) {
+    using namespace sispop;
+
+    const public_key_t public_key{227, 91,  124, 245, 5,   120, 69,  40,
+                                  71,  64,  175, 73,  110, 195, 35,  20,
+                                  141, 182, 138, 194, 85,  58,  5,   228,
+                                  103, 123, 150, 243, 175, 218, 188, 209};
+    const private_key_t secret_key{151, 254, 73,  194, 212, 54, 229, 163,
+                                   159, 138, 162, 227, 55,  77, 25,  181,
+                                   50,  238, 207, 178, 176, 54, 126, 170,
+                                   111, 112, 50,  121, 227, 78, 193, 2};
+    sispopd_key_pair_t key_pair{secret_key, public_key};
+
+    char buf[64] = {0};
+    const std::string public_key_b32z = util::base32z_encode(public_key, buf);
+
+    const auto hash = hash_data("This is the payload");
+    const auto sig_b64 = sign_b64(hash, key_pair);
+
+    SignatureCache cache{2};
+
+    BOOST_CHECK(cache.check(sig_b64, hash, public_key_b32z));
+    BOOST_CHECK(cache.check(sig_b64, hash, public_key_b32z));
+    BOOST_CHECK_EQUAL(cache.misses(), 1);
+    BOOST_CHECK_EQUAL(cache.hits(), 1);
+
+    // Same signature, different payload
+    const auto other_hash = hash_data("This is another payload");
+    BOOST_CHECK(!cache.check(sig_b64, other_hash, public_key_b32z));
+    BOOST_CHECK(!cache.check(sig_b64, other_hash, public_key_b32z));
+    BOOST_CHECK_EQUAL(cache.misses(), 3);
+    BOOST_CHECK_EQUAL(cache.size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(it_rejects_signatures_of_the_wrong_length) {
+    using namespace sispop;
+
+    const public_key_t public_key{227, 91,  124, 245, 5,   120, 69,  40,
+                                  71,  64,  175, 73,  110, 195, 35,  20,
+                                  141, 182, 138, 194, 85,  58,  5,   228,
+                                  103, 123, 150, 243, 175, 218, 188, 209};
+    const private_key_t secret_key{151, 254, 73,  194, 212, 54, 229, 163,
+                                   159, 138, 162, 227, 55,  77, 25,  181,
+                                   50,  238, 207, 178, 176, 54, 126, 170,
+                                   111, 112, 50,  121, 227, 78, 193, 2};
+    sispopd_key_pair_t key_pair{secret_key, public_key};
+
+    char buf[64] = {0};
+    const std::string public_key_b32z = util::base32z_encode(public_key, buf);
+
+    const auto hash = hash_data("This is the payload");
+    const auto raw_sig = util::base64_decode(sign_b64(hash, key_pair));
+
+    signature_check_t check;
+    BOOST_CHECK(decode_signature_check(util::base64_encode(raw_sig), hash,
+                                       public_key_b32z, check));
+
+    // As sent in a request header, so anything goes
+    const std::string bad_signatures[] = {
+        "", "garbage", util::base64_encode(raw_sig.substr(0, 40)),
+        util::base64_encode(raw_sig + "extra")};
+    for (const auto& signature : bad_signatures) {
+        BOOST_TEST_CONTEXT("signature: " << signature) {
+            BOOST_CHECK(!decode_signature_check(signature, hash,
+                                                public_key_b32z, check));
+            BOOST_CHECK(!check_signature(signature, hash, public_key_b32z));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(it_evicts_least_recently_used_signatures) {
+    using namespace sispop;
+
+    const public_key_t public_key{227, 91,  124, 245, 5,   120, 69,  40,
+                                  71,  64,  175, 73,  110, 195, 35,  20,
+                                  141, 182, 138, 194, 85,  58,  5,   228,
+                                  103, 123, 150, 243, 175, 218, 188, 209};
+    const private_key_t secret_key{151, 254, 73,  194, 212, 54, 229, 163,
+                                   159, 138, 162, 227, 55,  77, 25,  181,
+                                   50,  238, 207, 178, 176, 54, 126, 170,
+                                   111, 112, 50,  121, 227, 78, 193, 2};
+    sispopd_key_pair_t key_pair{secret_key, public_key};
+
+    char buf[64] = {0};
+    const std::string public_key_b32z = util::base32z_encode(public_key, buf);
+
+    const auto hash_a = hash_data("a");
+    const auto hash_b = hash_data("b");
+    const auto hash_c = hash_data("c");
+    const auto sig_a = sign_b64(hash_a, key_pair);
+    const auto sig_b = sign_b64(hash_b, key_pair);
+    const auto sig_c = sign_b64(hash_c, key_pair);
+
+    SignatureCache cache{2};
+
+    cache.check(sig_a, hash_a, public_key_b32z);
+    cache.check(sig_b, hash_b, public_key_b32z);
+    // `a` is now more recent than `b`
+    cache.check(sig_a, hash_a, public_key_b32z);
+    cache.check(sig_c, hash_c, public_key_b32z);
+    BOOST_CHECK_EQUAL(cache.size(), 2);
+    BOOST_CHECK_EQUAL(cache.hits(), 1);
+
+    cache.check(sig_a, hash_a, public_key_b32z);
+    BOOST_CHECK_EQUAL(cache.hits(), 2);
+    cache.check(sig_b, hash_b, public_key_b32z);
+    BOOST_CHECK_EQUAL(cache.hits(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(it_draws_nonces_from_the_whole_scalar) {
+    using namespace sispop;
+
+    // Every byte gets set, not just the first few
+    std::array<bool, EC_SCALAR_SIZE> byte_used{};
+    for (int i = 0; i < 64; ++i) {
+        ec_scalar k{};
+        random_scalar(k);
+        // Reduced modulo the group order (a little over 2^252)
+        BOOST_CHECK_LE(k.back(), 0x10);
+        for (size_t j = 0; j < k.size(); ++j) {
+            byte_used[j] = byte_used[j] || k[j] != 0;
+        }
+    }
+    for (size_t j = 0; j < byte_used.size(); ++j) {
+        BOOST_TEST_CONTEXT("byte " << j) { BOOST_CHECK(byte_used[j]); }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(it_always_generates_valid_signatures) {
+    using namespace sispop;
+
+    const public_key_t public_key{227, 91,  124, 245, 5,   120, 69,  40,
+                                  71,  64,  175, 73,  110, 195, 35,  20,
+                                  141, 182, 138, 194, 85,  58,  5,   228,
+                                  103, 123, 150, 243, 175, 218, 188, 209};
+    const private_key_t secret_key{151, 254, 73,  194, 212, 54, 229, 163,
+                                   159, 138, 162, 227, 55,  77, 25,  181,
+                                   50,  238, 207, 178, 176, 54, 126, 170,
+                                   111, 112, 50,  121, 227, 78, 193, 2};
+    const sispopd_key_pair_t key_pair{secret_key, public_key};
+
+    const auto hash = hash_data("This is the payload");
+    int failed = 0;
+    for (int i = 0; i < 200; ++i) {
+        const auto sig = generate_signature(hash, key_pair);
+        if (!check_signature(sig, hash, public_key)) {
+            failed++;
+        }
+    }
+    BOOST_CHECK_EQUAL(failed, 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,101 @@
+#include "signature_batcher.h"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <memory>
+#include <vector>
+
+using sispop::SignatureBatcher;
+using sispop::signature_check_t;
+
+namespace {
+
+signature_check_t make_check(const std::string& payload, bool valid) {
+    using namespace sispop;
+
+    const public_key_t public_key{227, 91,  124, 245, 5,   120, 69,  40,
+                                  71,  64,  175, 73,  110, 195, 35,  20,
+                                  141, 182, 138, 194, 85,  58,  5,   228,
+                                  103, 123, 150, 243, 175, 218, 188, 209};
+    const private_key_t secret_key{151, 254, 73,  194, 212, 54, 229, 163,
+                                   159, 138, 162, 227, 55,  77, 25,  181,
+                                   50,  238, 207, 178, 176, 54, 126, 170,
+                                   111, 112, 50,  121, 227, 78, 193, 2};
+    const sispopd_key_pair_t key_pair{secret_key, public_key};
+
+    const auto hash = hash_data(payload);
+    signature_check_t check{generate_signature(hash, key_pair), hash,
+                            public_key};
+    if (!valid) {
+        check.sig.c[4]++;
+    }
+    return check;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(signature_batcher)
+
+BOOST_AUTO_TEST_CASE(it_checks_signatures_queued_together_at_once) {
+    boost::asio::io_context ioc;
+    auto& batcher = SignatureBatcher::get(ioc);
+
+    std::vector<int> results(4, -1);
+    // Like connections whose requests have all been read by the time the
+    // first one gets to run
+    for (int i = 0; i < 4; ++i) {
+        boost::asio::post(ioc, [&, i]() {
+            batcher.check(make_check("payload " + std::to_string(i), i != 2),
+                          [&, i](bool valid) { results[i] = valid; });
+        });
+    }
+    ioc.run();
+
+    BOOST_CHECK(results == std::vector<int>({1, 1, 0, 1}));
+    BOOST_CHECK_EQUAL(batcher.batches(), 1);
+    BOOST_CHECK_EQUAL(batcher.checked(), 4);
+}
+
+BOOST_AUTO_TEST_CASE(it_never_calls_back_before_returning) {
+    boost::asio::io_context ioc;
+    auto& batcher = SignatureBatcher::get(ioc);
+
+    bool called = false;
+    batcher.check(make_check("payload", true), [&](bool) { called = true; });
+    BOOST_CHECK(!called);
+
+    ioc.run();
+    BOOST_CHECK(called);
+}
+
+BOOST_AUTO_TEST_CASE(it_lets_callbacks_queue_the_next_batch) {
+    boost::asio::io_context ioc;
+    auto& batcher = SignatureBatcher::get(ioc);
+
+    std::vector<bool> results;
+    batcher.check(make_check("first", true), [&](bool valid) {
+        results.push_back(valid);
+        batcher.check(make_check("second", false),
+                      [&](bool valid) { results.push_back(valid); });
+    });
+    ioc.run();
+
+    BOOST_CHECK(results == std::vector<bool>({true, false}));
+    BOOST_CHECK_EQUAL(batcher.batches(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(it_drops_pending_callbacks_with_the_io_context) {
+    auto holder = std::make_shared<int>(0);
+    auto ioc = std::make_unique<boost::asio::io_context>();
+
+    SignatureBatcher::get(*ioc).check(make_check("payload", true),
+                                      [holder](bool) {});
+    BOOST_CHECK_EQUAL(holder.use_count(), 2);
+
+    ioc.reset();
+    BOOST_CHECK_EQUAL(holder.use_count(), 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,463 @@
+#include "swarm.h"
+#include "utils.hpp"
+
+#include "../external/json.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+/// A pubkey that maps to `value`
+sispop::user_pubkey_t pubkey_for(uint64_t value) {
+    char buf[17];
+    snprintf(buf, sizeof(buf), "%016llx",
+             static_cast<unsigned long long>(value));
+    bool success;
+    auto pk = sispop::user_pubkey_t::create(
+        "05" + std::string(buf) + std::string(48, '0'), success);
+    BOOST_REQUIRE(success);
+    return pk;
+}
+
+sispop::all_swarms_t make_swarms(const std::vector<swarm_id_t>& ids) {
+    sispop::all_swarms_t swarms;
+    for (const auto id : ids) {
+        swarms.push_back({id, {}});
+    }
+    return swarms;
+}
+
+/// Check the ring lookup against a linear search over `ids`. Ties go to
+/// whichever swarm comes first in a linear search, and swarms come sorted
+/// from the daemon
+void check_lookups(const std::vector<swarm_id_t>& ids,
+                   const std::vector<uint64_t>& values) {
+    sispop::Swarm swarm{sn_record_t{}};
+    swarm.apply_swarm_changes(make_swarms(ids));
+
+    std::vector<swarm_id_t> sorted_ids = ids;
+    std::sort(sorted_ids.begin(), sorted_ids.end());
+    const auto swarms = make_swarms(sorted_ids);
+
+    for (const auto value : values) {
+        const auto pk = pubkey_for(value);
+        const sispop::SwarmInfo* found = swarm.get_swarm_by_pk(pk);
+        BOOST_REQUIRE(found);
+        BOOST_REQUIRE_EQUAL(found->swarm_id,
+                            sispop::get_swarm_by_pk(swarms, pk));
+    }
+}
+
+/// What parse_swarm_update replaced: walking a DOM of the response
+sispop::block_update_t dom_parse_swarm_update(const std::string& response) {
+    const nlohmann::json body = nlohmann::json::parse(response, nullptr, false);
+
+    std::map<swarm_id_t, std::vector<sn_record_t>> swarm_map;
+    sispop::block_update_t bu;
+
+    try {
+        const nlohmann::json service_node_states =
+            body.at("result").at("service_node_states");
+
+        for (const auto& sn_json : service_node_states) {
+            const auto& pubkey =
+                sn_json.at("service_node_pubkey").get_ref<const std::string&>();
+            const swarm_id_t swarm_id =
+                sn_json.at("swarm_id").get<swarm_id_t>();
+            std::string snode_address = util::hex_to_base32z(pubkey);
+            const uint16_t port = sn_json.at("storage_port").get<uint16_t>();
+            const auto& snode_ip =
+                sn_json.at("public_ip").get_ref<const std::string&>();
+            const auto& pubkey_x25519 =
+                sn_json.at("pubkey_x25519").get_ref<const std::string&>();
+            const auto& pubkey_ed25519 =
+                sn_json.at("pubkey_ed25519").get_ref<const std::string&>();
+
+            const auto sn =
+                sn_record_t{port,          std::move(snode_address), pubkey,
+                            pubkey_x25519, pubkey_ed25519,           snode_ip};
+
+            if (!sn_json.at("funded").get<bool>()) {
+                continue;
+            }
+
+            if (swarm_id == INVALID_SWARM_ID) {
+                bu.decommissioned_nodes.push_back(sn);
+            } else {
+                swarm_map[swarm_id].push_back(sn);
+            }
+        }
+
+        bu.height = body.at("result").at("height").get<uint64_t>();
+        bu.block_hash = body.at("result").at("block_hash").get<std::string>();
+        bu.hardfork = body.at("result").at("hardfork").get<int>();
+
+    } catch (...) {
+    }
+
+    for (auto const& swarm : swarm_map) {
+        bu.swarms.emplace_back(sispop::SwarmInfo{swarm.first, swarm.second});
+    }
+
+    return bu;
+}
+
+void print_nodes(std::ostream& os, const std::vector<sn_record_t>& nodes) {
+    for (const auto& sn : nodes) {
+        os << ' ' << sn.pub_key_hex() << ':' << sn.port() << '@' << sn.ip()
+           << '/' << sn.pubkey_x25519_hex() << '/' << sn.pubkey_ed25519_hex();
+    }
+}
+
+/// Everything parse_swarm_update returns, to compare
+std::string describe(const sispop::block_update_t& bu) {
+    std::ostringstream os;
+    os << bu.height << ' ' << bu.block_hash << ' ' << bu.hardfork;
+    for (const auto& si : bu.swarms) {
+        os << "\n" << si.swarm_id << ':';
+        print_nodes(os, si.snodes);
+    }
+    os << "\ndecommissioned:";
+    print_nodes(os, bu.decommissioned_nodes);
+    return os.str();
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(swarm)
+
+BOOST_AUTO_TEST_CASE(it_finds_the_closest_swarm) {
+    const std::vector<uint64_t> values{0,
+                                       1,
+                                       99,
+                                       100,
+                                       101,
+                                       150,
+                                       151,
+                                       200,
+                                       1000,
+                                       INVALID_SWARM_ID / 2,
+                                       INVALID_SWARM_ID - 2,
+                                       INVALID_SWARM_ID - 1,
+                                       INVALID_SWARM_ID};
+
+    // Unsorted, with ties halfway between swarms
+    check_lookups({200, 100, 1000}, values);
+    // Going around the ends
+    check_lookups({INVALID_SWARM_ID - 100, 50, INVALID_SWARM_ID / 2}, values);
+    check_lookups({10}, values);
+    // The sentinel id is never returned
+    check_lookups({300, INVALID_SWARM_ID, 100}, values);
+}
+
+BOOST_AUTO_TEST_CASE(it_finds_swarms_like_a_linear_search) {
+    std::mt19937_64 rng(5);
+    for (int round = 0; round < 20; ++round) {
+        std::vector<swarm_id_t> ids(1 + rng() % 200);
+        for (auto& id : ids) {
+            id = rng() % (INVALID_SWARM_ID - 1);
+        }
+        std::sort(ids.begin(), ids.end());
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+        std::shuffle(ids.begin(), ids.end(), rng);
+
+        std::vector<uint64_t> values;
+        for (int i = 0; i < 200; ++i) {
+            values.push_back(rng());
+        }
+        // On and right next to every swarm
+        for (const auto id : ids) {
+            values.push_back(id);
+            values.push_back(id + 1);
+            values.push_back(id - 1);
+        }
+        check_lookups(ids, values);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(it_has_no_swarm_without_swarms) {
+    sispop::Swarm swarm{sn_record_t{}};
+    swarm.apply_swarm_changes({});
+    BOOST_CHECK(!swarm.get_swarm_by_pk(pubkey_for(1000)));
+    // Neither are we in one, which is what the linear search said too
+    BOOST_CHECK(swarm.is_pubkey_for_us(pubkey_for(1000)));
+    BOOST_CHECK_EQUAL(sispop::get_swarm_by_pk({}, pubkey_for(1000)),
+                      INVALID_SWARM_ID);
+}
+
+BOOST_AUTO_TEST_CASE(it_caches_swarms_until_they_change) {
+    sispop::Swarm swarm{sn_record_t{}};
+    swarm.apply_swarm_changes(make_swarms({100, 200}));
+
+    const auto pk = pubkey_for(180);
+    BOOST_CHECK_EQUAL(swarm.get_swarm_by_pk(pk)->swarm_id, 200);
+    BOOST_CHECK_EQUAL(swarm.get_swarm_by_pk(pk)->swarm_id, 200);
+    BOOST_CHECK_EQUAL(swarm.swarm_cache_misses(), 1);
+    BOOST_CHECK_EQUAL(swarm.swarm_cache_hits(), 1);
+
+    swarm.apply_swarm_changes(make_swarms({100, 170, 300}));
+    BOOST_CHECK_EQUAL(swarm.get_swarm_by_pk(pk)->swarm_id, 170);
+    BOOST_CHECK_EQUAL(swarm.swarm_cache_misses(), 2);
+
+    swarm.apply_swarm_changes(make_swarms({100}));
+    BOOST_CHECK_EQUAL(swarm.get_swarm_by_pk(pk)->swarm_id, 100);
+    BOOST_CHECK_EQUAL(swarm.get_swarm_by_pk(pk)->swarm_id, 100);
+    BOOST_CHECK_EQUAL(swarm.swarm_cache_misses(), 3);
+    BOOST_CHECK_EQUAL(swarm.swarm_cache_hits(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(it_finds_funded_nodes_by_key) {
+    const auto node = [](uint16_t port, char c) {
+        return sn_record_t{port,
+                           std::string(52, c),
+                           std::string(64, "0123456789abcdef"[port]),
+                           "x25519_" + std::string(1, c),
+                           "ed25519_" + std::string(1, c),
+                           "0.0.0.0"};
+    };
+    const auto us = node(1, 'y');
+    sispop::all_swarms_t swarms{{100, {us, node(2, 'b')}},
+                                {200, {node(3, 'n'), node(4, 'd')}}};
+    const std::vector<sn_record_t> decommissioned{node(5, 'r')};
+
+    sispop::Swarm swarm{us};
+    auto events = swarm.derive_swarm_events(swarms);
+    swarm.update_state(swarms, decommissioned, events);
+
+    BOOST_CHECK(swarm.is_fully_funded_node(std::string(52, 'd') + ".snode"));
+    BOOST_CHECK(swarm.is_fully_funded_node(std::string(52, 'r') + ".snode"));
+    BOOST_CHECK(!swarm.is_fully_funded_node(std::string(52, 'f') + ".snode"));
+    BOOST_CHECK(!swarm.is_fully_funded_node(std::string(52, 'd')));
+    BOOST_CHECK(!swarm.is_fully_funded_node(std::string(52, 'd') + ".snodes"));
+    BOOST_CHECK(!swarm.is_fully_funded_node(".snode"));
+
+    BOOST_REQUIRE(swarm.get_node_by_pk(std::string(52, 'n')));
+    BOOST_CHECK_EQUAL(swarm.get_node_by_pk(std::string(52, 'n'))->port(), 3);
+    BOOST_CHECK(!swarm.get_node_by_pk(std::string(52, 'f')));
+
+    BOOST_REQUIRE(swarm.find_node_by_ed25519_pk("ed25519_r"));
+    BOOST_CHECK_EQUAL(swarm.find_node_by_ed25519_pk("ed25519_r")->port(), 5);
+    BOOST_CHECK(!swarm.find_node_by_ed25519_pk("ed25519_f"));
+
+    // The next update replaces the nodes
+    swarms[1].snodes.pop_back();
+    swarms[1].snodes.push_back(node(6, 'f'));
+    events = swarm.derive_swarm_events(swarms);
+    swarm.update_state(swarms, {}, events);
+
+    BOOST_CHECK(!swarm.is_fully_funded_node(std::string(52, 'd') + ".snode"));
+    BOOST_CHECK(!swarm.is_fully_funded_node(std::string(52, 'r') + ".snode"));
+    BOOST_CHECK(swarm.is_fully_funded_node(std::string(52, 'f') + ".snode"));
+    BOOST_CHECK_EQUAL(swarm.find_node_by_ed25519_pk("ed25519_f")->port(), 6);
+    BOOST_CHECK(!swarm.find_node_by_ed25519_pk("ed25519_d"));
+}
+
+BOOST_AUTO_TEST_CASE(it_shares_record_keys_between_copies) {
+    const std::string pk_hex =
+        "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef";
+    const sn_record_t sn{8080, std::string(52, 'y'), pk_hex, "x25519",
+                         "ed25519", "10.1.2.3"};
+
+    BOOST_CHECK_EQUAL(sn.sn_address(), std::string(52, 'y') + ".snode");
+    BOOST_CHECK_EQUAL(sn.pub_key_base32z(), std::string(52, 'y'));
+    BOOST_CHECK_EQUAL(sn.pub_key_hex(), pk_hex);
+    BOOST_CHECK_EQUAL(sn.pub_key()[1], 0x23);
+    BOOST_CHECK_EQUAL(sn.ip(), "10.1.2.3");
+    BOOST_CHECK_EQUAL(sn.ip_v4(), 0x0a010203);
+
+    auto copy = sn;
+    BOOST_CHECK(copy.same_keys(sn));
+    BOOST_CHECK(&copy.pub_key_hex() == &sn.pub_key_hex());
+    copy.set_ip("192.168.0.255");
+    BOOST_CHECK_EQUAL(copy.ip(), "192.168.0.255");
+    BOOST_CHECK_EQUAL(sn.ip(), "10.1.2.3");
+    BOOST_CHECK(copy == sn);
+
+    // Equal keys from different records
+    const sn_record_t other{1, std::string(52, 'b'), pk_hex, "", "", ""};
+    BOOST_CHECK(!other.same_keys(sn));
+    BOOST_CHECK(other == sn);
+    BOOST_CHECK(std::hash<sn_record_t>{}(other) ==
+                std::hash<sn_record_t>{}(sn));
+
+    // Anything but IPv4 is not known yet
+    for (const auto& ip : {"", "0.0.0.0", "1.2.3", "1.2.3.4.5", "256.1.1.1",
+                           "1.2.3.4 ", "::1", "a.b.c.d"}) {
+        copy.set_ip(ip);
+        BOOST_CHECK_EQUAL(copy.ip_v4(), 0);
+        BOOST_CHECK_EQUAL(copy.ip(), "0.0.0.0");
+    }
+
+    BOOST_CHECK_THROW(sn_record_t(1, "short", pk_hex, "", "", ""),
+                      std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(it_parses_swarm_updates) {
+    const auto node = [](char c, const std::string& swarm_id,
+                         const std::string& funded) {
+        return R"({"service_node_pubkey":")" + std::string(64, c) +
+               R"(","swarm_id":)" + swarm_id +
+               R"(,"storage_port":8080,"public_ip":"10.0.0.1",)"
+               R"("pubkey_x25519":"x","pubkey_ed25519":"e","funded":)" +
+               funded + "}";
+    };
+    const auto body = std::make_shared<std::string>(
+        R"({"result":{"service_node_states":[)" + node('1', "200", "true") +
+        "," + node('2', "100", "true") + "," + node('3', "100", "false") +
+        "," + node('4', std::to_string(INVALID_SWARM_ID), "true") +
+        R"(],"height":42,"block_hash" : "abc123","hardfork":14}})");
+
+    const auto bu = sispop::parse_swarm_update(body);
+    BOOST_CHECK_EQUAL(bu.height, 42);
+    BOOST_CHECK_EQUAL(bu.block_hash, "abc123");
+    BOOST_CHECK_EQUAL(bu.hardfork, 14);
+    BOOST_REQUIRE_EQUAL(bu.swarms.size(), 2);
+    BOOST_CHECK_EQUAL(bu.swarms[0].swarm_id, 100);
+    BOOST_REQUIRE_EQUAL(bu.swarms[0].snodes.size(), 1);
+    BOOST_CHECK_EQUAL(bu.swarms[0].snodes[0].pub_key_hex(),
+                      std::string(64, '2'));
+    BOOST_CHECK_EQUAL(bu.swarms[1].swarm_id, 200);
+    BOOST_REQUIRE_EQUAL(bu.decommissioned_nodes.size(), 1);
+    BOOST_CHECK_EQUAL(bu.decommissioned_nodes[0].pub_key_hex(),
+                      std::string(64, '4'));
+
+    BOOST_CHECK(!bu.unchanged);
+
+    // Without the nodes when polling with the same block hash
+    const auto unchanged = sispop::parse_swarm_update(
+        std::make_shared<std::string>(R"({"result":{"height":42,)"
+                                      R"("block_hash":"abc123","hardfork":14,)"
+                                      R"("unchanged":true,"status":"OK"}})"));
+    BOOST_CHECK(unchanged.unchanged);
+    BOOST_CHECK(unchanged.swarms.empty());
+
+    BOOST_CHECK_EQUAL(sispop::peek_block_hash(*body), "abc123");
+    BOOST_CHECK_EQUAL(sispop::peek_block_hash(R"({"block_hash":""})"), "");
+    BOOST_CHECK_EQUAL(sispop::peek_block_hash(R"({"height":42})"), "");
+    BOOST_CHECK_EQUAL(sispop::peek_block_hash(R"({"block_hash":42})"), "");
+    BOOST_CHECK_EQUAL(sispop::peek_block_hash(R"({"block_hash":"abc)"), "");
+}
+
+BOOST_AUTO_TEST_CASE(it_parses_swarm_updates_like_the_dom) {
+    const std::string pk1(64, '1'), pk2(64, '2');
+    const auto node = [](const std::string& pk, const std::string& swarm_id,
+                         const std::string& extra = "") {
+        return R"({"funded":true,"public_ip":"10.0.0.1",)"
+               R"("pubkey_ed25519":"e","pubkey_x25519":"x",)"
+               R"("service_node_pubkey":")" +
+               pk + R"(","storage_port":8080,"swarm_id":)" + swarm_id +
+               extra + "}";
+    };
+    const auto response = [](const std::string& nodes,
+                             const std::string& rest =
+                                 R"(,"height":42,"block_hash":"abc",)"
+                                 R"("hardfork":14)") {
+        return R"({"id":"0","result":{"service_node_states":[)" + nodes +
+               "]" + rest + "}}";
+    };
+    const std::string decommissioned = std::to_string(INVALID_SWARM_ID);
+    const std::string good = node(pk1, "200") + "," + node(pk2, "100");
+
+    const std::vector<std::string> responses{
+        response(good),
+        response(good + "," + node(std::string(64, '3'), decommissioned)),
+        response(""),
+        // Last one wins
+        response(node(pk1, "200", R"(,"swarm_id":300,"public_ip":"1.2.3.4")")),
+        // Extra fields, nested or not
+        response(node(pk1, "200", R"(,"x":{"swarm_id":1,"a":[[{}],null]})")),
+        response(good, R"(,"x":[{"height":1}],"height":42,"block_hash":"abc",)"
+                       R"("hardfork":14,"y":{"result":{}})"),
+        R"({"result":{"height":1,"service_node_states":[)" + good +
+            R"(],"block_hash":"abc","hardfork":14},"x":null})",
+        // Numbers of another kind
+        response(node(pk1, "2.5e3", R"(,"storage_port":-1)"),
+                 R"(,"height":4.2,"block_hash":"abc","hardfork":-3)"),
+        // Not fully funded
+        response(node(pk1, "200", R"(,"funded":false)") + "," +
+                 node(pk2, "100")),
+        // The nodes before an invalid one, and nothing else
+        response(node(pk1, "200") + "," + node(pk2, "100", R"(,"funded":1)")),
+        response(node(pk1, "200") + "," +
+                 node(pk2, "100", R"(,"public_ip":null)")),
+        response(node(pk1, "200") + "," +
+                 node(pk2, "100", R"(,"public_ip":["1.2.3.4"])")),
+        response(node(pk1, "200") + "," +
+                 node(pk2, "100", R"(,"swarm_id":"100")")),
+        response(node(pk1, "200") + "," + node("1234", "100")),
+        response(node(pk1, "200") + ",[]," + node(pk2, "100")),
+        response(node(pk1, "200") + ",1," + node(pk2, "100")),
+        response(node(pk1, "200") + ",null"),
+        R"({"result":{"service_node_states":[)" + good +
+            R"(],"height":42,"hardfork":14}})",
+        R"({"result":{"service_node_states":[)" + good +
+            R"(],"height":42,"block_hash":1,"hardfork":14}})",
+        R"({"result":{"service_node_states":[)" + good +
+            R"(],"block_hash":"abc","hardfork":14}})",
+        R"({"result":{"service_node_states":[)" + good +
+            R"(],"height":42,"block_hash":"abc"}})",
+        R"({"result":{"service_node_states":{},"height":42,)"
+        R"("block_hash":"abc","hardfork":14}})",
+        R"({"result":{"service_node_states":{"a":)" + node(pk1, "200") +
+            R"(,"b":1},"height":42,"block_hash":"abc","hardfork":14}})",
+        // Nothing
+        R"({"result":{"service_node_states":null,"height":42,)"
+        R"("block_hash":"abc","hardfork":14}})",
+        R"({"result":{"service_node_states":1,"height":42,)"
+        R"("block_hash":"abc","hardfork":14}})",
+        R"({"result":{"height":42,"block_hash":"abc","hardfork":14}})",
+        R"({"result":[)" + good + "]}",
+        R"({"result":null})",
+        "[" + response(good) + "]",
+        response(good) + "x",
+        response(good).substr(0, 100),
+        "",
+        "null",
+    };
+
+    for (const auto& body : responses) {
+        BOOST_TEST_CONTEXT(body) {
+            BOOST_CHECK_EQUAL(describe(sispop::parse_swarm_update(
+                                  std::make_shared<std::string>(body))),
+                              describe(dom_parse_swarm_update(body)));
+        }
+    }
+
+    BOOST_CHECK_THROW(sispop::parse_swarm_update(nullptr), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(it_detects_new_swarms_and_snodes) {
+    const auto node = [](uint16_t port) {
+        return sn_record_t{port, std::string(52, 'y'),
+                           std::string(64, "0123456789abcdef"[port]), "", "",
+                           "0.0.0.0"};
+    };
+    const auto us = node(1);
+    sispop::all_swarms_t swarms{{300, {node(2)}}, {100, {us, node(3)}}};
+
+    sispop::Swarm swarm{us};
+    auto events = swarm.derive_swarm_events(swarms);
+    swarm.set_swarm_id(events.our_swarm_id);
+    swarm.update_state(swarms, {}, events);
+    BOOST_CHECK_EQUAL(swarm.our_swarm_id(), 100);
+
+    swarms = {{50, {node(4)}}, {100, {us, node(3), node(5)}},
+              {300, {node(2)}}, {400, {node(6)}}};
+    events = swarm.derive_swarm_events(swarms);
+    BOOST_CHECK(!events.dissolved);
+    BOOST_CHECK(events.new_swarms == std::vector<swarm_id_t>({50, 400}));
+    BOOST_REQUIRE_EQUAL(events.new_snodes.size(), 1);
+    BOOST_CHECK_EQUAL(events.new_snodes[0].pub_key_hex(),
+                      std::string(64, '5'));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,194 @@
+#include "timer_wheel.h"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <vector>
+
+using namespace std::chrono_literals;
+using sispop::TimerWheel;
+
+namespace {
+
+/// A wheel driven by hand (`run_until`), rather than by an io_context
+struct wheel_fixture_t {
+    boost::asio::io_context ioc;
+    TimerWheel& wheel = TimerWheel::get(ioc);
+    TimerWheel::clock::time_point now = TimerWheel::clock::now();
+
+    void advance(TimerWheel::clock::duration duration) {
+        now += duration;
+        wheel.run_until(now);
+    }
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(timer_wheel)
+
+BOOST_FIXTURE_TEST_CASE(it_fires_within_a_tick_of_the_timeout,
+                        wheel_fixture_t) {
+    // The long ones are moved between the levels of the wheel on the way
+    const std::chrono::milliseconds timeouts[] = {50ms, 1s,  30s,
+                                                  10min, 2h, 48h};
+    for (const auto timeout : timeouts) {
+        BOOST_TEST_CONTEXT("timeout: " << timeout.count() << " ms") {
+            int fired = 0;
+            TimerWheel::timer_t timer{ioc};
+            timer.expires_at(now + timeout, [&]() { fired++; });
+            BOOST_CHECK(timer.pending());
+            BOOST_CHECK_EQUAL(wheel.size(), 1);
+
+            advance(timeout - 1ms);
+            BOOST_CHECK_EQUAL(fired, 0);
+            advance(TimerWheel::TICK + 1ms);
+            BOOST_CHECK_EQUAL(fired, 1);
+            BOOST_CHECK(!timer.pending());
+            BOOST_CHECK_EQUAL(wheel.size(), 0);
+
+            // Only once
+            advance(timeout);
+            BOOST_CHECK_EQUAL(fired, 1);
+        }
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(it_fires_timers_in_order, wheel_fixture_t) {
+    std::vector<int> fired;
+    std::vector<std::unique_ptr<TimerWheel::timer_t>> timers;
+    const std::chrono::milliseconds timeouts[] = {45s, 300ms, 2s, 30min, 25s};
+    for (int i = 0; i < 5; ++i) {
+        timers.push_back(std::make_unique<TimerWheel::timer_t>(ioc));
+        timers.back()->expires_at(now + timeouts[i],
+                                  [&fired, i]() { fired.push_back(i); });
+    }
+    BOOST_CHECK_EQUAL(wheel.size(), 5);
+
+    advance(1min);
+    BOOST_CHECK(fired == std::vector<int>({1, 2, 4, 0}));
+    BOOST_CHECK_EQUAL(wheel.size(), 1);
+
+    advance(30min);
+    BOOST_CHECK(fired == std::vector<int>({1, 2, 4, 0, 3}));
+}
+
+BOOST_FIXTURE_TEST_CASE(it_cancels_timers, wheel_fixture_t) {
+    int fired = 0;
+    auto holder = std::make_shared<int>(0);
+    TimerWheel::timer_t timer{ioc};
+    BOOST_CHECK(!timer.cancel());
+
+    timer.expires_at(now + 1s, [&fired, holder]() { fired++; });
+    BOOST_CHECK_EQUAL(holder.use_count(), 2);
+
+    BOOST_CHECK(timer.cancel());
+    BOOST_CHECK(!timer.pending());
+    BOOST_CHECK_EQUAL(wheel.size(), 0);
+    // The callback is dropped right away
+    BOOST_CHECK_EQUAL(holder.use_count(), 1);
+    BOOST_CHECK(!timer.cancel());
+
+    advance(2s);
+    BOOST_CHECK_EQUAL(fired, 0);
+
+    {
+        TimerWheel::timer_t temporary{ioc};
+        temporary.expires_at(now + 1s, [&fired]() { fired++; });
+        BOOST_CHECK_EQUAL(wheel.size(), 1);
+    }
+    BOOST_CHECK_EQUAL(wheel.size(), 0);
+    advance(2s);
+    BOOST_CHECK_EQUAL(fired, 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(it_replaces_pending_timeouts, wheel_fixture_t) {
+    int first = 0;
+    int second = 0;
+    TimerWheel::timer_t timer{ioc};
+    timer.expires_at(now + 1s, [&]() { first++; });
+    timer.expires_at(now + 15s, [&]() { second++; });
+    BOOST_CHECK_EQUAL(wheel.size(), 1);
+
+    advance(10s);
+    BOOST_CHECK_EQUAL(first + second, 0);
+    advance(6s);
+    BOOST_CHECK_EQUAL(first, 0);
+    BOOST_CHECK_EQUAL(second, 1);
+
+    // Timeouts in the past go off with the next tick
+    timer.expires_at(now - 1min, [&]() { first++; });
+    advance(TimerWheel::TICK);
+    BOOST_CHECK_EQUAL(first, 1);
+}
+
+BOOST_FIXTURE_TEST_CASE(it_lets_callbacks_use_timers, wheel_fixture_t) {
+    int fired = 0;
+    TimerWheel::timer_t canceller{ioc};
+    TimerWheel::timer_t rearmed{ioc};
+    auto cancelled = std::make_unique<TimerWheel::timer_t>(ioc);
+    auto destroyed = std::make_unique<TimerWheel::timer_t>(ioc);
+
+    // All due with the same tick, `canceller` first
+    canceller.expires_at(now + 1s, [&]() {
+        BOOST_CHECK(cancelled->cancel());
+        destroyed.reset();
+    });
+    std::function<void()> rearm = [&]() {
+        fired++;
+        rearmed.expires_at(now + 1s, rearm);
+    };
+    rearmed.expires_at(now + 1s, rearm);
+    cancelled->expires_at(now + 1s, [&]() { fired += 100; });
+    destroyed->expires_at(now + 1s, [&]() { fired += 100; });
+
+    advance(1s + TimerWheel::TICK);
+    BOOST_CHECK_EQUAL(fired, 1);
+    BOOST_CHECK(rearmed.pending());
+    BOOST_CHECK_EQUAL(wheel.size(), 1);
+
+    advance(1s + TimerWheel::TICK);
+    BOOST_CHECK_EQUAL(fired, 2);
+}
+
+BOOST_AUTO_TEST_CASE(it_runs_on_the_io_context) {
+    boost::asio::io_context ioc;
+    const auto start = TimerWheel::clock::now();
+    TimerWheel::clock::time_point fired_at;
+
+    TimerWheel::timer_t timer{ioc};
+    timer.expires_after(150ms,
+                        [&]() { fired_at = TimerWheel::clock::now(); });
+
+    // Returns once there are no timers left
+    ioc.run();
+
+    BOOST_CHECK(fired_at >= start + 150ms);
+    BOOST_CHECK(fired_at < start + 150ms + 5 * TimerWheel::TICK);
+}
+
+BOOST_AUTO_TEST_CASE(it_drops_pending_callbacks_with_the_io_context) {
+    auto holder = std::make_shared<int>(0);
+    auto ioc = std::make_unique<boost::asio::io_context>();
+    // Timers keeping their owner alive, like a connection's
+    struct owner_t {
+        TimerWheel::timer_t first;
+        TimerWheel::timer_t second;
+        std::shared_ptr<int> holder;
+
+        owner_t(boost::asio::io_context& ioc, std::shared_ptr<int> holder)
+            : first(ioc), second(ioc), holder(std::move(holder)) {}
+    };
+    auto owner = std::make_shared<owner_t>(*ioc, holder);
+    owner->first.expires_after(1s, [owner]() {});
+    owner->second.expires_after(1h, [owner]() {});
+    owner.reset();
+    BOOST_CHECK_EQUAL(holder.use_count(), 2);
+
+    ioc.reset();
+    BOOST_CHECK_EQUAL(holder.use_count(), 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
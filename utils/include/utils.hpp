@@ -4,7 +4,6 @@
 #include <random>
 #include <stdint.h>
 #include <string>
-#include <unordered_map>
 #include <vector>
 #include <array>
 
@@ -24,22 +23,48 @@ uint64_t get_time_ms();
 
 // adapted from Sispopnet llarp/encode.hpp
 // from  https://en.wikipedia.org/wiki/Base32#z-base-32
-static const char zbase32_alpha[] = {'y', 'b', 'n', 'd', 'r', 'f', 'g', '8',
-                                     'e', 'j', 'k', 'm', 'c', 'p', 'q', 'x',
-                                     'o', 't', '1', 'u', 'w', 'i', 's', 'z',
-                                     'a', '3', '4', '5', 'h', '7', '6', '9'};
-
-static const std::unordered_map<char, uint8_t> zbase32_reverse_alpha = {
-    {'y', 0},  {'b', 1},  {'n', 2},  {'d', 3},  {'r', 4},  {'f', 5},  {'g', 6},
-    {'8', 7},  {'e', 8},  {'j', 9},  {'k', 10}, {'m', 11}, {'c', 12}, {'p', 13},
-    {'q', 14}, {'x', 15}, {'o', 16}, {'t', 17}, {'1', 18}, {'u', 19}, {'w', 20},
-    {'i', 21}, {'s', 22}, {'z', 23}, {'a', 24}, {'3', 25}, {'4', 26}, {'5', 27},
-    {'h', 28}, {'7', 29}, {'6', 30}, {'9', 31}};
+constexpr char zbase32_alpha[] = {'y', 'b', 'n', 'd', 'r', 'f', 'g', '8',
+                                 'e', 'j', 'k', 'm', 'c', 'p', 'q', 'x',
+                                 'o', 't', '1', 'u', 'w', 'i', 's', 'z',
+                                 'a', '3', '4', '5', 'h', '7', '6', '9'};
+
+/// Value of each character in zbase32_alpha, -1 for any other character
+struct zbase32_reverse_t {
+    int8_t values[256];
+
+    constexpr zbase32_reverse_t() : values{} {
+        for (int i = 0; i < 256; ++i) {
+            values[i] = -1;
+        }
+        for (int i = 0; i < 32; ++i) {
+            values[static_cast<uint8_t>(zbase32_alpha[i])] = i;
+        }
+    }
+
+    constexpr int8_t operator[](char ch) const {
+        return values[static_cast<uint8_t>(ch)];
+    }
+};
+
+constexpr zbase32_reverse_t zbase32_reverse_alpha{};
+
+/// Instruction sets the base64 and hex codecs can use
+enum class simd_t { none, ssse3, avx2 };
 
+/// The best one this CPU supports, which the codecs use by default
+simd_t simd_supported();
+
+/// Make the codecs use `level` at most (for tests and benchmarks)
+void set_simd(simd_t level);
+
+/// Decodes up to the first '=' or character outside of the alphabet
 std::string base64_decode(std::string const& data);
 
 std::string base64_encode(std::string const& s);
 
+/// Lowercase hex of `len` bytes
+std::string hex_encode(const void* data, size_t len);
+
 /// adapted from i2pd
 template <typename Container, typename stack_t>
 const char* base32z_encode(const Container& value, stack_t& stack) {
@@ -90,15 +115,12 @@ bool base32z_decode(const Stack& stack, V& value) {
     size_t len = base32_decode_size(value.size());
     size_t outLen = value.size();
     for (size_t i = 0; i < len; i++) {
-        char ch = stack[i];
-        if (ch) {
-            auto itr = zbase32_reverse_alpha.find(ch);
-            if (itr == zbase32_reverse_alpha.end())
-                return false;
-            ch = itr->second;
-        } else {
+        const char c = stack[i];
+        if (!c)
             return ret == outLen;
-        }
+        const int8_t ch = zbase32_reverse_alpha[c];
+        if (ch < 0)
+            return false;
         tmp |= ch;
         bits += 5;
         if (bits >= 8) {
@@ -113,6 +135,57 @@ bool base32z_decode(const Stack& stack, V& value) {
     return true;
 }
 
+/// Number of base32z characters for `N` bytes
+template <size_t N>
+constexpr size_t base32z_size() {
+    return (N * 8 + 4) / 5;
+}
+
+/// Same as base32z_encode above for a fixed size (e.g. a 32-byte key), so
+/// that the loop can be unrolled
+template <size_t N>
+std::array<char, base32z_size<N>()>
+base32z_encode(const std::array<uint8_t, N>& value) {
+    std::array<char, base32z_size<N>()> out;
+    uint64_t tmp = 0;
+    int bits = 0;
+    size_t ret = 0;
+    for (size_t pos = 0; pos < N; ++pos) {
+        tmp = tmp << 8 | value[pos];
+        bits += 8;
+        while (bits >= 5) {
+            bits -= 5;
+            out[ret++] = zbase32_alpha[(tmp >> bits) & 0x1F];
+        }
+    }
+    if (bits > 0)
+        out[ret] = zbase32_alpha[(tmp << (5 - bits)) & 0x1F];
+    return out;
+}
+
+/// Same as base32z_decode above for a fixed size: true if `str` is exactly
+/// base32z_size<N>() characters of the alphabet
+template <size_t N>
+bool base32z_decode(const std::string& str, std::array<uint8_t, N>& value) {
+    if (str.size() != base32z_size<N>())
+        return false;
+    uint64_t tmp = 0;
+    int bits = 0;
+    size_t ret = 0;
+    int8_t invalid = 0;
+    for (const char ch : str) {
+        const int8_t v = zbase32_reverse_alpha[ch];
+        invalid |= v;
+        tmp = tmp << 5 | (v & 0x1F);
+        bits += 5;
+        if (bits >= 8) {
+            bits -= 8;
+            value[ret++] = tmp >> bits;
+        }
+    }
+    return invalid >= 0;
+}
+
 std::string hex_to_base32z(const std::string& src);
 
 std::string hex_to_bytes(const std::string &hex);
@@ -135,9 +208,8 @@ std::string as_hex(It begin, It end) {
 
 template <typename String>
 inline std::string as_hex(const String &s) {
-    using std::begin;
-    using std::end;
-    return as_hex(begin(s), end(s));
+    static_assert(sizeof(*s.data()) == 1, "expected a sequence of bytes");
+    return hex_encode(s.data(), s.size());
 }
 
 /// Returns a random number from [0, n) using a static generator
@@ -0,0 +1,576 @@
+#include "utils.hpp"
+
+#include <atomic>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define UTILS_CODEC_X86
+#endif
+
+// Base64 and hex codecs. The bulk of the data goes through SSSE3 or AVX2
+// kernels (picked at run time), which stop where the scalar code has to
+// take over: for the tail, or when base64 input has padding or anything
+// outside of the alphabet. The SIMD base64 code follows Wojciech Muła's
+// and Alfred Klomp's (https://github.com/aklomp/base64)
+
+namespace util {
+
+namespace {
+
+constexpr char base64_alphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+constexpr char hex_alphabet[] = "0123456789abcdef";
+
+struct base64_inverse_t {
+    int8_t values[256];
+
+    constexpr base64_inverse_t() : values{} {
+        for (int i = 0; i < 256; ++i) {
+            values[i] = -1;
+        }
+        for (int i = 0; i < 64; ++i) {
+            values[static_cast<uint8_t>(base64_alphabet[i])] = i;
+        }
+    }
+};
+
+constexpr base64_inverse_t base64_inverse{};
+
+std::atomic<simd_t> simd_level{simd_supported()};
+
+// ---------------------------------------------------------------- scalar --
+
+size_t base64_encode_scalar(const uint8_t* in, size_t len, char* out) {
+    char* const begin = out;
+    size_t i = 0;
+    for (; i + 3 <= len; i += 3) {
+        const uint32_t v = in[i] << 16 | in[i + 1] << 8 | in[i + 2];
+        *out++ = base64_alphabet[v >> 18];
+        *out++ = base64_alphabet[(v >> 12) & 0x3f];
+        *out++ = base64_alphabet[(v >> 6) & 0x3f];
+        *out++ = base64_alphabet[v & 0x3f];
+    }
+    if (len - i == 1) {
+        const uint32_t v = in[i] << 16;
+        *out++ = base64_alphabet[v >> 18];
+        *out++ = base64_alphabet[(v >> 12) & 0x3f];
+        *out++ = '=';
+        *out++ = '=';
+    } else if (len - i == 2) {
+        const uint32_t v = in[i] << 16 | in[i + 1] << 8;
+        *out++ = base64_alphabet[v >> 18];
+        *out++ = base64_alphabet[(v >> 12) & 0x3f];
+        *out++ = base64_alphabet[(v >> 6) & 0x3f];
+        *out++ = '=';
+    }
+    return out - begin;
+}
+
+// Stops at the first character outside of the alphabet (including '='),
+// a last incomplete group of n characters gives n - 1 bytes
+size_t base64_decode_scalar(const char* in, size_t len, uint8_t* out) {
+    uint8_t* const begin = out;
+    uint32_t acc = 0;
+    int n = 0;
+    for (size_t i = 0; i < len; ++i) {
+        const int8_t v = base64_inverse.values[static_cast<uint8_t>(in[i])];
+        if (v < 0) {
+            break;
+        }
+        acc = acc << 6 | v;
+        if (++n == 4) {
+            *out++ = acc >> 16;
+            *out++ = acc >> 8;
+            *out++ = acc;
+            acc = 0;
+            n = 0;
+        }
+    }
+    if (n >= 2) {
+        acc <<= 6 * (4 - n);
+        *out++ = acc >> 16;
+        if (n == 3) {
+            *out++ = acc >> 8;
+        }
+    }
+    return out - begin;
+}
+
+void hex_encode_scalar(const uint8_t* in, size_t len, char* out) {
+    for (size_t i = 0; i < len; ++i) {
+        *out++ = hex_alphabet[in[i] >> 4];
+        *out++ = hex_alphabet[in[i] & 0x0f];
+    }
+}
+
+constexpr uint8_t hex_to_nibble(char ch) {
+    return (ch >= '0' && ch <= '9')
+               ? ch - '0'
+               : (ch >= 'A' && ch <= 'F')
+                     ? ch - 'A' + 10
+                     : (ch >= 'a' && ch <= 'f') ? ch - 'a' + 10 : 0;
+}
+
+// `len` bytes from 2 * `len` characters, anything but a hex digit counts
+// as 0
+void hex_decode_scalar(const char* in, size_t len, uint8_t* out) {
+    for (size_t i = 0; i < len; ++i) {
+        out[i] = hex_to_nibble(in[2 * i]) << 4 | hex_to_nibble(in[2 * i + 1]);
+    }
+}
+
+#ifdef UTILS_CODEC_X86
+
+// ----------------------------------------------------------------- SSSE3 --
+
+// 12 bytes (in the first 12 of 16) to 16 6-bit values
+__attribute__((target("ssse3"))) __m128i enc_reshuffle(__m128i in) {
+    in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3,
+                                           4, 1, 2, 0, 1));
+    const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+    const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+    const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    return _mm_or_si128(t1, t3);
+}
+
+// 6-bit values to characters, by adding the offset of their range:
+// A-Z +65, a-z +71, 0-9 -4, '+' -19, '/' -16
+__attribute__((target("ssse3"))) __m128i enc_translate(__m128i in) {
+    const __m128i lut = _mm_setr_epi8(65, 71, -4, -4, -4, -4, -4, -4, -4, -4,
+                                      -4, -4, -19, -16, 0, 0);
+    __m128i indices = _mm_subs_epu8(in, _mm_set1_epi8(51));
+    const __m128i mask = _mm_cmpgt_epi8(in, _mm_set1_epi8(25));
+    indices = _mm_sub_epi8(indices, mask);
+    return _mm_add_epi8(in, _mm_shuffle_epi8(lut, indices));
+}
+
+// 16 6-bit values to 12 bytes (in the first 12 of 16)
+__attribute__((target("ssse3"))) __m128i dec_reshuffle(__m128i in) {
+    const __m128i merged =
+        _mm_maddubs_epi16(in, _mm_set1_epi32(0x01400140));
+    const __m128i out = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+    return _mm_shuffle_epi8(out, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14,
+                                               13, 12, -1, -1, -1, -1));
+}
+
+// Lookup tables classifying characters by their nibbles: any character
+// outside of the alphabet has a common bit in both
+const int8_t dec_lut_lo[16] = {0x15, 0x11, 0x11, 0x11, 0x11, 0x11,
+                               0x11, 0x11, 0x11, 0x11, 0x13, 0x1A,
+                               0x1B, 0x1B, 0x1B, 0x1A};
+const int8_t dec_lut_hi[16] = {0x10, 0x10, 0x01, 0x02, 0x04, 0x08,
+                               0x04, 0x08, 0x10, 0x10, 0x10, 0x10,
+                               0x10, 0x10, 0x10, 0x10};
+// What to add to a character to get its value, by high nibble ('/' is 1)
+const int8_t dec_lut_roll[16] = {0,   16,  19,  4, -65, -65, -71, -71,
+                                 0,   0,   0,   0, 0,   0,   0,   0};
+
+__attribute__((target("ssse3"))) size_t
+base64_encode_ssse3(const uint8_t* in, size_t len, char* out) {
+    size_t i = 0;
+    // Reads 16 bytes for every 12
+    for (; i + 16 <= len; i += 12, out += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out),
+                         enc_translate(enc_reshuffle(v)));
+    }
+    return i;
+}
+
+// Writes 16 bytes for every 12
+__attribute__((target("ssse3"))) size_t
+base64_decode_ssse3(const char* in, size_t len, uint8_t* out) {
+    const __m128i lut_lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dec_lut_lo));
+    const __m128i lut_hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dec_lut_hi));
+    const __m128i lut_roll = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dec_lut_roll));
+    const __m128i mask_2f = _mm_set1_epi8(0x2f);
+
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16, out += 12) {
+        __m128i str = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+
+        const __m128i hi_nibbles =
+            _mm_and_si128(_mm_srli_epi32(str, 4), mask_2f);
+        const __m128i lo_nibbles = _mm_and_si128(str, mask_2f);
+        const __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+        const __m128i lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+        if (_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_and_si128(lo, hi),
+                                             _mm_setzero_si128())) != 0) {
+            break;
+        }
+
+        const __m128i eq_2f = _mm_cmpeq_epi8(str, mask_2f);
+        const __m128i roll =
+            _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2f, hi_nibbles));
+        str = _mm_add_epi8(str, roll);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), dec_reshuffle(str));
+    }
+    return i;
+}
+
+__attribute__((target("ssse3"))) size_t hex_encode_ssse3(const uint8_t* in,
+                                                         size_t len,
+                                                         char* out) {
+    const __m128i lut = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hex_alphabet));
+    const __m128i mask_0f = _mm_set1_epi8(0x0f);
+
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16, out += 32) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        const __m128i hi = _mm_shuffle_epi8(
+            lut, _mm_and_si128(_mm_srli_epi16(v, 4), mask_0f));
+        const __m128i lo = _mm_shuffle_epi8(lut, _mm_and_si128(v, mask_0f));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out),
+                         _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16),
+                         _mm_unpackhi_epi8(hi, lo));
+    }
+    return i;
+}
+
+// Value of each hex digit, 0 for anything else
+__attribute__((target("ssse3"))) __m128i hex_nibbles(__m128i c) {
+    const __m128i digit = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+    const __m128i is_digit =
+        _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)),
+                      _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), c));
+    // Only 'A'-'F' and 'a'-'f' become 'a'-'f'
+    const __m128i lower = _mm_or_si128(c, _mm_set1_epi8(0x20));
+    const __m128i alpha = _mm_sub_epi8(lower, _mm_set1_epi8('a' - 10));
+    const __m128i is_alpha =
+        _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                      _mm_cmpgt_epi8(_mm_set1_epi8('f' + 1), lower));
+    return _mm_or_si128(_mm_and_si128(digit, is_digit),
+                        _mm_and_si128(alpha, is_alpha));
+}
+
+__attribute__((target("ssse3"))) size_t hex_decode_ssse3(const char* in,
+                                                         size_t len,
+                                                         uint8_t* out) {
+    // high nibble * 16 + low nibble
+    const __m128i weights = _mm_set1_epi16(0x0110);
+
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16, in += 32) {
+        const __m128i n0 = hex_nibbles(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(in)));
+        const __m128i n1 = hex_nibbles(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 16)));
+        const __m128i bytes = _mm_packus_epi16(_mm_maddubs_epi16(n0, weights),
+                                               _mm_maddubs_epi16(n1, weights));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), bytes);
+    }
+    return i;
+}
+
+// ------------------------------------------------------------------ AVX2 --
+
+__attribute__((target("avx2"))) __m256i broadcast(const void* table) {
+    return _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(static_cast<const __m128i*>(table)));
+}
+
+__attribute__((target("avx2"))) size_t
+base64_encode_avx2(const uint8_t* in, size_t len, char* out) {
+    const __m256i shuffle = _mm256_set_epi8(
+        10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1, 10, 11, 9, 10, 7,
+        8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+    const __m256i lut = _mm256_setr_epi8(
+        65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0, 65, 71,
+        -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0);
+
+    size_t i = 0;
+    // 12 bytes in each lane, reads 28 bytes for every 24
+    for (; i + 28 <= len; i += 24, out += 32) {
+        __m256i v = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i))),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 12)),
+            1);
+
+        v = _mm256_shuffle_epi8(v, shuffle);
+        const __m256i t0 = _mm256_and_si256(v, _mm256_set1_epi32(0x0fc0fc00));
+        const __m256i t1 =
+            _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+        const __m256i t2 = _mm256_and_si256(v, _mm256_set1_epi32(0x003f03f0));
+        const __m256i t3 =
+            _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+        v = _mm256_or_si256(t1, t3);
+
+        __m256i indices = _mm256_subs_epu8(v, _mm256_set1_epi8(51));
+        const __m256i mask = _mm256_cmpgt_epi8(v, _mm256_set1_epi8(25));
+        indices = _mm256_sub_epi8(indices, mask);
+        v = _mm256_add_epi8(v, _mm256_shuffle_epi8(lut, indices));
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), v);
+    }
+    return i;
+}
+
+// Writes 32 bytes for every 24
+__attribute__((target("avx2"))) size_t
+base64_decode_avx2(const char* in, size_t len, uint8_t* out) {
+    const __m256i lut_lo = broadcast(dec_lut_lo);
+    const __m256i lut_hi = broadcast(dec_lut_hi);
+    const __m256i lut_roll = broadcast(dec_lut_roll);
+    const __m256i mask_2f = _mm256_set1_epi8(0x2f);
+    const __m256i pack = _mm256_setr_epi8(
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1, 2, 1, 0, 6, 5,
+        4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    const __m256i join = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, -1, -1);
+
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32, out += 24) {
+        __m256i str =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+
+        const __m256i hi_nibbles =
+            _mm256_and_si256(_mm256_srli_epi32(str, 4), mask_2f);
+        const __m256i lo_nibbles = _mm256_and_si256(str, mask_2f);
+        const __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+        const __m256i lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+        if (!_mm256_testz_si256(lo, hi)) {
+            break;
+        }
+
+        const __m256i eq_2f = _mm256_cmpeq_epi8(str, mask_2f);
+        const __m256i roll =
+            _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2f, hi_nibbles));
+        str = _mm256_add_epi8(str, roll);
+
+        const __m256i merged =
+            _mm256_maddubs_epi16(str, _mm256_set1_epi32(0x01400140));
+        __m256i bytes =
+            _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+        bytes = _mm256_shuffle_epi8(bytes, pack);
+        bytes = _mm256_permutevar8x32_epi32(bytes, join);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), bytes);
+    }
+    return i;
+}
+
+__attribute__((target("avx2"))) size_t hex_encode_avx2(const uint8_t* in,
+                                                       size_t len, char* out) {
+    const __m256i lut = broadcast(hex_alphabet);
+    const __m256i mask_0f = _mm256_set1_epi8(0x0f);
+
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32, out += 64) {
+        const __m256i v =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        const __m256i hi = _mm256_shuffle_epi8(
+            lut, _mm256_and_si256(_mm256_srli_epi16(v, 4), mask_0f));
+        const __m256i lo =
+            _mm256_shuffle_epi8(lut, _mm256_and_si256(v, mask_0f));
+        // Interleaving works within lanes: bytes 0-7 and 16-23, 8-15 and
+        // 24-31
+        const __m256i a = _mm256_unpacklo_epi8(hi, lo);
+        const __m256i b = _mm256_unpackhi_epi8(hi, lo);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out),
+                            _mm256_permute2x128_si256(a, b, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 32),
+                            _mm256_permute2x128_si256(a, b, 0x31));
+    }
+    return i;
+}
+
+__attribute__((target("avx2"))) __m256i hex_nibbles_avx2(__m256i c) {
+    const __m256i digit = _mm256_sub_epi8(c, _mm256_set1_epi8('0'));
+    const __m256i is_digit =
+        _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('0' - 1)),
+                         _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), c));
+    const __m256i lower = _mm256_or_si256(c, _mm256_set1_epi8(0x20));
+    const __m256i alpha = _mm256_sub_epi8(lower, _mm256_set1_epi8('a' - 10));
+    const __m256i is_alpha =
+        _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)),
+                         _mm256_cmpgt_epi8(_mm256_set1_epi8('f' + 1), lower));
+    return _mm256_or_si256(_mm256_and_si256(digit, is_digit),
+                           _mm256_and_si256(alpha, is_alpha));
+}
+
+__attribute__((target("avx2"))) size_t hex_decode_avx2(const char* in,
+                                                       size_t len,
+                                                       uint8_t* out) {
+    const __m256i weights = _mm256_set1_epi16(0x0110);
+
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32, in += 64) {
+        const __m256i n0 = hex_nibbles_avx2(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in)));
+        const __m256i n1 = hex_nibbles_avx2(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + 32)));
+        // Packing works within lanes: bytes 0-7, 16-23, 8-15, 24-31
+        const __m256i bytes =
+            _mm256_packus_epi16(_mm256_maddubs_epi16(n0, weights),
+                                _mm256_maddubs_epi16(n1, weights));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                            _mm256_permute4x64_epi64(bytes, 0xd8));
+    }
+    return i;
+}
+
+#endif // UTILS_CODEC_X86
+
+// Room for what the SIMD decoders write past the end of their output
+constexpr size_t DECODE_SLACK = 8;
+
+size_t base64_encode(const uint8_t* in, size_t len, char* out) {
+    size_t done = 0;
+#ifdef UTILS_CODEC_X86
+    switch (simd_level.load(std::memory_order_relaxed)) {
+    case simd_t::avx2:
+        done = base64_encode_avx2(in, len, out);
+        break;
+    case simd_t::ssse3:
+        done = base64_encode_ssse3(in, len, out);
+        break;
+    case simd_t::none:
+        break;
+    }
+#endif
+    return done / 3 * 4 + base64_encode_scalar(in + done, len - done,
+                                                out + done / 3 * 4);
+}
+
+size_t base64_decode(const char* in, size_t len, uint8_t* out) {
+    size_t done = 0;
+#ifdef UTILS_CODEC_X86
+    switch (simd_level.load(std::memory_order_relaxed)) {
+    case simd_t::avx2:
+        done = base64_decode_avx2(in, len, out);
+        break;
+    case simd_t::ssse3:
+        done = base64_decode_ssse3(in, len, out);
+        break;
+    case simd_t::none:
+        break;
+    }
+#endif
+    return done / 4 * 3 + base64_decode_scalar(in + done, len - done,
+                                                out + done / 4 * 3);
+}
+
+void hex_decode(const char* in, size_t len, uint8_t* out) {
+    size_t done = 0;
+#ifdef UTILS_CODEC_X86
+    switch (simd_level.load(std::memory_order_relaxed)) {
+    case simd_t::avx2:
+        done = hex_decode_avx2(in, len, out);
+        break;
+    case simd_t::ssse3:
+        done = hex_decode_ssse3(in, len, out);
+        break;
+    case simd_t::none:
+        break;
+    }
+#endif
+    hex_decode_scalar(in + 2 * done, len - done, out + done);
+}
+
+} // namespace
+
+simd_t simd_supported() {
+#ifdef UTILS_CODEC_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return simd_t::avx2;
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+        return simd_t::ssse3;
+    }
+#endif
+    return simd_t::none;
+}
+
+void set_simd(simd_t level) {
+    simd_level = std::min(level, simd_supported());
+}
+
+std::string base64_decode(std::string const& data) {
+    std::string dest;
+    dest.resize(data.size() / 4 * 3 + 3 + DECODE_SLACK);
+    dest.resize(base64_decode(data.data(), data.size(),
+                              reinterpret_cast<uint8_t*>(&dest[0])));
+    return dest;
+}
+
+std::string base64_encode(std::string const& s) {
+    std::string dest;
+    dest.resize((s.size() + 2) / 3 * 4);
+    if (!s.empty()) {
+        base64_encode(reinterpret_cast<const uint8_t*>(s.data()), s.size(),
+                      &dest[0]);
+    }
+    return dest;
+}
+
+std::string hex_encode(const void* data, size_t len) {
+    std::string hex;
+    hex.resize(2 * len);
+    if (len == 0) {
+        return hex;
+    }
+
+    const auto in = static_cast<const uint8_t*>(data);
+    char* out = &hex[0];
+    size_t done = 0;
+#ifdef UTILS_CODEC_X86
+    switch (simd_level.load(std::memory_order_relaxed)) {
+    case simd_t::avx2:
+        done = hex_encode_avx2(in, len, out);
+        break;
+    case simd_t::ssse3:
+        done = hex_encode_ssse3(in, len, out);
+        break;
+    case simd_t::none:
+        break;
+    }
+#endif
+    hex_encode_scalar(in + done, len - done, out + 2 * done);
+    return hex;
+}
+
+std::string hex_to_bytes(const std::string& hex) {
+    std::string result;
+    result.resize(hex.size() / 2);
+    if (!result.empty()) {
+        hex_decode(hex.data(), result.size(),
+                   reinterpret_cast<uint8_t*>(&result[0]));
+    }
+    return result;
+}
+
+std::string hex_to_base32z(const std::string& src) {
+    // odd sized is invalid
+    if (src.size() & 1)
+        return "";
+
+    // public keys
+    constexpr size_t KEY_SIZE = 32;
+    if (src.size() == 2 * KEY_SIZE) {
+        std::array<uint8_t, KEY_SIZE> key;
+        hex_decode(src.data(), key.size(), key.data());
+        const auto encoded = base32z_encode(key);
+        return std::string(encoded.begin(), encoded.end());
+    }
+
+    // decode to binary
+    std::vector<uint8_t> bin(src.size() / 2);
+    if (bin.empty())
+        return "";
+    hex_decode(src.data(), bin.size(), bin.data());
+
+    // encode to base32z
+    char buf[64] = {0};
+    std::string result;
+    if (char const* dest = base32z_encode(bin, buf))
+        result = dest;
+
+    return result;
+}
+
+} // namespace util
@@ -30,6 +30,7 @@
 
 #include <assert.h>
 #include <stdint.h>
+#include <string.h>
 
 //#include "warnings.h"
 #include "crypto-ops.h"
@@ -1629,6 +1630,133 @@ void ge_scalarmult_base(ge_p3 *h, const unsigned char *a) {
   }
 }
 
+/* Fixed-base multiplication with a wider, fully precomputed table: radix 32
+   digits in [-16, 16], so 52 additions and no doublings instead of 64
+   additions and 4 doublings, for a table of 52 * 16 points (~100 KB) built
+   at run time by ge_base_w5_init. Selection stays constant time */
+
+void ge_base_w5_init(ge_precomp (*t)[16]) {
+  static const unsigned char one[32] = {1};
+  ge_p3 base;
+  ge_p3 row[16];
+  ge_cached cached;
+  ge_p1p1 r;
+  fe acc[16];
+  fe inv;
+  fe recip;
+  fe x;
+  fe y;
+  int i;
+  int j;
+
+  ge_scalarmult_base(&base, one);
+
+  for (i = 0; i < GE_BASE_W5_ROWS; ++i) {
+    /* row[j] = (j + 1) * 32^i * B */
+    row[0] = base;
+    ge_p3_to_cached(&cached, &base);
+    for (j = 1; j < 16; ++j) {
+      ge_add(&r, &row[j - 1], &cached);
+      ge_p1p1_to_p3(&row[j], &r);
+    }
+    ge_p3_dbl(&r, &row[15]);
+    ge_p1p1_to_p3(&base, &r);
+
+    /* To affine, with one inversion per row */
+    fe_copy(acc[0], row[0].Z);
+    for (j = 1; j < 16; ++j) {
+      fe_mul(acc[j], acc[j - 1], row[j].Z);
+    }
+    fe_invert(inv, acc[15]);
+    for (j = 15; j >= 0; --j) {
+      if (j > 0) {
+        fe_mul(recip, inv, acc[j - 1]);
+        fe_mul(inv, inv, row[j].Z);
+      } else {
+        fe_copy(recip, inv);
+      }
+      fe_mul(x, row[j].X, recip);
+      fe_mul(y, row[j].Y, recip);
+      fe_add(t[i][j].yplusx, y, x);
+      fe_sub(t[i][j].yminusx, y, x);
+      fe_mul(t[i][j].xy2d, x, y);
+      fe_mul(t[i][j].xy2d, t[i][j].xy2d, fe_d2);
+    }
+  }
+}
+
+static void select_w5(ge_precomp *t, const ge_precomp *row, signed char b) {
+  ge_precomp minust;
+  unsigned char bnegative = negative(b);
+  unsigned char babs = b - (((-bnegative) & b) << 1);
+  int32_t *out = (int32_t *) t;
+  const int32_t *in;
+  int32_t mask;
+  int j;
+  int k;
+
+  /* OR together the entries masked with all ones for the one we want (if
+     any), in straight loops over the limbs that the compiler vectorises */
+  memset(t, 0, sizeof(*t));
+  for (j = 0; j < 16; ++j) {
+    in = (const int32_t *) &row[j];
+    mask = -(int32_t) equal(babs, j + 1);
+    for (k = 0; k < 30; ++k) {
+      out[k] |= in[k] & mask;
+    }
+  }
+  /* 0 selects the neutral element (1, 1, 0) */
+  t->yplusx[0] |= equal(babs, 0);
+  t->yminusx[0] |= equal(babs, 0);
+
+  fe_copy(minust.yplusx, t->yminusx);
+  fe_copy(minust.yminusx, t->yplusx);
+  fe_neg(minust.xy2d, t->xy2d);
+  ge_precomp_cmov(t, &minust, bnegative);
+}
+
+/*
+Same as ge_scalarmult_base, with the table from ge_base_w5_init
+
+Preconditions:
+  a[31] <= 127
+*/
+
+void ge_scalarmult_base_w5(ge_p3 *h, const unsigned char *a, const ge_precomp (*t)[16]) {
+  signed char e[GE_BASE_W5_ROWS];
+  signed char carry;
+  ge_p1p1 r;
+  ge_precomp p;
+  unsigned int w;
+  int i;
+
+  /* 51 windows of 5 bits cover the 255 bits of a */
+  for (i = 0; i < GE_BASE_W5_ROWS - 1; ++i) {
+    w = a[(5 * i) >> 3] >> ((5 * i) & 7);
+    if (((5 * i) >> 3) < 31) {
+      w |= (unsigned int) a[((5 * i) >> 3) + 1] << (8 - ((5 * i) & 7));
+    }
+    e[i] = w & 31;
+  }
+  /* each e[i] is between 0 and 31 */
+
+  carry = 0;
+  for (i = 0; i < GE_BASE_W5_ROWS - 1; ++i) {
+    e[i] += carry;
+    carry = e[i] + 16;
+    carry >>= 5;
+    e[i] -= carry << 5;
+  }
+  e[GE_BASE_W5_ROWS - 1] = carry;
+  /* each e[i] is between -16 and 16 */
+
+  ge_p3_0(h);
+  for (i = 0; i < GE_BASE_W5_ROWS; ++i) {
+    select_w5(&p, t[i], e[i]);
+    ge_madd(&r, h, &p); ge_p1p1_to_p3(h, &r);
+  }
+}
+
 /* From ge_sub.c */
 
 /*
@@ -1664,6 +1792,43 @@ void ge_tobytes(unsigned char *s, const ge_p2 *h) {
   s[31] ^= fe_isnegative(x) << 7;
 }
 
+/* Same as ge_tobytes for n points, sharing one field inversion between them
+   (Montgomery's trick). `scratch` must have room for n field elements */
+
+void ge_tobytes_batch(unsigned char *s, const ge_p2 *h, fe *scratch, size_t n) {
+  fe acc;
+  fe recip;
+  fe x;
+  fe y;
+  size_t i;
+
+  if (n == 0) {
+    return;
+  }
+
+  /* scratch[i] = Z_0 * ... * Z_i */
+  fe_copy(scratch[0], h[0].Z);
+  for (i = 1; i < n; ++i) {
+    fe_mul(scratch[i], scratch[i - 1], h[i].Z);
+  }
+
+  fe_invert(acc, scratch[n - 1]);
+
+  for (i = n - 1; i > 0; --i) {
+    fe_mul(recip, acc, scratch[i - 1]);
+    fe_mul(acc, acc, h[i].Z);
+    fe_mul(x, h[i].X, recip);
+    fe_mul(y, h[i].Y, recip);
+    fe_tobytes(s + 32 * i, y);
+    s[32 * i + 31] ^= fe_isnegative(x) << 7;
+  }
+
+  fe_mul(x, h[0].X, acc);
+  fe_mul(y, h[0].Y, acc);
+  fe_tobytes(s, y);
+  s[31] ^= fe_isnegative(x) << 7;
+}
+
 /* From sc_reduce.c */
 
 /*
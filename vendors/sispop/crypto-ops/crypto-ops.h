@@ -30,6 +30,7 @@
 
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 
 /* From fe.h */
@@ -118,10 +119,14 @@ void ge_p3_tobytes(unsigned char *, const ge_p3 *);
 
 extern const ge_precomp ge_base[32][8];
 void ge_scalarmult_base(ge_p3 *, const unsigned char *);
+#define GE_BASE_W5_ROWS 52
+void ge_base_w5_init(ge_precomp (*)[16]);
+void ge_scalarmult_base_w5(ge_p3 *, const unsigned char *, const ge_precomp (*)[16]);
 
 /* From ge_tobytes.c */
 
 void ge_tobytes(unsigned char *, const ge_p2 *);
+void ge_tobytes_batch(unsigned char *, const ge_p2 *, fe *, size_t);
 
 /* From sc_reduce.c */
 